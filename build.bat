@@ -31,6 +31,7 @@ REM warning C4127: conditional expression is constant
 REM warning C4714: function ... marked as __forceinline not inlined (because
 REM                QString::trimmed)
 REM /c Compile only, no link
+REM /fp:precise Don't fuse multiplies and adds, so that the SIMD kernels match the scalar ones
 
 set DEBUG="debug"
 set COMPILER_FLAGS_DEBUG=/MTd
@@ -46,7 +47,7 @@ set COMPILER_FLAGS=/nologo^
  /Gm /EHsc^
  /D_CRT_NONSTDC_NO_WARNINGS^
  /I "%project_dir%\src"^
- %COMPILER_FLAGS% /Zi /WX /W4 /wd4201 /wd4100 /wd4127 /wd4996 /FC /GR- /GL-
+ %COMPILER_FLAGS% /Zi /WX /W4 /wd4201 /wd4100 /wd4127 /wd4996 /FC /GR- /GL- /fp:precise
 
 set LINKER_FLAGS_DEBUG=
 set LINKER_FLAGS_RELEASE=
@@ -69,14 +70,64 @@ IF NOT ERRORLEVEL 1 (
 )
 
 if DEFINED have_ctime (ctime -begin "%project_dir%\%project%.ctm")
-cl.exe %COMPILER_FLAGS%^
+cl.exe %COMPILER_FLAGS% /DSTORECAST_COUNT_ALLOCATIONS^
  /Fm%project%.map /Fe%project%.exe^
  %project_dir%\src\main.cpp^
  %project_dir%\src\obj_import.cpp^
  %project_dir%\src\mesh.cpp^
+ %project_dir%\src\mapped_file.cpp^
+ %project_dir%\src\parse_number.cpp^
+ %project_dir%\src\parallel.cpp^
+ %project_dir%\src\vertex_dedup.cpp^
+ %project_dir%\src\mesh_cache.cpp^
+ %project_dir%\src\triangulate.cpp^
+ %project_dir%\src\mesh_optimize.cpp^
+ %project_dir%\src\mesh_quantize.cpp^
+ %project_dir%\src\mesh_soa.cpp^
+ %project_dir%\src\meshlet.cpp^
+ %project_dir%\src\simplify.cpp^
+ %project_dir%\src\mesh_codec.cpp^
+ %project_dir%\src\synthetic_obj.cpp^
+ %project_dir%\src\import_stats.cpp^
+ %project_dir%\src\memory_arena.cpp^
+ %project_dir%\src\thread_pool.cpp^
+ %project_dir%\src\batch_import.cpp^
+ %project_dir%\src\pipelined_reader.cpp^
+ %project_dir%\src\bvh.cpp^
+ %project_dir%\src\normal_generation.cpp^
  %project_dir%\src\tests.cpp^
  /link %LINKER_FLAGS%
 set compiler_error=%ERRORLEVEL%
+if %compiler_error% NEQ 0 goto compiled
+ECHO ------- %project%_bench.exe ---------------------------------------------------
+cl.exe %COMPILER_FLAGS% /O2 /DSTORECAST_COUNT_ALLOCATIONS^
+ /Fe%project%_bench.exe^
+ %project_dir%\src\bench.cpp^
+ %project_dir%\src\obj_import.cpp^
+ %project_dir%\src\mesh.cpp^
+ %project_dir%\src\mapped_file.cpp^
+ %project_dir%\src\parse_number.cpp^
+ %project_dir%\src\parallel.cpp^
+ %project_dir%\src\vertex_dedup.cpp^
+ %project_dir%\src\mesh_cache.cpp^
+ %project_dir%\src\triangulate.cpp^
+ %project_dir%\src\mesh_optimize.cpp^
+ %project_dir%\src\mesh_quantize.cpp^
+ %project_dir%\src\mesh_soa.cpp^
+ %project_dir%\src\meshlet.cpp^
+ %project_dir%\src\simplify.cpp^
+ %project_dir%\src\mesh_codec.cpp^
+ %project_dir%\src\synthetic_obj.cpp^
+ %project_dir%\src\import_stats.cpp^
+ %project_dir%\src\memory_arena.cpp^
+ %project_dir%\src\thread_pool.cpp^
+ %project_dir%\src\batch_import.cpp^
+ %project_dir%\src\pipelined_reader.cpp^
+ %project_dir%\src\bvh.cpp^
+ %project_dir%\src\normal_generation.cpp^
+ /link %LINKER_FLAGS% psapi.lib
+set compiler_error=%ERRORLEVEL%
+:compiled
 if DEFINED have_ctime (ctime -end "%project_dir%\%project%.ctm" %ERRORLEVEL%)
 popd
 
@@ -87,6 +138,7 @@ if %compiler_error% NEQ 0 (
 
 if NOT EXIST bin ( mkdir bin )
 call copy_if_different %build_dir%\%project%.exe bin\%project%.exe
+call copy_if_different %build_dir%\%project%_bench.exe bin\%project%_bench.exe
 
 echo Running tests
 call run.bat Tests
@@ -0,0 +1,59 @@
+#!/bin/sh
+# Builds storecast and storecast_bench with the system compiler, and runs the tests. This is
+# the counterpart of build.bat for Linux and macOS. Set CXX to pick the compiler, and
+# build_dir to build somewhere other than ./build.
+set -e
+
+project=storecast
+project_dir=$(cd "$(dirname "$0")" && pwd)
+build_dir=${build_dir:-"$project_dir/build"}
+CXX=${CXX:-c++}
+
+mkdir -p "$build_dir" "$project_dir/bin"
+
+# The SIMD kernels have to match the scalar ones bit for bit, so multiplies and adds must not be
+# fused into FMAs, which round differently. That's what /fp:precise does on the MSVC side.
+COMPILER_FLAGS="-std=c++14 -O2 -g -pthread -ffp-contract=off -Wall -Wextra\
+ -Wno-unused-parameter -Wno-sign-compare -Wno-missing-field-initializers -I$project_dir/src"
+
+sources="
+ obj_import.cpp
+ mesh.cpp
+ mapped_file.cpp
+ parse_number.cpp
+ parallel.cpp
+ vertex_dedup.cpp
+ mesh_cache.cpp
+ triangulate.cpp
+ mesh_optimize.cpp
+ mesh_quantize.cpp
+ mesh_soa.cpp
+ meshlet.cpp
+ simplify.cpp
+ mesh_codec.cpp
+ synthetic_obj.cpp
+ import_stats.cpp
+ memory_arena.cpp
+ thread_pool.cpp
+ batch_import.cpp
+ pipelined_reader.cpp
+ bvh.cpp
+ normal_generation.cpp"
+source_paths=""
+for source in $sources; do
+  source_paths="$source_paths $project_dir/src/$source"
+done
+
+echo "------- $project ---------------------------------------------------------"
+# The tests check that imports into an arena don't allocate, and the bench counts allocations
+# for its --trace output.
+$CXX $COMPILER_FLAGS -DSTORECAST_COUNT_ALLOCATIONS -o "$build_dir/$project" \
+  "$project_dir/src/main.cpp" "$project_dir/src/tests.cpp" $source_paths
+echo "------- ${project}_bench ---------------------------------------------------"
+$CXX $COMPILER_FLAGS -DSTORECAST_COUNT_ALLOCATIONS -o "$build_dir/${project}_bench" \
+  "$project_dir/src/bench.cpp" $source_paths
+
+cp "$build_dir/$project" "$build_dir/${project}_bench" "$project_dir/bin/"
+
+echo Running tests
+cd "$project_dir/bin" && "./$project"
@@ -0,0 +1,243 @@
+#include "batch_import.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+
+namespace storecast
+{
+using std::string;
+using std::vector;
+
+namespace {
+f64 get_seconds()
+{
+  using namespace std::chrono;
+  return duration<f64>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool has_obj_extension(const string& Filename)
+{
+  if (Filename.size() < 4) {
+    return false;
+  }
+  auto Extension = Filename.substr(Filename.size() - 4);
+  for (auto& C: Extension) {
+    C = static_cast<char>(tolower(static_cast<unsigned char>(C)));
+  }
+  return Extension == ".obj";
+}
+
+// Returns false if there's no such file or directory.
+bool get_file_info(const string& Path, bool& IsDirectory, u64& Size)
+{
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA Info;
+  if (!GetFileAttributesExA(Path.c_str(), GetFileExInfoStandard, &Info)) {
+    return false;
+  }
+  IsDirectory = (Info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+  Size = (static_cast<u64>(Info.nFileSizeHigh) << 32) | Info.nFileSizeLow;
+#else
+  struct stat Info;
+  if (stat(Path.c_str(), &Info) != 0) {
+    return false;
+  }
+  IsDirectory = S_ISDIR(Info.st_mode);
+  Size = static_cast<u64>(Info.st_size);
+#endif
+  return true;
+}
+
+// The names in the directory, without "." and "..".
+vector<string> list_directory(const string& Directory)
+{
+  vector<string> Names;
+#ifdef _WIN32
+  WIN32_FIND_DATAA Entry;
+  auto Handle = FindFirstFileA((Directory + "\\*").c_str(), &Entry);
+  if (Handle == INVALID_HANDLE_VALUE) {
+    return Names;
+  }
+  do {
+    Names.push_back(Entry.cFileName);
+  } while (FindNextFileA(Handle, &Entry));
+  FindClose(Handle);
+#else
+  auto Handle = opendir(Directory.c_str());
+  if (!Handle) {
+    return Names;
+  }
+  while (auto Entry = readdir(Handle)) {
+    Names.push_back(Entry->d_name);
+  }
+  closedir(Handle);
+#endif
+  Names.erase(std::remove_if(Names.begin(), Names.end(),
+      [](const string& Name) { return Name == "." || Name == ".."; }), Names.end());
+  return Names;
+}
+
+void add_obj_files(const string& Directory, vector<string>& Filenames)
+{
+  for (auto& Name: list_directory(Directory)) {
+    auto Path = Directory + "/" + Name;
+    bool IsDirectory = false;
+    u64 Size = 0;
+    if (!get_file_info(Path, IsDirectory, Size)) {
+      continue;
+    }
+    if (IsDirectory) {
+      add_obj_files(Path, Filenames);
+    } else if (has_obj_extension(Name)) {
+      Filenames.push_back(Path);
+    }
+  }
+}
+
+void import_obj_file(batch_file_result& Result, const batch_import_options& Options)
+{
+  try {
+    mapped_file File(Result.Filename);
+    if (!File.Data && Result.NumBytes > 0) {
+      return;
+    }
+    auto ParseOptions = Options.ParseOptions;
+    ParseOptions.NumThreads = 0;
+    ParseOptions.Stats = nullptr;
+    auto ConvertOptions = Options.ConvertOptions;
+    ConvertOptions.NumThreads = 0;
+    ConvertOptions.Stats = nullptr;
+
+    auto Start = get_seconds();
+    auto Obj = parse_obj(File.Data, File.Size, ParseOptions);
+    auto Parsed = get_seconds();
+    auto Mesh = convert_to_mesh(Obj, ConvertOptions);
+    Obj = obj_file_data();
+    auto Converted = get_seconds();
+    Result.DrawCommands = get_draw_command_list(Mesh);
+    auto End = get_seconds();
+
+    Result.NumFaces = (Mesh.TriangleIndices.size() / 3) + (Mesh.QuadIndices.size() / 4);
+    Result.NumVertices = Mesh.Vertices.size();
+    Result.ParseSeconds = Parsed - Start;
+    Result.ConvertSeconds = Converted - Parsed;
+    Result.DrawCommandSeconds = End - Converted;
+    if (Options.OnMesh) {
+      Options.OnMesh(Result.Filename, Mesh);
+    }
+    Result.Succeeded = true;
+  } catch (const std::bad_alloc&) {
+    Result.DrawCommands.clear();
+  }
+}
+} // anonymous namespace
+
+vector<string> find_obj_files(const string& Path)
+{
+  vector<string> Filenames;
+  bool IsDirectory = false;
+  u64 Size = 0;
+  if (!get_file_info(Path, IsDirectory, Size) || !IsDirectory) {
+    Filenames.push_back(Path);
+    return Filenames;
+  }
+  add_obj_files(Path, Filenames);
+  std::sort(Filenames.begin(), Filenames.end());
+  return Filenames;
+}
+
+vector<batch_file_result> import_obj_files(const vector<string>& Filenames,
+    const batch_import_options& Options)
+{
+  vector<batch_file_result> Results(Filenames.size());
+  vector<size_t> Order;
+  for (size_t I = 0; I < Filenames.size(); ++I) {
+    Results[I].Filename = Filenames[I];
+    bool IsDirectory = false;
+    // Missing files and directories fail without a task.
+    if (get_file_info(Filenames[I], IsDirectory, Results[I].NumBytes) && !IsDirectory) {
+      Order.push_back(I);
+    } else {
+      Results[I].NumBytes = 0;
+    }
+  }
+  // Largest first: a large file that starts last would keep one thread busy long after the others
+  // ran out of work.
+  std::stable_sort(Order.begin(), Order.end(),
+      [&](size_t L, size_t R) { return Results[L].NumBytes > Results[R].NumBytes; });
+
+  thread_pool Pool(Options.NumThreads);
+  thread_pool::task_group Group;
+  for (auto I: Order) {
+    auto& Result = Results[I];
+    Pool.submit(Group, [&Result, &Options] { import_obj_file(Result, Options); });
+  }
+  Pool.wait(Group);
+  return Results;
+}
+
+void print_batch_summary(std::ostream& Out, const vector<batch_file_result>& Results,
+    f64 WallSeconds)
+{
+  size_t NameWidth = 4;
+  for (auto& Result: Results) {
+    NameWidth = std::max(NameWidth, Result.Filename.size());
+  }
+  NameWidth = std::min<size_t>(NameWidth, 60);
+
+  char Line[256];
+  snprintf(Line, sizeof(Line), "%-*s %10s %10s %10s %10s %9s\n", static_cast<i32>(NameWidth),
+      "file", "MB", "faces", "vertices", "seconds", "MB/s");
+  Out << Line;
+  u64 NumBytes = 0;
+  u64 NumFaces = 0;
+  i32 NumFailed = 0;
+  for (auto& Result: Results) {
+    // Long paths keep their end, which has the file name.
+    auto Name = Result.Filename;
+    if (Name.size() > NameWidth) {
+      Name = "..." + Name.substr(Name.size() - NameWidth + 3);
+    }
+    if (!Result.Succeeded) {
+      snprintf(Line, sizeof(Line), "%-*s failed\n", static_cast<i32>(NameWidth), Name.c_str());
+      Out << Line;
+      ++NumFailed;
+      continue;
+    }
+    auto Seconds = std::max(Result.get_seconds(), 1e-9);
+    snprintf(Line, sizeof(Line), "%-*s %10.2f %10llu %10llu %10.4f %9.1f\n",
+        static_cast<i32>(NameWidth), Name.c_str(), static_cast<f64>(Result.NumBytes) / 1e6,
+        static_cast<unsigned long long>(Result.NumFaces),
+        static_cast<unsigned long long>(Result.NumVertices), Result.get_seconds(),
+        static_cast<f64>(Result.NumBytes) / 1e6 / Seconds);
+    Out << Line;
+    NumBytes += Result.NumBytes;
+    NumFaces += Result.NumFaces;
+  }
+
+  auto Seconds = std::max(WallSeconds, 1e-9);
+  snprintf(Line, sizeof(Line), "%zu files, %d failed, %.2f MB, %llu faces in %.3f s: "
+      "%.1f MB/s, %.0f faces/s\n", Results.size(), NumFailed, static_cast<f64>(NumBytes) / 1e6,
+      static_cast<unsigned long long>(NumFaces), WallSeconds,
+      static_cast<f64>(NumBytes) / 1e6 / Seconds, static_cast<f64>(NumFaces) / Seconds);
+  Out << Line;
+}
+
+} // namespace storecast
@@ -0,0 +1,58 @@
+#pragma once
+#include "defines.hpp"
+#include "mesh.hpp"
+#include "obj_import.hpp"
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace storecast
+{
+
+// Imports many OBJ files in one process, e.g. all assets of a project. Every file is a task on a
+// work-stealing thread_pool, and the parallel parts of parse_obj and convert_to_mesh run on the
+// same pool, so that a few huge files keep all threads busy just like many tiny ones do.
+
+struct batch_import_options {
+  // 0 means one per hardware thread.
+  i32 NumThreads = 0;
+  // Used for every file, except for their NumThreads and Stats. Large files are always split
+  // into tasks for the pool.
+  obj_parse_options ParseOptions;
+  obj_convert_options ConvertOptions;
+  // Called on a pool thread with every mesh, e.g. to write it somewhere. It may be called from
+  // several threads at once.
+  std::function<void(const std::string& Filename, mesh& Mesh)> OnMesh;
+};
+
+struct batch_file_result {
+  std::string Filename;
+  // False if the file couldn't be read, or there wasn't enough memory to import it.
+  bool Succeeded = false;
+  u64 NumBytes = 0;
+  u64 NumFaces = 0;
+  u64 NumVertices = 0;
+  f64 ParseSeconds = 0.0;
+  f64 ConvertSeconds = 0.0;
+  f64 DrawCommandSeconds = 0.0;
+  std::vector<draw_command> DrawCommands;
+
+  f64 get_seconds() const { return ParseSeconds + ConvertSeconds + DrawCommandSeconds; }
+};
+
+// If Path is a directory, the .obj files in it and in all directories below it, sorted by name.
+// Otherwise just Path.
+std::vector<std::string> find_obj_files(const std::string& Path);
+
+// Runs parse_obj, convert_to_mesh and get_draw_command_list on every file. The results are in the
+// order of Filenames. Larger files start first, so that no large file is left for the end.
+std::vector<batch_file_result> import_obj_files(const std::vector<std::string>& Filenames,
+    const batch_import_options& Options = batch_import_options());
+
+// One line per file with its size, time and throughput, followed by the totals. WallSeconds is
+// the time the whole batch took.
+void print_batch_summary(std::ostream& Out, const std::vector<batch_file_result>& Results,
+    f64 WallSeconds);
+
+} // namespace storecast
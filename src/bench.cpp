@@ -0,0 +1,284 @@
+// Benchmarks the import pipeline on synthetic OBJ files, and prints one JSON object per line
+// and stage, so that results can be collected and compared by scripts:
+//
+//   storecast_bench --faces 1000000 --topology grid --format v/vt/vn
+//
+// Without --topology or --format, every combination runs. The generated files are deleted
+// afterwards, unless --keep is given. --trace writes the phases of all runs as a Chrome trace,
+// see import_stats.hpp.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "bvh.hpp"
+#include "defines.hpp"
+#include "import_stats.hpp"
+#include "mapped_file.hpp"
+#include "mesh.hpp"
+#include "obj_import.hpp"
+#include "synthetic_obj.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace storecast
+{
+using std::string;
+using std::vector;
+
+namespace {
+struct bench_options {
+  u64 NumFaces = 1000000;
+  vector<synthetic_topology> Topologies = {
+      synthetic_topology::GRID, synthetic_topology::SPHERE, synthetic_topology::RANDOM};
+  vector<obj_face_format> FaceFormats = {obj_face_format::V, obj_face_format::V_VT,
+      obj_face_format::V_VN, obj_face_format::V_VT_VN};
+  i32 VerticesPerFace = 4;
+  i32 NumThreads = 1;
+  // Each stage runs this often, and the fastest run counts.
+  i32 NumRepeats = 1;
+  string Directory = ".";
+  bool KeepFiles = false;
+  // Empty for no trace.
+  string TraceFilename;
+};
+
+// The most memory the process has had resident so far, in bytes.
+u64 get_peak_rss()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS Counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters))) {
+    return 0;
+  }
+  return Counters.PeakWorkingSetSize;
+#else
+  rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return static_cast<u64>(Usage.ru_maxrss);
+#else
+  // Linux counts in kilobytes.
+  return static_cast<u64>(Usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+f64 get_seconds()
+{
+  using namespace std::chrono;
+  return duration<f64>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs Function NumRepeats times, and returns the fastest time. Result gets the last run's
+// result, so that the next stage can use it.
+template <class result_type, class function>
+f64 time_stage(i32 NumRepeats, result_type& Result, const function& Function)
+{
+  f64 Best = 0.0;
+  for (i32 I = 0; I < NumRepeats; ++I) {
+    f64 Start = get_seconds();
+    Result = Function();
+    f64 Seconds = get_seconds() - Start;
+    if (I == 0 || Seconds < Best) {
+      Best = Seconds;
+    }
+  }
+  return Best;
+}
+
+void print_result(const synthetic_obj_options& Case, i32 NumThreads, const char* Stage,
+    u64 NumBytes, f64 Seconds)
+{
+  // MB/s are always relative to the size of the OBJ text, so the stages can be compared.
+  f64 SafeSeconds = Seconds > 0.0 ? Seconds : 1e-9;
+  printf("{\"topology\": \"%s\", \"format\": \"%s\", \"vertices_per_face\": %d, "
+      "\"faces\": %llu, \"threads\": %d, \"stage\": \"%s\", \"bytes\": %llu, "
+      "\"seconds\": %.6f, \"mb_per_s\": %.2f, \"faces_per_s\": %.0f, "
+      "\"peak_rss_bytes\": %llu}\n",
+      get_name(Case.Topology), get_name(Case.FaceFormat), Case.VerticesPerFace,
+      static_cast<unsigned long long>(Case.NumFaces), NumThreads, Stage,
+      static_cast<unsigned long long>(NumBytes), Seconds,
+      static_cast<f64>(NumBytes) / 1e6 / SafeSeconds,
+      static_cast<f64>(Case.NumFaces) / SafeSeconds,
+      static_cast<unsigned long long>(get_peak_rss()));
+  fflush(stdout);
+}
+
+bool run_case(const synthetic_obj_options& Case, const bench_options& Options,
+    import_stats* Stats)
+{
+  string Filename = Options.Directory + "/storecast_bench_" + get_name(Case.Topology) + "_"
+      + std::to_string(Case.NumFaces) + "_" + std::to_string(Case.VerticesPerFace) + "_"
+      + std::to_string(static_cast<i32>(Case.FaceFormat)) + ".obj";
+  f64 Start = get_seconds();
+  if (!write_synthetic_obj_file(Filename, Case)) {
+    fprintf(stderr, "Can't write %s\n", Filename.c_str());
+    return false;
+  }
+  f64 GenerateSeconds = get_seconds() - Start;
+
+  {
+    mapped_file File(Filename);
+    u64 NumBytes = File.Size;
+    print_result(Case, Options.NumThreads, "generate", NumBytes, GenerateSeconds);
+
+    obj_parse_options ParseOptions;
+    ParseOptions.NumThreads = Options.NumThreads;
+    ParseOptions.Stats = Stats;
+    obj_file_data Obj;
+    f64 Seconds = time_stage(Options.NumRepeats, Obj,
+        [&] { return parse_obj(File.Data, File.Size, ParseOptions); });
+    print_result(Case, Options.NumThreads, "parse_obj", NumBytes, Seconds);
+
+    // The same through a stream, with reading and parsing overlapped.
+    obj_file_data StreamedObj;
+    Seconds = time_stage(Options.NumRepeats, StreamedObj, [&] {
+      std::ifstream In(Filename, std::ios::binary);
+      return parse_obj(In, ParseOptions);
+    });
+    print_result(Case, Options.NumThreads, "parse_obj_stream", NumBytes, Seconds);
+
+    obj_convert_options ConvertOptions;
+    ConvertOptions.NumThreads = Options.NumThreads;
+    ConvertOptions.Stats = Stats;
+    mesh Mesh;
+    Seconds = time_stage(
+        Options.NumRepeats, Mesh, [&] { return convert_to_mesh(Obj, ConvertOptions); });
+    print_result(Case, Options.NumThreads, "convert_to_mesh", NumBytes, Seconds);
+
+    // Both of the above in a single pass.
+    mesh FusedMesh;
+    Seconds = time_stage(Options.NumRepeats, FusedMesh,
+        [&] { return import_obj_to_mesh(File.Data, File.Size, ConvertOptions); });
+    print_result(Case, Options.NumThreads, "import_obj_to_mesh", NumBytes, Seconds);
+
+    // With smooth normals for the face vertices without vn.
+    obj_convert_options NormalsOptions = ConvertOptions;
+    NormalsOptions.Normals.Mode = normal_options::mode::SMOOTH;
+    mesh MeshWithNormals;
+    Seconds = time_stage(Options.NumRepeats, MeshWithNormals,
+        [&] { return convert_to_mesh(Obj, NormalsOptions); });
+    print_result(Case, Options.NumThreads, "convert_to_mesh_normals", NumBytes, Seconds);
+
+    vector<draw_command> Commands;
+    Seconds = time_stage(
+        Options.NumRepeats, Commands, [&] { return get_draw_command_list(Mesh); });
+    print_result(Case, Options.NumThreads, "get_draw_command_list", NumBytes, Seconds);
+
+    bvh_options BvhOptions;
+    BvhOptions.NumThreads = Options.NumThreads;
+    bvh Bvh;
+    Seconds = time_stage(Options.NumRepeats, Bvh, [&] { return build_bvh(Mesh, BvhOptions); });
+    print_result(Case, Options.NumThreads, "build_bvh", NumBytes, Seconds);
+  }
+
+  if (!Options.KeepFiles) {
+    remove(Filename.c_str());
+  }
+  return true;
+}
+
+bool parse_arguments(i32 NumArguments, char** Arguments, bench_options& Options)
+{
+  for (i32 I = 1; I < NumArguments; ++I) {
+    string Name = Arguments[I];
+    if (Name == "--keep") {
+      Options.KeepFiles = true;
+      continue;
+    }
+    if (Name == "--triangles") {
+      Options.VerticesPerFace = 3;
+      continue;
+    }
+    if (I + 1 == NumArguments) {
+      return false;
+    }
+    string Value = Arguments[++I];
+    if (Name == "--faces") {
+      Options.NumFaces = strtoull(Value.c_str(), nullptr, 10);
+    } else if (Name == "--threads") {
+      Options.NumThreads = atoi(Value.c_str());
+    } else if (Name == "--repeat") {
+      Options.NumRepeats = std::max(1, atoi(Value.c_str()));
+    } else if (Name == "--dir") {
+      Options.Directory = Value;
+    } else if (Name == "--trace") {
+      Options.TraceFilename = Value;
+    } else if (Name == "--topology") {
+      Options.Topologies.clear();
+      for (auto Topology: {synthetic_topology::GRID, synthetic_topology::SPHERE,
+               synthetic_topology::RANDOM}) {
+        if (Value == get_name(Topology)) {
+          Options.Topologies.push_back(Topology);
+        }
+      }
+      if (Options.Topologies.empty()) {
+        return false;
+      }
+    } else if (Name == "--format") {
+      Options.FaceFormats.clear();
+      for (auto Format: {obj_face_format::V, obj_face_format::V_VT, obj_face_format::V_VN,
+               obj_face_format::V_VT_VN}) {
+        if (Value == get_name(Format)) {
+          Options.FaceFormats.push_back(Format);
+        }
+      }
+      if (Options.FaceFormats.empty()) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+} // anonymous namespace
+} // namespace storecast
+
+int main(int argc, char *argv[])
+{
+  using namespace storecast;
+  bench_options Options;
+  if (!parse_arguments(argc, argv, Options)) {
+    fprintf(stderr,
+        "Usage: %s [--faces N] [--topology grid|sphere|random]\n"
+        "    [--format v|v/vt|v//vn|v/vt/vn] [--triangles] [--threads N] [--repeat N]\n"
+        "    [--dir PATH] [--keep] [--trace FILE]\n",
+        argv[0]);
+    return 2;
+  }
+  import_stats Stats;
+  auto StatsPointer = Options.TraceFilename.empty() ? nullptr : &Stats;
+  for (auto Topology: Options.Topologies) {
+    for (auto Format: Options.FaceFormats) {
+      synthetic_obj_options Case;
+      Case.Topology = Topology;
+      Case.FaceFormat = Format;
+      Case.NumFaces = Options.NumFaces;
+      Case.VerticesPerFace = Options.VerticesPerFace;
+      if (!run_case(Case, Options, StatsPointer)) {
+        return 1;
+      }
+    }
+  }
+  if (StatsPointer && !write_chrome_trace(Options.TraceFilename, Stats)) {
+    fprintf(stderr, "Can't write %s\n", Options.TraceFilename.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,557 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define STORECAST_X64 1
+#include <emmintrin.h>
+#endif
+
+#include "parallel.hpp"
+
+namespace storecast
+{
+using std::vector;
+
+namespace {
+const i32 NumBins = 16;
+// Subtrees with at most this many faces are built as one task. It doesn't depend on the number
+// of threads, so that neither does the tree.
+const i32 FacesPerTask = 1 << 14;
+
+// The faces are reordered during the build, so they carry their index along.
+struct build_face {
+  aabb Bounds;
+  vec3 Centroid;
+  i32 Index;
+};
+// Node of the binary tree that is built first. Leaves have Left == -1 and cover
+// Faces[First, First + Count).
+struct build_node {
+  aabb Bounds;
+  i32 Left;
+  i32 Right;
+  i32 First;
+  i32 Count;
+};
+struct build_task {
+  i32 Node;
+  i32 First;
+  i32 Count;
+};
+
+aabb get_empty_aabb()
+{
+  return {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+}
+void grow(aabb& Box, const vec3& Point)
+{
+  Box.Min = {std::min(Box.Min.X, Point.X), std::min(Box.Min.Y, Point.Y),
+      std::min(Box.Min.Z, Point.Z)};
+  Box.Max = {std::max(Box.Max.X, Point.X), std::max(Box.Max.Y, Point.Y),
+      std::max(Box.Max.Z, Point.Z)};
+}
+void grow(aabb& Box, const aabb& Other)
+{
+  Box.Min = {std::min(Box.Min.X, Other.Min.X), std::min(Box.Min.Y, Other.Min.Y),
+      std::min(Box.Min.Z, Other.Min.Z)};
+  Box.Max = {std::max(Box.Max.X, Other.Max.X), std::max(Box.Max.Y, Other.Max.Y),
+      std::max(Box.Max.Z, Other.Max.Z)};
+}
+// Half the surface area, which is all the SAH needs. 0 for empty boxes.
+f32 get_half_area(const aabb& Box)
+{
+  vec3 Size = Box.Max - Box.Min;
+  if (Size.X < 0.f || Size.Y < 0.f || Size.Z < 0.f) {
+    return 0.f;
+  }
+  return Size.X * Size.Y + Size.Y * Size.Z + Size.Z * Size.X;
+}
+bool overlaps(const aabb& A, const aabb& B)
+{
+  return A.Min.X <= B.Max.X && A.Max.X >= B.Min.X && A.Min.Y <= B.Max.Y && A.Max.Y >= B.Min.Y
+      && A.Min.Z <= B.Max.Z && A.Max.Z >= B.Min.Z;
+}
+
+struct bvh_builder {
+  vector<build_face>& Faces;
+  i32 MaxLeafFaces;
+
+  // Builds the subtree over Faces[First, First + Count) into Nodes, reordering that range, and
+  // returns the index of its root. With Tasks set, subtrees with at most FacesPerTask faces are
+  // left for later: they only get their root, which is added to Tasks.
+  i32 build(i32 First, i32 Count, vector<build_node>& Nodes, vector<build_task>* Tasks) const
+  {
+    auto Index = static_cast<i32>(Nodes.size());
+    aabb Bounds = get_empty_aabb();
+    aabb CentroidBounds = get_empty_aabb();
+    for (i32 I = First; I < First + Count; ++I) {
+      grow(Bounds, Faces[I].Bounds);
+      grow(CentroidBounds, Faces[I].Centroid);
+    }
+    Nodes.push_back({Bounds, -1, -1, First, Count});
+    if (Tasks && Count <= FacesPerTask) {
+      Tasks->push_back({Index, First, Count});
+      return Index;
+    }
+    if (Count <= 1) {
+      return Index;
+    }
+
+    // Sort the centroids into bins along each axis, and try the splits between the bins. The
+    // cost of a side is its area times its number of faces.
+    i32 BestAxis = -1;
+    i32 BestSplit = 0;
+    f32 BestCost = FLT_MAX;
+    for3(Axis) {
+      auto Min = CentroidBounds.Min.Data[Axis];
+      auto Extent = CentroidBounds.Max.Data[Axis] - Min;
+      if (!(Extent > 0.f)) {
+        continue;
+      }
+      auto Scale = static_cast<f32>(NumBins) / Extent;
+      i32 BinCounts[NumBins] = {};
+      aabb BinBounds[NumBins];
+      std::fill(BinBounds, BinBounds + NumBins, get_empty_aabb());
+      for (i32 I = First; I < First + Count; ++I) {
+        auto& Face = Faces[I];
+        auto Bin = get_bin(Face.Centroid.Data[Axis], Min, Scale);
+        ++BinCounts[Bin];
+        grow(BinBounds[Bin], Face.Bounds);
+      }
+      // RightCosts[Split] is the cost of bins [Split, NumBins).
+      f32 RightCosts[NumBins];
+      aabb RightBounds = get_empty_aabb();
+      i32 RightCount = 0;
+      for (i32 Bin = NumBins - 1; Bin > 0; --Bin) {
+        grow(RightBounds, BinBounds[Bin]);
+        RightCount += BinCounts[Bin];
+        RightCosts[Bin] = get_half_area(RightBounds) * RightCount;
+      }
+      aabb LeftBounds = get_empty_aabb();
+      i32 LeftCount = 0;
+      for (i32 Split = 1; Split < NumBins; ++Split) {
+        grow(LeftBounds, BinBounds[Split - 1]);
+        LeftCount += BinCounts[Split - 1];
+        auto Cost = get_half_area(LeftBounds) * LeftCount + RightCosts[Split];
+        if (LeftCount > 0 && LeftCount < Count && Cost < BestCost) {
+          BestAxis = Axis;
+          BestSplit = Split;
+          BestCost = Cost;
+        }
+      }
+    }
+
+    // Traversing a node costs about as much as testing a face.
+    auto LeafCost = get_half_area(Bounds) * Count;
+    if (Count <= MaxLeafFaces && (BestAxis < 0 || LeafCost <= get_half_area(Bounds) + BestCost)) {
+      return Index;
+    }
+    auto Begin = Faces.begin() + First;
+    auto Middle = Begin + Count / 2;
+    if (BestAxis >= 0) {
+      auto Min = CentroidBounds.Min.Data[BestAxis];
+      auto Scale = static_cast<f32>(NumBins) / (CentroidBounds.Max.Data[BestAxis] - Min);
+      Middle = std::partition(Begin, Begin + Count, [&](const build_face& Face) {
+        return get_bin(Face.Centroid.Data[BestAxis], Min, Scale) < BestSplit;
+      });
+    }
+    // Otherwise all centroids are the same, and any split is as good as any other.
+    auto LeftCount = static_cast<i32>(Middle - Begin);
+    auto Left = build(First, LeftCount, Nodes, Tasks);
+    auto Right = build(First + LeftCount, Count - LeftCount, Nodes, Tasks);
+    Nodes[Index].Left = Left;
+    Nodes[Index].Right = Right;
+    return Index;
+  }
+
+  static i32 get_bin(f32 Centroid, f32 Min, f32 Scale)
+  {
+    return std::min(static_cast<i32>((Centroid - Min) * Scale), NumBins - 1);
+  }
+};
+
+// Turns the binary subtree at Index into nodes with up to four children, by pulling up the
+// children of the largest inner children. Returns the index of the new node.
+i32 collapse(const vector<build_node>& Nodes, i32 Index, i32 Depth, bvh& Result)
+{
+  auto& Root = Nodes[Index];
+  i32 Children[4] = {Index, -1, -1, -1};
+  i32 NumChildren = 1;
+  if (Root.Left >= 0) {
+    Children[0] = Root.Left;
+    Children[1] = Root.Right;
+    NumChildren = 2;
+  }
+  while (NumChildren < 4) {
+    i32 Largest = -1;
+    f32 LargestArea = -1.f;
+    for (i32 I = 0; I < NumChildren; ++I) {
+      auto& Child = Nodes[Children[I]];
+      if (Child.Left >= 0 && get_half_area(Child.Bounds) > LargestArea) {
+        Largest = I;
+        LargestArea = get_half_area(Child.Bounds);
+      }
+    }
+    if (Largest < 0) {
+      break;
+    }
+    auto& Child = Nodes[Children[Largest]];
+    Children[Largest] = Child.Left;
+    Children[NumChildren++] = Child.Right;
+  }
+
+  auto NodeIndex = static_cast<i32>(Result.Nodes.size());
+  bvh_node Node;
+  for4(I) {
+    Node.MinX[I] = Node.MinY[I] = Node.MinZ[I] = FLT_MAX;
+    Node.MaxX[I] = Node.MaxY[I] = Node.MaxZ[I] = -FLT_MAX;
+    Node.Children[I] = -1;
+    Node.NumFaces[I] = 0;
+  }
+  Result.Nodes.push_back(Node);
+  Result.Depth = std::max(Result.Depth, Depth);
+  for (i32 I = 0; I < NumChildren; ++I) {
+    auto& Child = Nodes[Children[I]];
+    auto ChildIndex = Child.First;
+    if (Child.Left >= 0) {
+      ChildIndex = collapse(Nodes, Children[I], Depth + 1, Result);
+    }
+    auto& Written = Result.Nodes[NodeIndex];
+    Written.MinX[I] = Child.Bounds.Min.X;
+    Written.MinY[I] = Child.Bounds.Min.Y;
+    Written.MinZ[I] = Child.Bounds.Min.Z;
+    Written.MaxX[I] = Child.Bounds.Max.X;
+    Written.MaxY[I] = Child.Bounds.Max.Y;
+    Written.MaxZ[I] = Child.Bounds.Max.Z;
+    Written.Children[I] = ChildIndex;
+    Written.NumFaces[I] = Child.Left >= 0 ? 0 : Child.Count;
+  }
+  return NodeIndex;
+}
+
+// Moeller-Trumbore, without culling back faces.
+bool intersect_triangle(const vec3& P0, const vec3& P1, const vec3& P2, const ray& Ray, f32& T)
+{
+  auto Edge1 = P1 - P0;
+  auto Edge2 = P2 - P0;
+  auto P = cross(Ray.Direction, Edge2);
+  auto Determinant = dot(Edge1, P);
+  if (Determinant == 0.f) {
+    return false;
+  }
+  auto InverseDeterminant = 1.f / Determinant;
+  auto ToOrigin = Ray.Origin - P0;
+  auto U = dot(ToOrigin, P) * InverseDeterminant;
+  if (U < 0.f || U > 1.f) {
+    return false;
+  }
+  auto Q = cross(ToOrigin, Edge1);
+  auto V = dot(Ray.Direction, Q) * InverseDeterminant;
+  if (V < 0.f || U + V > 1.f) {
+    return false;
+  }
+  T = dot(Edge2, Q) * InverseDeterminant;
+  return true;
+}
+
+// The nearest hit of either triangle that isn't behind the origin. The triangles of a quad that
+// isn't planar can both be in the way, and the first one can be hit behind the origin while the
+// second one is hit in front of it.
+bool intersect_face(const bvh::face& Face, const ray& Ray, f32& T)
+{
+  auto& C = Face.Corners;
+  bool Found = false;
+  f32 Nearest = 0.f;
+  for (i32 Half = 0; Half < (Face.Face.IsQuad ? 2 : 1); ++Half) {
+    f32 TriangleT;
+    if (intersect_triangle(C[0], C[Half + 1], C[Half + 2], Ray, TriangleT) && TriangleT >= 0.f
+        && (!Found || TriangleT < Nearest)) {
+      Found = true;
+      Nearest = TriangleT;
+    }
+  }
+  T = Nearest;
+  return Found;
+}
+
+struct stack_entry {
+  i32 Child;
+  i32 NumFaces;
+  f32 Near;
+};
+
+// The ray in the form the node tests need. Tiny direction components are replaced by tiny
+// non-zero ones, so that the reciprocals are finite, and the slab tests can't produce NaN.
+struct prepared_ray {
+  vec3 Origin;
+  vec3 InverseDirection;
+};
+prepared_ray prepare_ray(const ray& Ray)
+{
+  prepared_ray Result = {Ray.Origin, {0.f, 0.f, 0.f}};
+  for3(Axis) {
+    auto Direction = Ray.Direction.Data[Axis];
+    if (std::fabs(Direction) < 1e-20f) {
+      Direction = Direction < 0.f ? -1e-20f : 1e-20f;
+    }
+    Result.InverseDirection.Data[Axis] = 1.f / Direction;
+  }
+  return Result;
+}
+
+// In the operand order of minps and maxps.
+f32 min_f32(f32 A, f32 B) { return A < B ? A : B; }
+f32 max_f32(f32 A, f32 B) { return A > B ? A : B; }
+
+// Slab tests of the ray against the four child boxes, limited to [0, MaxT]. Sets Near to the
+// distance at which the ray enters each box, and returns a bit per child that is hit.
+i32 test_node_scalar(const bvh_node& Node, const prepared_ray& Ray, f32 MaxT, f32 Near[4])
+{
+  auto& O = Ray.Origin;
+  auto& D = Ray.InverseDirection;
+  i32 Mask = 0;
+  for4(I) {
+    f32 X0 = (Node.MinX[I] - O.X) * D.X;
+    f32 X1 = (Node.MaxX[I] - O.X) * D.X;
+    f32 Y0 = (Node.MinY[I] - O.Y) * D.Y;
+    f32 Y1 = (Node.MaxY[I] - O.Y) * D.Y;
+    f32 Z0 = (Node.MinZ[I] - O.Z) * D.Z;
+    f32 Z1 = (Node.MaxZ[I] - O.Z) * D.Z;
+    f32 Enter = max_f32(max_f32(min_f32(X0, X1), min_f32(Y0, Y1)), max_f32(min_f32(Z0, Z1), 0.f));
+    f32 Exit = min_f32(min_f32(max_f32(X0, X1), max_f32(Y0, Y1)), min_f32(max_f32(Z0, Z1), MaxT));
+    Near[I] = Enter;
+    if (Node.Children[I] >= 0 && Enter <= Exit) {
+      Mask |= 1 << I;
+    }
+  }
+  return Mask;
+}
+
+#ifdef STORECAST_X64
+i32 test_node_sse2(const bvh_node& Node, const prepared_ray& Ray, f32 MaxT, f32 Near[4])
+{
+  auto& O = Ray.Origin;
+  auto& D = Ray.InverseDirection;
+  __m128 OX = _mm_set1_ps(O.X);
+  __m128 OY = _mm_set1_ps(O.Y);
+  __m128 OZ = _mm_set1_ps(O.Z);
+  __m128 DX = _mm_set1_ps(D.X);
+  __m128 DY = _mm_set1_ps(D.Y);
+  __m128 DZ = _mm_set1_ps(D.Z);
+  __m128 X0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(Node.MinX), OX), DX);
+  __m128 X1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(Node.MaxX), OX), DX);
+  __m128 Y0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(Node.MinY), OY), DY);
+  __m128 Y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(Node.MaxY), OY), DY);
+  __m128 Z0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(Node.MinZ), OZ), DZ);
+  __m128 Z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(Node.MaxZ), OZ), DZ);
+  __m128 Enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(X0, X1), _mm_min_ps(Y0, Y1)),
+      _mm_max_ps(_mm_min_ps(Z0, Z1), _mm_setzero_ps()));
+  __m128 Exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(X0, X1), _mm_max_ps(Y0, Y1)),
+      _mm_min_ps(_mm_max_ps(Z0, Z1), _mm_set1_ps(MaxT)));
+  _mm_storeu_ps(Near, Enter);
+  __m128i Children = _mm_load_si128(reinterpret_cast<const __m128i*>(Node.Children));
+  __m128 IsUsed = _mm_castsi128_ps(_mm_cmpgt_epi32(Children, _mm_set1_epi32(-1)));
+  return _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(Enter, Exit), IsUsed));
+}
+#endif
+
+// Depth-first, nearest child first. With AnyHit, it returns at the first hit.
+template <class node_test>
+bool traverse(const bvh& Bvh, const ray& Ray, bool AnyHit, ray_hit& Hit, const node_test& Test)
+{
+  if (Bvh.Nodes.empty()) {
+    return false;
+  }
+  auto Prepared = prepare_ray(Ray);
+  // Every level adds at most three entries besides the one it replaces.
+  const i32 LocalStackSize = 64;
+  stack_entry LocalStack[LocalStackSize];
+  vector<stack_entry> LargeStack;
+  auto Stack = LocalStack;
+  if (3 * Bvh.Depth + 4 > LocalStackSize) {
+    LargeStack.resize(3 * Bvh.Depth + 4);
+    Stack = LargeStack.data();
+  }
+  i32 StackSize = 0;
+  Stack[StackSize++] = {0, 0, 0.f};
+  bool Found = false;
+  f32 Closest = Ray.MaxT;
+  while (StackSize > 0) {
+    auto Entry = Stack[--StackSize];
+    if (Entry.Near > Closest) {
+      continue;
+    }
+    if (Entry.NumFaces > 0) {
+      for (i32 I = Entry.Child; I < Entry.Child + Entry.NumFaces; ++I) {
+        f32 T;
+        auto& Face = Bvh.Faces[I];
+        if (intersect_face(Face, Ray, T) && (Found ? T < Closest : T <= Closest)) {
+          Found = true;
+          Closest = T;
+          Hit = {Face.Face, T};
+          if (AnyHit) {
+            return true;
+          }
+        }
+      }
+      continue;
+    }
+
+    auto& Node = Bvh.Nodes[Entry.Child];
+    f32 Near[4];
+    auto Mask = Test(Node, Prepared, Closest, Near);
+    // Push the farthest child first, so that the nearest one is visited next.
+    i32 Lanes[4];
+    i32 NumLanes = 0;
+    for4(I) {
+      if (Mask & (1 << I)) {
+        auto J = NumLanes++;
+        for (; J > 0 && Near[Lanes[J - 1]] < Near[I]; --J) {
+          Lanes[J] = Lanes[J - 1];
+        }
+        Lanes[J] = I;
+      }
+    }
+    for (i32 J = 0; J < NumLanes; ++J) {
+      auto Lane = Lanes[J];
+      Stack[StackSize++] = {Node.Children[Lane], Node.NumFaces[Lane], Near[Lane]};
+    }
+  }
+  return Found;
+}
+
+bool intersect(const bvh& Bvh, const ray& Ray, bool AnyHit, ray_hit& Hit, simd_level Level)
+{
+#ifdef STORECAST_X64
+  if (Level != simd_level::SCALAR) {
+    return traverse(Bvh, Ray, AnyHit, Hit, test_node_sse2);
+  }
+#endif
+  return traverse(Bvh, Ray, AnyHit, Hit, test_node_scalar);
+}
+} // anonymous namespace
+
+bvh build_bvh(const mesh& Mesh, const bvh_options& Options)
+{
+  bvh Result;
+  auto NumTriangles = static_cast<i32>(Mesh.TriangleIndices.size() / 3);
+  auto NumQuads = static_cast<i32>(Mesh.QuadIndices.size() / 4);
+  auto NumFaces = NumTriangles + NumQuads;
+  if (NumFaces == 0) {
+    return Result;
+  }
+  auto NumThreads = Options.NumThreads > 0 ? Options.NumThreads : get_num_hardware_threads();
+
+  auto get_face = [&](i32 Index) {
+    bool IsQuad = Index >= NumTriangles;
+    bvh::face Face;
+    Face.Face = {IsQuad ? Index - NumTriangles : Index, IsQuad};
+    auto Indices = IsQuad ? &Mesh.QuadIndices[4 * (Index - NumTriangles)]
+        : &Mesh.TriangleIndices[3 * Index];
+    for (i32 I = 0; I < (IsQuad ? 4 : 3); ++I) {
+      Face.Corners[I] = Mesh.Vertices[Indices[I]].Position;
+    }
+    Face.Corners[3] = IsQuad ? Face.Corners[3] : Face.Corners[2];
+    return Face;
+  };
+  const i32 FacesPerBoundsTask = 1 << 16;
+  auto NumBoundsTasks = (NumFaces + FacesPerBoundsTask - 1) / FacesPerBoundsTask;
+  vector<build_face> BuildFaces(NumFaces);
+  parallel_for(NumBoundsTasks, NumThreads, [&](i32 Task) {
+    auto End = std::min(NumFaces, (Task + 1) * FacesPerBoundsTask);
+    for (auto I = Task * FacesPerBoundsTask; I < End; ++I) {
+      auto Face = get_face(I);
+      aabb Bounds = get_empty_aabb();
+      for4(Corner) {
+        grow(Bounds, Face.Corners[Corner]);
+      }
+      BuildFaces[I] = {Bounds, (Bounds.Min + Bounds.Max) * 0.5f, I};
+    }
+  });
+
+  // The top of the tree is built here, and the subtrees below it in parallel, each into its own
+  // array. Then the subtrees are appended to the top, with their child indices shifted.
+  bvh_builder Builder = {BuildFaces, std::max(1, std::min(Options.MaxLeafFaces, 16))};
+  vector<build_node> Nodes;
+  vector<build_task> Tasks;
+  Builder.build(0, NumFaces, Nodes, &Tasks);
+  vector<vector<build_node>> TaskNodes(Tasks.size());
+  parallel_for(static_cast<i32>(Tasks.size()), NumThreads, [&](i32 I) {
+    Builder.build(Tasks[I].First, Tasks[I].Count, TaskNodes[I], nullptr);
+  });
+  for (size_t I = 0; I < Tasks.size(); ++I) {
+    auto Root = Tasks[I].Node;
+    auto Offset = static_cast<i32>(Nodes.size()) - 1;
+    auto shift = [&](i32 Child) {
+      return Child < 0 ? Child : (Child == 0 ? Root : Child + Offset);
+    };
+    for (auto& Node: TaskNodes[I]) {
+      Node.Left = shift(Node.Left);
+      Node.Right = shift(Node.Right);
+    }
+    Nodes[Root] = TaskNodes[I][0];
+    Nodes.insert(Nodes.end(), TaskNodes[I].begin() + 1, TaskNodes[I].end());
+    TaskNodes[I] = vector<build_node>();
+  }
+
+  Result.Nodes.reserve(Nodes.size() / 2 + 1);
+  collapse(Nodes, 0, 1, Result);
+  Result.Bounds = Nodes[0].Bounds;
+  Result.Faces.resize(NumFaces);
+  parallel_for(NumBoundsTasks, NumThreads, [&](i32 Task) {
+    auto End = std::min(NumFaces, (Task + 1) * FacesPerBoundsTask);
+    for (auto I = Task * FacesPerBoundsTask; I < End; ++I) {
+      Result.Faces[I] = get_face(BuildFaces[I].Index);
+    }
+  });
+  return Result;
+}
+
+bool intersect_closest(const bvh& Bvh, const ray& Ray, ray_hit& Hit, simd_level Level)
+{
+  return intersect(Bvh, Ray, false, Hit, Level);
+}
+
+bool intersect_any(const bvh& Bvh, const ray& Ray, simd_level Level)
+{
+  ray_hit Hit;
+  return intersect(Bvh, Ray, true, Hit, Level);
+}
+
+void find_overlapping_faces(const bvh& Bvh, const aabb& Box, vector<bvh_face>& Faces)
+{
+  if (Bvh.Nodes.empty() || !overlaps(Bvh.Bounds, Box)) {
+    return;
+  }
+  vector<i32> Stack(1, 0);
+  while (!Stack.empty()) {
+    auto& Node = Bvh.Nodes[Stack.back()];
+    Stack.pop_back();
+    for4(I) {
+      aabb ChildBounds = {{Node.MinX[I], Node.MinY[I], Node.MinZ[I]},
+          {Node.MaxX[I], Node.MaxY[I], Node.MaxZ[I]}};
+      if (Node.Children[I] < 0 || !overlaps(ChildBounds, Box)) {
+        continue;
+      }
+      if (Node.NumFaces[I] == 0) {
+        Stack.push_back(Node.Children[I]);
+        continue;
+      }
+      for (auto J = Node.Children[I]; J < Node.Children[I] + Node.NumFaces[I]; ++J) {
+        auto& Face = Bvh.Faces[J];
+        aabb Bounds = get_empty_aabb();
+        for4(Corner) {
+          grow(Bounds, Face.Corners[Corner]);
+        }
+        if (overlaps(Bounds, Box)) {
+          Faces.push_back(Face.Face);
+        }
+      }
+    }
+  }
+}
+
+} // namespace storecast
@@ -0,0 +1,94 @@
+#pragma once
+#include "defines.hpp"
+#include "math.hpp"
+#include "mesh.hpp"
+#include "mesh_soa.hpp"
+#include <vector>
+
+namespace storecast
+{
+
+// Bounding volume hierarchy over the faces of a mesh, for picking, baking and visibility rays,
+// and for finding the faces in a region. Without it, every query is a loop over all faces.
+//
+// The tree is built top-down with the surface area heuristic over binned centroids, and then
+// collapsed into a tree with four children per node. The child boxes of a node are stored as
+// one array per coordinate, so that a ray is tested against all four at once with SSE, and a
+// node takes exactly two cache lines.
+
+struct bvh_options {
+  // Number of threads for the build; 0 means one per hardware thread. The tree is the same for
+  // every number of threads.
+  i32 NumThreads = 1;
+  // Leaves hold at most this many faces, in [1, 16]. More faces per leaf make the tree smaller
+  // and the build faster, and the queries slower.
+  i32 MaxLeafFaces = 4;
+};
+
+// A face of the mesh: triangle Index is Mesh.TriangleIndices[3 * Index, 3 * Index + 3), quad
+// Index is Mesh.QuadIndices[4 * Index, 4 * Index + 4).
+struct bvh_face {
+  i32 Index;
+  bool IsQuad;
+};
+
+struct bvh_node {
+  // The boxes of the four children.
+  f32 MinX[4];
+  f32 MinY[4];
+  f32 MinZ[4];
+  f32 MaxX[4];
+  f32 MaxY[4];
+  f32 MaxZ[4];
+  // For inner children, the index of their node. For leaves, the index of their first face in
+  // bvh::Faces. -1 for unused children, which always come last.
+  i32 Children[4];
+  // 0 for inner children, and the number of faces for leaves.
+  i32 NumFaces[4];
+};
+
+struct bvh {
+  // Nodes[0] is the root, unless the mesh has no faces.
+  std::vector<bvh_node, aligned_allocator<bvh_node, 64>> Nodes;
+  // The faces in the order of the leaves, with copies of their corners, so that a leaf is
+  // tested without looking up the mesh. Triangles repeat their last corner in Corners[3].
+  struct face {
+    vec3 Corners[4];
+    bvh_face Face;
+  };
+  std::vector<face> Faces;
+  aabb Bounds = {{0.f, 0.f, 0.f}, {0.f, 0.f, 0.f}};
+  // Number of node levels. The queries size their stacks with it.
+  i32 Depth = 0;
+};
+
+// Polygons with more than four vertices aren't in a mesh, so all faces are included. The bvh
+// doesn't refer to the mesh afterwards.
+bvh build_bvh(const mesh& Mesh, const bvh_options& Options = bvh_options());
+
+// Points at Origin + T * Direction for T in [0, MaxT]. Direction doesn't have to be normalized.
+struct ray {
+  vec3 Origin;
+  vec3 Direction;
+  f32 MaxT;
+};
+
+struct ray_hit {
+  bvh_face Face;
+  f32 T;
+};
+
+// The queries test both sides of each face. Quads count as the triangles (0, 1, 2) and
+// (0, 2, 3). All levels give the same results; AVX2 uses the SSE2 code, since the nodes have
+// four children.
+//
+// Finds the hit with the smallest T. Returns false if the ray doesn't hit any face.
+bool intersect_closest(const bvh& Bvh, const ray& Ray, ray_hit& Hit,
+    simd_level Level = get_simd_level());
+// Returns true as soon as any hit is found, e.g. for shadow and visibility rays.
+bool intersect_any(const bvh& Bvh, const ray& Ray, simd_level Level = get_simd_level());
+// Appends the faces whose bounding boxes overlap Box to Faces, in no particular order. Touching
+// counts as overlapping.
+void find_overlapping_faces(const bvh& Bvh, const aabb& Box, std::vector<bvh_face>& Faces);
+
+} // namespace storecast
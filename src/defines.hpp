@@ -5,8 +5,15 @@
 namespace storecast
 {
 
+typedef int16_t i16;
 typedef int32_t i32;
+typedef int64_t i64;
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
 typedef float f32;
+typedef double f64;
 
 #define for3(I) for(auto I=0; I<3; ++I)
 #define for4(I) for(auto I=0; I<4; ++I)
@@ -0,0 +1,136 @@
+#include "import_stats.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+namespace storecast
+{
+using std::string;
+using std::vector;
+
+namespace {
+#ifdef STORECAST_COUNT_ALLOCATIONS
+std::atomic<u64> NumAllocationsSoFar(0);
+#endif
+
+void append_format(string& Out, const char* Format, ...)
+{
+  char Buffer[256];
+  va_list Arguments;
+  va_start(Arguments, Format);
+  auto Length = vsnprintf(Buffer, sizeof(Buffer), Format, Arguments);
+  va_end(Arguments);
+  if (Length > 0) {
+    Out.append(Buffer, std::min(static_cast<size_t>(Length), sizeof(Buffer) - 1));
+  }
+}
+} // anonymous namespace
+
+u64 get_num_allocations()
+{
+#ifdef STORECAST_COUNT_ALLOCATIONS
+  return NumAllocationsSoFar.load(std::memory_order_relaxed);
+#else
+  return 0;
+#endif
+}
+
+f64 import_stats::get_dedup_ratio() const
+{
+  return NumMeshVertices ? static_cast<f64>(NumFaceVertices) / NumMeshVertices : 0.0;
+}
+
+f64 import_stats::get_seconds(const string& Name) const
+{
+  f64 Seconds = 0.0;
+  for (auto& Event: Events) {
+    Seconds += Name == Event.Name ? Event.Seconds : 0.0;
+  }
+  return Seconds;
+}
+
+u64 import_stats::get_num_allocations(const string& Name) const
+{
+  u64 NumAllocations = 0;
+  for (auto& Event: Events) {
+    NumAllocations += Name == Event.Name ? Event.NumAllocations : 0;
+  }
+  return NumAllocations;
+}
+
+string format_chrome_trace(const import_stats& Stats)
+{
+  // Timestamps are in microseconds since the first event, and threads are numbered in the order
+  // in which they first appear.
+  f64 Origin = 0.0;
+  for (size_t I = 0; I < Stats.Events.size(); ++I) {
+    Origin = I == 0 ? Stats.Events[I].Begin : std::min(Origin, Stats.Events[I].Begin);
+  }
+  f64 End = Origin;
+  vector<std::thread::id> Threads;
+  string Out = "{\"traceEvents\": [\n";
+  for (auto& Event: Stats.Events) {
+    auto Thread = std::find(Threads.begin(), Threads.end(), Event.Thread) - Threads.begin();
+    if (Thread == static_cast<std::ptrdiff_t>(Threads.size())) {
+      Threads.push_back(Event.Thread);
+    }
+    End = std::max(End, Event.Begin + Event.Seconds);
+    append_format(Out, "{\"name\": \"%s\", \"cat\": \"import\", \"ph\": \"X\", \"pid\": 1, "
+        "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"allocations\": %llu}},\n",
+        Event.Name, static_cast<i32>(Thread), (Event.Begin - Origin) * 1e6, Event.Seconds * 1e6,
+        static_cast<unsigned long long>(Event.NumAllocations));
+  }
+  auto Count = [](u64 Value) { return static_cast<unsigned long long>(Value); };
+  append_format(Out, "{\"name\": \"import_stats\", \"cat\": \"import\", \"ph\": \"i\", "
+      "\"s\": \"g\", \"pid\": 1, \"tid\": 0, \"ts\": %.3f, \"args\": {", (End - Origin) * 1e6);
+  append_format(Out, "\"bytes\": %llu, \"lines\": %llu, \"v\": %llu, \"vt\": %llu, "
+      "\"vn\": %llu, \"faces\": %llu, ", Count(Stats.NumBytes), Count(Stats.NumLines),
+      Count(Stats.NumV), Count(Stats.NumVt), Count(Stats.NumVn), Count(Stats.NumFaces));
+  append_format(Out, "\"skipped_faces\": %llu, \"face_vertices\": %llu, "
+      "\"mesh_vertices\": %llu, \"dedup_ratio\": %.4f}}\n",
+      Count(Stats.NumSkippedFaces), Count(Stats.NumFaceVertices), Count(Stats.NumMeshVertices),
+      Stats.get_dedup_ratio());
+  Out += "]}\n";
+  return Out;
+}
+
+bool write_chrome_trace(const string& Filename, const import_stats& Stats)
+{
+  std::ofstream Out(Filename, std::ios::binary | std::ios::trunc);
+  if (!Out) {
+    return false;
+  }
+  Out << format_chrome_trace(Stats);
+  Out.close();
+  return !Out.fail();
+}
+
+} // namespace storecast
+
+#ifdef STORECAST_COUNT_ALLOCATIONS
+// The array and nothrow forms call these, so they are counted as well.
+void* operator new(size_t Size)
+{
+  storecast::NumAllocationsSoFar.fetch_add(1, std::memory_order_relaxed);
+  if (void* Pointer = malloc(Size ? Size : 1)) {
+    return Pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* Pointer) noexcept
+{
+  free(Pointer);
+}
+
+void operator delete(void* Pointer, size_t) noexcept
+{
+  free(Pointer);
+}
+#endif
@@ -0,0 +1,132 @@
+#pragma once
+#include "defines.hpp"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace storecast
+{
+
+// Where the time of an import goes. Pass an import_stats through obj_parse_options::Stats and
+// obj_convert_options::Stats, and parse_obj and convert_to_mesh add what they did to it. Without
+// a Stats pointer, the only cost is a few null checks per call. Building with
+// STORECAST_NO_STATS removes even those, and leaves every import_stats empty.
+//
+// Allocations are only counted if the library is built with STORECAST_COUNT_ALLOCATIONS, which
+// replaces the global operator new. Otherwise they are always 0.
+
+// One phase of an import, e.g. the vertex deduplication of convert_to_mesh. Phases nest: the
+// phases of a call lie within the phase named after the call. Phases on other threads than the
+// caller's come from the parallel parts.
+struct import_event {
+  // A string literal, e.g. "dedup".
+  const char* Name;
+  // Seconds on a steady clock, so only differences mean something.
+  f64 Begin;
+  f64 Seconds;
+  std::thread::id Thread;
+  // Allocations of the whole process during the phase, from all threads.
+  u64 NumAllocations;
+};
+
+struct import_stats {
+  std::vector<import_event> Events;
+
+  // parse_obj. Faces with fewer than three vertices are dropped while parsing, and not counted.
+  u64 NumBytes = 0;
+  u64 NumLines = 0;
+  u64 NumV = 0;
+  u64 NumVt = 0;
+  u64 NumVn = 0;
+  u64 NumFaces = 0;
+
+  // convert_to_mesh. Polygons with more than four vertices are skipped unless they get
+  // triangulated. NumFaceVertices counts the vertices of all other faces, i.e. the keys that are
+  // deduplicated into NumMeshVertices vertices.
+  u64 NumSkippedFaces = 0;
+  u64 NumFaceVertices = 0;
+  u64 NumMeshVertices = 0;
+
+  // NumFaceVertices / NumMeshVertices, i.e. by how many faces a vertex is shared on average.
+  f64 get_dedup_ratio() const;
+  // Sum over all events with this name.
+  f64 get_seconds(const std::string& Name) const;
+  u64 get_num_allocations(const std::string& Name) const;
+};
+
+// Number of calls to operator new so far, or 0 without STORECAST_COUNT_ALLOCATIONS.
+u64 get_num_allocations();
+
+inline f64 get_stats_clock()
+{
+  using namespace std::chrono;
+  return duration<f64>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline import_event begin_import_event(const char* Name)
+{
+  return {Name, get_stats_clock(), 0.0, std::this_thread::get_id(), get_num_allocations()};
+}
+
+inline void end_import_event(import_event& Event)
+{
+  Event.Seconds = get_stats_clock() - Event.Begin;
+  Event.NumAllocations = get_num_allocations() - Event.NumAllocations;
+}
+
+// Returns Stats, or null if stats are compiled out. Code that records stats checks the result
+// for null, so that with STORECAST_NO_STATS the compiler drops all of it.
+inline import_stats* get_enabled_stats(import_stats* Stats)
+{
+#ifdef STORECAST_NO_STATS
+  (void)Stats;
+  return nullptr;
+#else
+  return Stats;
+#endif
+}
+
+// Adds an event for the time from construction to destruction to Stats, if that isn't null.
+class import_phase {
+public:
+  import_phase(import_stats* Stats, const char* Name) : Stats(get_enabled_stats(Stats))
+  {
+    next(Name);
+  }
+  ~import_phase() { end(); }
+  import_phase(const import_phase&) = delete;
+  import_phase& operator=(const import_phase&) = delete;
+
+  // Ends the current event, and begins the next one of a sequence of phases.
+  void next(const char* Name)
+  {
+    end();
+    if (Stats) {
+      Event = begin_import_event(Name);
+      IsRunning = true;
+    }
+  }
+  // Ends the event before the destructor would.
+  void end()
+  {
+    if (IsRunning) {
+      end_import_event(Event);
+      Stats->Events.push_back(Event);
+      IsRunning = false;
+    }
+  }
+
+private:
+  import_stats* Stats;
+  import_event Event = {};
+  bool IsRunning = false;
+};
+
+// The events in the Trace Event Format, as a JSON object that chrome://tracing and Perfetto can
+// open. The counters end up in the args of a final "import_stats" event.
+std::string format_chrome_trace(const import_stats& Stats);
+// Returns false if the file can't be written.
+bool write_chrome_trace(const std::string& Filename, const import_stats& Stats);
+
+} // namespace storecast
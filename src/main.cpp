@@ -1,31 +1,95 @@
 #include "tests.hpp"
 
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <string>
-#include <fstream>
 #include <iostream>
+#include <vector>
 
 #include "obj_import.hpp"
 #include "mesh.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimize.hpp"
+#include "mapped_file.hpp"
+#include "batch_import.hpp"
 
 namespace storecast
 {
-void print_command_list_for_file(std::string Filename)
+// Returns false if the file can't be read. No cache is written then.
+bool print_command_list_for_file(std::string Filename)
 {
-  std::ifstream File(Filename);
-  auto Obj = parse_obj(File);
-  auto Mesh = convert_to_mesh(Obj);
+  // Use the cached draw commands if the file hasn't changed since the cache was written.
+  auto CacheFilename = get_mesh_cache_filename(Filename);
+  u64 SourceHash = 0;
+  {
+    mapped_file Source(Filename);
+    if (!Source.Succeeded) {
+      std::cerr << "Can't read " << Filename << std::endl;
+      return false;
+    }
+    SourceHash = hash_bytes(Source.Data, Source.Size);
+  }
+  {
+    mapped_mesh_cache Cache(CacheFilename);
+    if (Cache.is_fresh(SourceHash) && Cache.NumDrawCommands > 0) {
+      for (size_t I = 0; I < Cache.NumDrawCommands; ++I) {
+        std::cout << Cache.DrawCommands[I] << std::endl;
+      }
+      return true;
+    }
+  }
+
+  auto Mesh = import_obj_file_to_mesh(Filename);
+  optimize_vertex_cache(Mesh);
+  optimize_vertex_fetch(Mesh);
   auto CommandList = get_draw_command_list(Mesh);
   for (auto Command: CommandList) {
     std::cout << Command << std::endl;
   }
+  write_mesh_cache(CacheFilename, Mesh, &CommandList, SourceHash);
+  return true;
+}
+
+// storecast --batch [--threads N] PATH... imports all .obj files in the given files and
+// directories at once and prints how long each one took. Returns false if any of them failed.
+bool import_batch(i32 NumArgs, char* Args[])
+{
+  batch_import_options Options;
+  std::vector<std::string> Filenames;
+  for (i32 I = 0; I < NumArgs; ++I) {
+    if (strcmp(Args[I], "--threads") == 0 && I + 1 < NumArgs) {
+      Options.NumThreads = atoi(Args[++I]);
+      continue;
+    }
+    auto Found = find_obj_files(Args[I]);
+    Filenames.insert(Filenames.end(), Found.begin(), Found.end());
+  }
+
+  using namespace std::chrono;
+  auto Start = steady_clock::now();
+  auto Results = import_obj_files(Filenames, Options);
+  auto WallSeconds = duration<f64>(steady_clock::now() - Start).count();
+  print_batch_summary(std::cout, Results, WallSeconds);
+  for (auto& Result: Results) {
+    if (!Result.Succeeded) {
+      return false;
+    }
+  }
+  return true;
 }
 } // namespace storecast
 
 int main(int argc, char *argv[])
 {
   bool RunTests = true;
+  if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+    return storecast::import_batch(argc - 2, argv + 2) ? 0 : 1;
+  }
   if (argc == 2) {
-    storecast::print_command_list_for_file(argv[1]);
+    if (!storecast::print_command_list_for_file(argv[1])) {
+      return 1;
+    }
     RunTests = false;
   }
 
@@ -0,0 +1,101 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace storecast
+{
+
+#ifdef _WIN32
+mapped_file::mapped_file(const std::string& Filename)
+{
+  HANDLE File = CreateFileA(Filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (File == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  FileHandle = File;
+
+  LARGE_INTEGER FileSize;
+  if (!GetFileSizeEx(File, &FileSize)) {
+    return;
+  }
+  if (FileSize.QuadPart == 0) {
+    Succeeded = true;
+    return;
+  }
+  HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!Mapping) {
+    return;
+  }
+  MappingHandle = Mapping;
+
+  void* View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!View) {
+    return;
+  }
+  Data = static_cast<const char*>(View);
+  Size = static_cast<size_t>(FileSize.QuadPart);
+  Succeeded = true;
+}
+
+mapped_file::~mapped_file()
+{
+  if (Data) {
+    UnmapViewOfFile(Data);
+  }
+  if (MappingHandle) {
+    CloseHandle(MappingHandle);
+  }
+  if (FileHandle) {
+    CloseHandle(FileHandle);
+  }
+}
+#else
+mapped_file::mapped_file(const std::string& Filename)
+{
+  FileDescriptor = open(Filename.c_str(), O_RDONLY);
+  if (FileDescriptor < 0) {
+    return;
+  }
+
+  struct stat FileStat;
+  if (fstat(FileDescriptor, &FileStat) != 0) {
+    return;
+  }
+  if (FileStat.st_size == 0) {
+    Succeeded = true;
+    return;
+  }
+  void* View = mmap(nullptr, static_cast<size_t>(FileStat.st_size), PROT_READ, MAP_PRIVATE,
+      FileDescriptor, 0);
+  if (View == MAP_FAILED) {
+    return;
+  }
+  // We tokenize front to back exactly once.
+  madvise(View, static_cast<size_t>(FileStat.st_size), MADV_SEQUENTIAL);
+  Data = static_cast<const char*>(View);
+  Size = static_cast<size_t>(FileStat.st_size);
+  Succeeded = true;
+}
+
+mapped_file::~mapped_file()
+{
+  if (Data) {
+    munmap(const_cast<char*>(Data), Size);
+  }
+  if (FileDescriptor >= 0) {
+    close(FileDescriptor);
+  }
+}
+#endif
+
+} // namespace storecast
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace storecast
+{
+
+// Read-only memory mapping of an entire file. If the file can't be opened or mapped (or is
+// empty), Data is nullptr and Size is 0, which callers can treat like an empty file.
+struct mapped_file {
+  explicit mapped_file(const std::string& Filename);
+  ~mapped_file();
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  const char* Data = nullptr;
+  size_t Size = 0;
+  // False if the file couldn't be opened or mapped, to tell that apart from an empty file.
+  bool Succeeded = false;
+
+private:
+#ifdef _WIN32
+  void* FileHandle = nullptr;
+  void* MappingHandle = nullptr;
+#else
+  int FileDescriptor = -1;
+#endif
+};
+
+} // namespace storecast
@@ -16,4 +16,19 @@ struct vec3 {
   };
 };
 
+inline vec3 operator+(const vec3& A, const vec3& B) { return {A.X + B.X, A.Y + B.Y, A.Z + B.Z}; }
+inline vec3 operator-(const vec3& A, const vec3& B) { return {A.X - B.X, A.Y - B.Y, A.Z - B.Z}; }
+inline vec3 operator*(const vec3& A, f32 S) { return {A.X * S, A.Y * S, A.Z * S}; }
+inline f32 dot(const vec3& A, const vec3& B) { return A.X * B.X + A.Y * B.Y + A.Z * B.Z; }
+inline vec3 cross(const vec3& A, const vec3& B)
+{
+  return {A.Y * B.Z - A.Z * B.Y, A.Z * B.X - A.X * B.Z, A.X * B.Y - A.Y * B.X};
+}
+inline f32 length_squared(const vec3& A) { return dot(A, A); }
+
+// Row-major, and applied to column vectors: the translation is in M[0..2][3].
+struct mat4 {
+  f32 M[4][4];
+};
+
 } // namespace storecast
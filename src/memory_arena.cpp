@@ -0,0 +1,76 @@
+#include "memory_arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace storecast
+{
+
+memory_arena::memory_arena(size_t BlockSize) : BlockSize(std::max<size_t>(BlockSize, 64))
+{
+}
+
+memory_arena::~memory_arena()
+{
+  free_blocks();
+}
+
+void* memory_arena::allocate(size_t Size, size_t Alignment)
+{
+  std::lock_guard<std::mutex> Lock(Mutex);
+  Size = std::max<size_t>(Size, 1);
+  for (;;) {
+    if (CurrentBlock < Blocks.size()) {
+      auto& Block = Blocks[CurrentBlock];
+      auto Address = reinterpret_cast<uintptr_t>(Block.Data) + BlockUsed;
+      auto Padding = (Alignment - Address % Alignment) % Alignment;
+      if (Padding + Size <= Block.Size - BlockUsed) {
+        auto Result = Block.Data + BlockUsed + Padding;
+        BlockUsed += Padding + Size;
+        NumBytesUsed += Padding + Size;
+        return Result;
+      }
+    }
+    if (CurrentBlock + 1 < Blocks.size()) {
+      ++CurrentBlock;
+      BlockUsed = 0;
+    } else {
+      add_block(Size + Alignment);
+    }
+  }
+}
+
+void memory_arena::reset()
+{
+  std::lock_guard<std::mutex> Lock(Mutex);
+  if (Blocks.size() > 1) {
+    auto TotalSize = Capacity;
+    free_blocks();
+    add_block(TotalSize);
+  }
+  CurrentBlock = 0;
+  BlockUsed = 0;
+  NumBytesUsed = 0;
+}
+
+void memory_arena::add_block(size_t MinSize)
+{
+  // Doubling the capacity with every block keeps the number of blocks logarithmic.
+  auto Size = std::max({BlockSize, MinSize, Capacity});
+  Blocks.push_back({static_cast<char*>(::operator new(Size)), Size});
+  CurrentBlock = Blocks.size() - 1;
+  BlockUsed = 0;
+  Capacity += Size;
+  ++NumBlockAllocations;
+}
+
+void memory_arena::free_blocks()
+{
+  for (auto& Block: Blocks) {
+    ::operator delete(Block.Data);
+  }
+  Blocks.clear();
+  Capacity = 0;
+}
+
+} // namespace storecast
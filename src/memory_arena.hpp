@@ -0,0 +1,105 @@
+#pragma once
+#include "defines.hpp"
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace storecast
+{
+
+// Monotonic allocator for the temporary arrays of an import. Allocating is a pointer bump, and
+// freeing does nothing; all memory comes back at once with reset. A long-running process can
+// keep one arena and reset it between imports: once it is large enough for the largest import,
+// it doesn't touch the general heap anymore, which keeps that from fragmenting.
+//
+// allocate may be called from several threads at once. Memory from an arena must not be used
+// after reset or after the arena is destroyed.
+class memory_arena {
+public:
+  // Blocks are at least BlockSize bytes, and each new one is at least as large as all before it.
+  explicit memory_arena(size_t BlockSize = 1 << 20);
+  ~memory_arena();
+  memory_arena(const memory_arena&) = delete;
+  memory_arena& operator=(const memory_arena&) = delete;
+
+  void* allocate(size_t Size, size_t Alignment);
+  // Makes all memory available again. If the last use needed more than one block, they are
+  // replaced by a single block of the same total size, so that the same work fits into it next
+  // time.
+  void reset();
+  // Bytes of all blocks, and bytes handed out since the last reset, including alignment.
+  size_t get_capacity() const { return Capacity; }
+  size_t get_num_bytes_used() const { return NumBytesUsed; }
+  // Number of blocks allocated from the general heap over the lifetime of the arena.
+  size_t get_num_block_allocations() const { return NumBlockAllocations; }
+
+private:
+  struct block {
+    char* Data;
+    size_t Size;
+  };
+  std::vector<block> Blocks;
+  // Blocks[CurrentBlock] is the one being filled, and BlockUsed bytes of it are taken.
+  size_t CurrentBlock = 0;
+  size_t BlockUsed = 0;
+  size_t BlockSize;
+  size_t Capacity = 0;
+  size_t NumBytesUsed = 0;
+  size_t NumBlockAllocations = 0;
+  std::mutex Mutex;
+
+  void add_block(size_t MinSize);
+  void free_blocks();
+};
+
+// Standard allocator on top of a memory_arena. Without an arena, it uses the general heap like
+// std::allocator, so the same containers work either way. Containers take the arena along when
+// they are moved or assigned.
+template <class value_type_>
+struct arena_allocator {
+  typedef value_type_ value_type;
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  memory_arena* Arena = nullptr;
+
+  arena_allocator() = default;
+  explicit arena_allocator(memory_arena* Arena) : Arena(Arena) {}
+  template <class other_type>
+  arena_allocator(const arena_allocator<other_type>& Other) : Arena(Other.Arena) {}
+
+  value_type* allocate(size_t Count)
+  {
+    if (Count > static_cast<size_t>(-1) / sizeof(value_type)) {
+      throw std::bad_alloc();
+    }
+    auto Size = Count * sizeof(value_type);
+    return static_cast<value_type*>(Arena ? Arena->allocate(Size, alignof(value_type))
+        : ::operator new(Size));
+  }
+  void deallocate(value_type* Pointer, size_t)
+  {
+    if (!Arena) {
+      ::operator delete(Pointer);
+    }
+  }
+};
+
+template <class left_type, class right_type>
+bool operator==(const arena_allocator<left_type>& Left, const arena_allocator<right_type>& Right)
+{
+  return Left.Arena == Right.Arena;
+}
+template <class left_type, class right_type>
+bool operator!=(const arena_allocator<left_type>& Left, const arena_allocator<right_type>& Right)
+{
+  return Left.Arena != Right.Arena;
+}
+
+template <class value_type>
+using arena_vector = std::vector<value_type, arena_allocator<value_type>>;
+
+} // namespace storecast
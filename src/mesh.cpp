@@ -1,5 +1,6 @@
 #include "mesh.hpp"
 
+#include <algorithm>
 #include <vector>
 #include <string>
 
@@ -7,26 +8,69 @@ namespace storecast
 {
 using std::vector;
 
-vector<draw_command> get_draw_command_list(const mesh& Mesh)
+void add_to_ranges(vector<mesh_range>& Ranges, i32 Material, i32 StartIndex, i32 NumIndices)
 {
-  vector<draw_command> Result;
-  Result.reserve(Mesh.TriangleIndices.size() + Mesh.QuadIndices.size());
-  for (auto IndexOffset = 0; IndexOffset < Mesh.TriangleIndices.size(); IndexOffset += 3) {
-    Result.push_back({draw_command::type::TRIANGLE, IndexOffset, 3});
+  if (!Ranges.empty() && Ranges.back().Material == Material
+      && Ranges.back().StartIndex + Ranges.back().NumIndices == StartIndex) {
+    Ranges.back().NumIndices += NumIndices;
+  } else {
+    Ranges.push_back({Material, StartIndex, NumIndices});
   }
-  for (auto IndexOffset = 0; IndexOffset < Mesh.QuadIndices.size(); IndexOffset += 4) {
-    Result.push_back({draw_command::type::QUAD, IndexOffset, 4});
+}
+
+void group_by_material(vector<i32>& Indices, vector<mesh_range>& Ranges)
+{
+  bool IsGrouped = true;
+  for (size_t I = 1; I < Ranges.size(); ++I) {
+    IsGrouped = IsGrouped && Ranges[I - 1].Material < Ranges[I].Material;
+  }
+  if (IsGrouped) {
+    return;
   }
+
+  auto SortedRanges = Ranges;
+  std::stable_sort(SortedRanges.begin(), SortedRanges.end(),
+      [](const mesh_range& L, const mesh_range& R) { return L.Material < R.Material; });
+  vector<i32> GroupedIndices;
+  GroupedIndices.reserve(Indices.size());
+  vector<mesh_range> GroupedRanges;
+  for (auto& Range: SortedRanges) {
+    add_to_ranges(GroupedRanges, Range.Material, static_cast<i32>(GroupedIndices.size()),
+        Range.NumIndices);
+    GroupedIndices.insert(GroupedIndices.end(), Indices.begin() + Range.StartIndex,
+        Indices.begin() + Range.StartIndex + Range.NumIndices);
+  }
+  Indices.swap(GroupedIndices);
+  Ranges.swap(GroupedRanges);
+}
+
+vector<draw_command> get_draw_command_list(const mesh& Mesh)
+{
+  vector<draw_command> Result;
+  Result.reserve(Mesh.TriangleRanges.size() + Mesh.QuadRanges.size() + 2);
+  auto add_commands = [&](draw_command::type Type, const vector<i32>& Indices,
+      const vector<mesh_range>& Ranges) {
+    // Meshes that weren't imported may come without ranges. Draw all their faces at once.
+    if (Ranges.empty() && !Indices.empty()) {
+      Result.push_back({Type, 0, static_cast<i32>(Indices.size()), -1});
+    }
+    for (auto& Range: Ranges) {
+      Result.push_back({Type, Range.StartIndex, Range.NumIndices, Range.Material});
+    }
+  };
+  add_commands(draw_command::type::TRIANGLE, Mesh.TriangleIndices, Mesh.TriangleRanges);
+  add_commands(draw_command::type::QUAD, Mesh.QuadIndices, Mesh.QuadRanges);
   return Result;
 }
 
 std::ostream& operator <<(std::ostream& Out, const draw_command& Command)
 {
   if (Command.Type == draw_command::type::TRIANGLE) {
-    Out << "TRIANGLE " << Command.StartIndex << " " << Command.NumVertices;
+    Out << "TRIANGLE " << Command.StartIndex << " " << Command.NumIndices;
   } else if (Command.Type == draw_command::type::QUAD) {
-    Out << "QUAD     " << Command.StartIndex << " " << Command.NumVertices;
+    Out << "QUAD     " << Command.StartIndex << " " << Command.NumIndices;
   }
+  Out << " " << Command.MaterialId;
   return Out;
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 #include "math.hpp"
+#include <ostream>
+#include <string>
 #include <vector>
 
 namespace storecast
@@ -10,6 +12,14 @@ struct vertex_data {
   vec3 Normal;
   vec3 TextureCoords;
 };
+// Consecutive indices in mesh::TriangleIndices or mesh::QuadIndices whose faces all use the
+// same material.
+struct mesh_range {
+  // Index into mesh::MaterialNames, or -1 for faces that come before any usemtl.
+  i32 Material;
+  i32 StartIndex;
+  i32 NumIndices;
+};
 struct mesh {
   std::vector<vertex_data> Vertices;
   // I could have modeled the index buffer as vector<vector<i32> Indices>>, where Indices.size() is
@@ -18,8 +28,22 @@ struct mesh {
   // and triangles should be the main use case, especially for rendering.
   std::vector<i32> TriangleIndices;
   std::vector<i32> QuadIndices;
+  // The faces are grouped by material, so that each material can be drawn with one command per
+  // primitive type. The ranges are sorted by material, and there's at most one per material.
+  std::vector<mesh_range> TriangleRanges;
+  std::vector<mesh_range> QuadRanges;
+  std::vector<std::string> MaterialNames;
 };
 
+// Appends NumIndices indices with the given material at StartIndex to Ranges, merging them into
+// the last range if that one has the same material and ends at StartIndex.
+void add_to_ranges(std::vector<mesh_range>& Ranges, i32 Material, i32 StartIndex,
+    i32 NumIndices);
+// Reorders Indices so that the faces of each material are next to each other, and merges Ranges
+// into one range per material. Faces with the same material keep their order, and nothing is
+// moved if Ranges is grouped already.
+void group_by_material(std::vector<i32>& Indices, std::vector<mesh_range>& Ranges);
+
 struct draw_command {
   enum class type {
     TRIANGLE,
@@ -27,9 +51,12 @@ struct draw_command {
   } Type;
   // Index into mesh::TriangleIndices if Type==TRIANGLE, otherwise into mesh::QuadIndices.
   i32 StartIndex;
-  i32 NumVertices;
+  i32 NumIndices;
+  // Index into mesh::MaterialNames, or -1 for no material.
+  i32 MaterialId;
 };
 
+// One command per mesh_range, i.e. per material and primitive type.
 std::vector<draw_command> get_draw_command_list(const mesh& Mesh);
 
 std::ostream& operator <<(std::ostream& Out, const draw_command& Command);
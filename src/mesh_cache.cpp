@@ -0,0 +1,207 @@
+#include "mesh_cache.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace storecast
+{
+using std::string;
+using std::vector;
+
+namespace {
+// Bump this whenever the layout of the file or of the stored structs changes.
+const u32 MeshCacheVersion = 2;
+const char MeshCacheMagic[8] = {'S', 'C', 'M', 'E', 'S', 'H', 0, 0};
+const u32 ByteOrderMark = 0x01020304;
+
+struct mesh_cache_header {
+  char Magic[8];
+  u32 Version;
+  u32 ByteOrderMark;
+  u32 VertexSize;
+  u32 DrawCommandSize;
+  u64 SourceHash;
+  u64 NumVertices;
+  u64 NumTriangleIndices;
+  u64 NumQuadIndices;
+  u64 NumTriangleRanges;
+  u64 NumQuadRanges;
+  u64 NumDrawCommands;
+  // The material names are stored last, each one followed by a '\0'.
+  u64 MaterialNamesSize;
+};
+// The arrays follow the header directly, so they must all be 4-byte aligned.
+static_assert(sizeof(mesh_cache_header) % 8 == 0, "Header must keep the arrays aligned");
+static_assert(sizeof(vertex_data) % 4 == 0, "Vertices must keep the indices aligned");
+
+u64 rotate_left(u64 Value, i32 Bits)
+{
+  return (Value << Bits) | (Value >> (64 - Bits));
+}
+
+u64 load_u64(const char* At)
+{
+  u64 Value;
+  memcpy(&Value, At, sizeof(Value));
+  return Value;
+}
+
+template <class element_type>
+void write_array(std::ofstream& Out, const element_type* Data, size_t Count)
+{
+  Out.write(reinterpret_cast<const char*>(Data),
+      static_cast<std::streamsize>(Count * sizeof(element_type)));
+}
+
+// Points Array at the next Count elements at At, and advances At past them. Returns false if
+// there aren't enough bytes left.
+template <class element_type>
+bool read_array(const char*& At, const char* End, u64 Count, const element_type*& Array,
+    size_t& ArraySize)
+{
+  if (Count > static_cast<u64>(End - At) / sizeof(element_type)) {
+    return false;
+  }
+  Array = reinterpret_cast<const element_type*>(At);
+  ArraySize = static_cast<size_t>(Count);
+  At += ArraySize * sizeof(element_type);
+  return true;
+}
+} // anonymous namespace
+
+u64 hash_bytes(const char* Data, size_t Size)
+{
+  // Four independent multiply-rotate lanes over 32 bytes at a time, then a final mix, in the
+  // style of xxHash. Several GB/s, so checking a 100 MB source takes a few tens of milliseconds.
+  const u64 Prime1 = 0x9E3779B185EBCA87ull;
+  const u64 Prime2 = 0xC2B2AE3D27D4EB4Full;
+  auto hash_round = [=](u64 Accumulator, u64 Input) {
+    return rotate_left(Accumulator + Input * Prime2, 31) * Prime1;
+  };
+  u64 Lanes[4] = {Prime1 + Prime2, Prime2, 0, 0 - Prime1};
+  auto At = Data;
+  auto End = Data + Size;
+  for (; End - At >= 32; At += 32) {
+    for4(I) {
+      Lanes[I] = hash_round(Lanes[I], load_u64(At + 8 * I));
+    }
+  }
+  u64 Hash = static_cast<u64>(Size);
+  for4(I) {
+    Hash = hash_round(Hash ^ rotate_left(Lanes[I], 7 * I + 1), Prime1);
+  }
+  for (; End - At >= 8; At += 8) {
+    Hash = hash_round(Hash, load_u64(At));
+  }
+  for (; At != End; ++At) {
+    Hash = hash_round(Hash, static_cast<u8>(*At));
+  }
+  Hash ^= Hash >> 33;
+  Hash *= Prime2;
+  Hash ^= Hash >> 29;
+  return Hash;
+}
+
+string get_mesh_cache_filename(const string& SourceFilename)
+{
+  return SourceFilename + ".scmesh";
+}
+
+bool write_mesh_cache(const string& CacheFilename, const mesh& Mesh,
+    const vector<draw_command>* DrawCommands, u64 SourceHash)
+{
+  std::ofstream Out(CacheFilename, std::ios::binary | std::ios::trunc);
+  if (!Out) {
+    return false;
+  }
+  mesh_cache_header Header = {};
+  memcpy(Header.Magic, MeshCacheMagic, sizeof(Header.Magic));
+  Header.Version = MeshCacheVersion;
+  Header.ByteOrderMark = ByteOrderMark;
+  Header.VertexSize = sizeof(vertex_data);
+  Header.DrawCommandSize = sizeof(draw_command);
+  Header.SourceHash = SourceHash;
+  Header.NumVertices = Mesh.Vertices.size();
+  Header.NumTriangleIndices = Mesh.TriangleIndices.size();
+  Header.NumQuadIndices = Mesh.QuadIndices.size();
+  Header.NumTriangleRanges = Mesh.TriangleRanges.size();
+  Header.NumQuadRanges = Mesh.QuadRanges.size();
+  Header.NumDrawCommands = DrawCommands ? DrawCommands->size() : 0;
+  string MaterialNames;
+  for (auto& Name: Mesh.MaterialNames) {
+    MaterialNames.append(Name.c_str(), Name.size() + 1);
+  }
+  Header.MaterialNamesSize = MaterialNames.size();
+  write_array(Out, &Header, 1);
+  write_array(Out, Mesh.Vertices.data(), Mesh.Vertices.size());
+  write_array(Out, Mesh.TriangleIndices.data(), Mesh.TriangleIndices.size());
+  write_array(Out, Mesh.QuadIndices.data(), Mesh.QuadIndices.size());
+  write_array(Out, Mesh.TriangleRanges.data(), Mesh.TriangleRanges.size());
+  write_array(Out, Mesh.QuadRanges.data(), Mesh.QuadRanges.size());
+  if (DrawCommands) {
+    write_array(Out, DrawCommands->data(), DrawCommands->size());
+  }
+  write_array(Out, MaterialNames.data(), MaterialNames.size());
+  Out.close();
+  return !Out.fail();
+}
+
+mapped_mesh_cache::mapped_mesh_cache(const string& CacheFilename)
+  : File(CacheFilename)
+{
+  mesh_cache_header Header;
+  if (File.Size < sizeof(Header)) {
+    return;
+  }
+  memcpy(&Header, File.Data, sizeof(Header));
+  if (memcmp(Header.Magic, MeshCacheMagic, sizeof(Header.Magic))
+      || Header.Version != MeshCacheVersion
+      || Header.ByteOrderMark != ByteOrderMark
+      || Header.VertexSize != sizeof(vertex_data)
+      || Header.DrawCommandSize != sizeof(draw_command)) {
+    return;
+  }
+
+  // A cache that was only partially written is too short for the counts in its header.
+  auto At = File.Data + sizeof(Header);
+  auto End = File.Data + File.Size;
+  if (!read_array(At, End, Header.NumVertices, Vertices, NumVertices)
+      || !read_array(At, End, Header.NumTriangleIndices, TriangleIndices, NumTriangleIndices)
+      || !read_array(At, End, Header.NumQuadIndices, QuadIndices, NumQuadIndices)
+      || !read_array(At, End, Header.NumTriangleRanges, TriangleRanges, NumTriangleRanges)
+      || !read_array(At, End, Header.NumQuadRanges, QuadRanges, NumQuadRanges)
+      || !read_array(At, End, Header.NumDrawCommands, DrawCommands, NumDrawCommands)
+      || !read_array(At, End, Header.MaterialNamesSize, MaterialNames, MaterialNamesSize)
+      || At != End
+      || (MaterialNamesSize > 0 && MaterialNames[MaterialNamesSize - 1] != 0)) {
+    Vertices = nullptr;
+    TriangleIndices = QuadIndices = nullptr;
+    TriangleRanges = QuadRanges = nullptr;
+    DrawCommands = nullptr;
+    MaterialNames = nullptr;
+    NumVertices = NumTriangleIndices = NumQuadIndices = 0;
+    NumTriangleRanges = NumQuadRanges = NumDrawCommands = MaterialNamesSize = 0;
+    return;
+  }
+  SourceHash = Header.SourceHash;
+  Valid = true;
+}
+
+mesh mapped_mesh_cache::to_mesh() const
+{
+  mesh Result;
+  Result.Vertices.assign(Vertices, Vertices + NumVertices);
+  Result.TriangleIndices.assign(TriangleIndices, TriangleIndices + NumTriangleIndices);
+  Result.QuadIndices.assign(QuadIndices, QuadIndices + NumQuadIndices);
+  Result.TriangleRanges.assign(TriangleRanges, TriangleRanges + NumTriangleRanges);
+  Result.QuadRanges.assign(QuadRanges, QuadRanges + NumQuadRanges);
+  for (size_t I = 0; I < MaterialNamesSize; ) {
+    Result.MaterialNames.push_back(MaterialNames + I);
+    I += Result.MaterialNames.back().size() + 1;
+  }
+  return Result;
+}
+
+} // namespace storecast
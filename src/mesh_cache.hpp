@@ -0,0 +1,64 @@
+#pragma once
+#include "defines.hpp"
+#include "mapped_file.hpp"
+#include "mesh.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace storecast
+{
+
+// Binary cache of an imported mesh, so that unchanged OBJ files don't have to be parsed again.
+// The file is a mesh_cache_header followed by the Vertices, TriangleIndices, QuadIndices,
+// TriangleRanges, QuadRanges, draw commands and material names, stored exactly as they are in
+// memory. The cache is only meant to be read on the machine that wrote it; the header rejects
+// anything written with a different layout.
+
+// 64-bit hash of the bytes in [Data, Data+Size), used to tell whether a cache is still fresh.
+u64 hash_bytes(const char* Data, size_t Size);
+
+// The cache for Filename lives next to it, in Filename + ".scmesh".
+std::string get_mesh_cache_filename(const std::string& SourceFilename);
+
+// Writes Mesh and, if given, DrawCommands to CacheFilename. SourceHash is the hash_bytes of the
+// file the mesh was imported from. Returns false if the file can't be written.
+bool write_mesh_cache(const std::string& CacheFilename, const mesh& Mesh,
+    const std::vector<draw_command>* DrawCommands, u64 SourceHash);
+
+// A mesh cache file mapped into memory. Loading does no per-element work: the arrays point
+// directly into the mapping, and stay valid as long as this object lives. If the file is
+// missing or doesn't pass the header checks, all arrays are empty and is_valid() is false.
+struct mapped_mesh_cache {
+  explicit mapped_mesh_cache(const std::string& CacheFilename);
+
+  bool is_valid() const { return Valid; }
+  // True if the cache is valid and was written for a source with this hash.
+  bool is_fresh(u64 SourceHash) const { return Valid && SourceHash == this->SourceHash; }
+  // Copies the arrays into a regular mesh.
+  mesh to_mesh() const;
+
+  u64 SourceHash = 0;
+  const vertex_data* Vertices = nullptr;
+  size_t NumVertices = 0;
+  const i32* TriangleIndices = nullptr;
+  size_t NumTriangleIndices = 0;
+  const i32* QuadIndices = nullptr;
+  size_t NumQuadIndices = 0;
+  const mesh_range* TriangleRanges = nullptr;
+  size_t NumTriangleRanges = 0;
+  const mesh_range* QuadRanges = nullptr;
+  size_t NumQuadRanges = 0;
+  // Empty if the cache was written without draw commands.
+  const draw_command* DrawCommands = nullptr;
+  size_t NumDrawCommands = 0;
+  // The material names, each one followed by a '\0'.
+  const char* MaterialNames = nullptr;
+  size_t MaterialNamesSize = 0;
+
+private:
+  mapped_file File;
+  bool Valid = false;
+};
+
+} // namespace storecast
@@ -0,0 +1,711 @@
+#include "mesh_codec.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define STORECAST_X64 1
+#include <emmintrin.h>
+#endif
+
+namespace storecast
+{
+using std::vector;
+
+namespace {
+// Variable-length integers, 7 bits per byte, low bits first.
+void write_varint(vector<u8>& Out, u32 Value)
+{
+  while (Value >= 0x80) {
+    Out.push_back(static_cast<u8>(Value | 0x80));
+    Value >>= 7;
+  }
+  Out.push_back(static_cast<u8>(Value));
+}
+
+bool read_varint(const u8*& At, const u8* End, u32& Value)
+{
+  Value = 0;
+  for (i32 Shift = 0; Shift < 35; Shift += 7) {
+    if (At == End) {
+      return false;
+    }
+    u8 Byte = *At++;
+    Value |= static_cast<u32>(Byte & 0x7F) << Shift;
+    if (Byte < 0x80) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Maps small negative and positive differences to small unsigned values: 0, -1, 1, -2, ...
+u32 zigzag(u32 Delta) { return (Delta << 1) ^ (0u - (Delta >> 31)); }
+u32 unzigzag(u32 Value) { return (Value >> 1) ^ (0u - (Value & 1)); }
+u8 zigzag8(u8 Delta) { return static_cast<u8>((Delta << 1) ^ (Delta & 0x80 ? 0xFF : 0)); }
+u8 unzigzag8(u8 Value) { return static_cast<u8>((Value >> 1) ^ (0u - (Value & 1))); }
+
+// The triangle codec. Every triangle gets a code byte. If one of its edges is among the last
+// EdgeFifoSize - 1 edges of earlier triangles, the high nibble is that edge's age, and the low
+// nibble codes the third vertex; a 2-bit rotation tells which of the triangle's edges it was.
+// Otherwise the high nibble is FreeTriangle, and all three vertices are coded. Vertex codes are
+// 0 for the next vertex that hasn't been used yet, 1 + age for the last NumVertexFifoCodes
+// vertices that were new or explicit, and ExplicitVertex for a zigzag varint of the difference
+// to the previous explicit vertex.
+//
+// The encoded data is the code bytes, then the rotations, four per byte, and then the varints
+// and, for free triangles, a byte with the codes of the second and third vertex.
+constexpr i32 EdgeFifoSize = 16;
+constexpr i32 VertexFifoSize = 16;
+constexpr u32 FreeTriangle = 15;
+constexpr u32 NumVertexFifoCodes = 14;
+constexpr u32 ExplicitVertex = 15;
+
+struct index_coder_state {
+  i32 Edges[EdgeFifoSize][2];
+  i32 Vertices[VertexFifoSize];
+  i32 EdgeOffset = 0;
+  i32 VertexOffset = 0;
+  u32 Next = 0;
+  u32 Last = 0;
+
+  index_coder_state()
+  {
+    std::fill(&Edges[0][0], &Edges[0][0] + 2 * EdgeFifoSize, -1);
+    std::fill(Vertices, Vertices + VertexFifoSize, -1);
+  }
+
+  void push_edge(i32 A, i32 B)
+  {
+    Edges[EdgeOffset][0] = A;
+    Edges[EdgeOffset][1] = B;
+    EdgeOffset = (EdgeOffset + 1) % EdgeFifoSize;
+  }
+  // Age 0 is the most recent one.
+  const i32* get_edge(u32 Age) const
+  {
+    return Edges[(EdgeOffset + EdgeFifoSize - 1 - Age) % EdgeFifoSize];
+  }
+
+  void push_vertex(i32 V)
+  {
+    Vertices[VertexOffset] = V;
+    VertexOffset = (VertexOffset + 1) % VertexFifoSize;
+  }
+  i32 get_vertex(u32 Age) const
+  {
+    return Vertices[(VertexOffset + VertexFifoSize - 1 - Age) % VertexFifoSize];
+  }
+
+  // The edges across which the next triangles may continue from triangle ABC, in the
+  // direction they have in those triangles.
+  void push_edges(i32 A, i32 B, i32 C, bool IncludeAB)
+  {
+    if (IncludeAB) {
+      push_edge(B, A);
+    }
+    push_edge(C, B);
+    push_edge(A, C);
+  }
+};
+
+// Finds the most recent edge that Triangle continues from, and the rotation of Triangle that
+// starts with that edge. Returns false if there's none.
+bool find_edge(const index_coder_state& State, const i32* Triangle, u32& Age, i32& Rotation)
+{
+  for (Rotation = 0; Rotation < 3; ++Rotation) {
+    for (Age = 0; Age < FreeTriangle; ++Age) {
+      const i32* Edge = State.get_edge(Age);
+      if (Edge[0] == Triangle[Rotation] && Edge[1] == Triangle[(Rotation + 1) % 3]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Returns V's code and updates State the way decode_vertex will. Explicit vertices go to Extra.
+u32 encode_vertex(index_coder_state& State, i32 V, vector<u8>& Extra)
+{
+  if (static_cast<u32>(V) == State.Next) {
+    ++State.Next;
+    State.push_vertex(V);
+    return 0;
+  }
+  for (u32 Age = 0; Age < NumVertexFifoCodes; ++Age) {
+    if (State.get_vertex(Age) == V) {
+      return 1 + Age;
+    }
+  }
+  write_varint(Extra, zigzag(static_cast<u32>(V) - State.Last));
+  State.Last = static_cast<u32>(V);
+  State.push_vertex(V);
+  return ExplicitVertex;
+}
+
+bool decode_vertex(index_coder_state& State, u32 Code, const u8*& At, const u8* End, i32& V)
+{
+  if (Code == 0) {
+    V = static_cast<i32>(State.Next++);
+    State.push_vertex(V);
+  } else if (Code != ExplicitVertex) {
+    V = State.get_vertex(Code - 1);
+  } else {
+    u32 Delta;
+    if (!read_varint(At, End, Delta)) {
+      return false;
+    }
+    State.Last += unzigzag(Delta);
+    V = static_cast<i32>(State.Last);
+    State.push_vertex(V);
+  }
+  return true;
+}
+
+// The vertex codec. Vertices come in blocks of VertexBlockSize; the last one is padded by
+// repeating the last vertex, which costs nothing. Each block starts with a 2-bit mode per byte
+// of the vertex, which says how wide the zigzagged byte differences of that byte plane are:
+// zero, 2 bits, 4 bits or 8 bits. Then come the planes, packed low bits first.
+constexpr size_t VertexBlockSize = 16;
+constexpr size_t MaxVertexSize = 256;
+const size_t PlaneSizes[4] = {0, 4, 8, 16};
+
+u32 get_plane_mode(const u8* Header, size_t Byte)
+{
+  return (Header[Byte / 4] >> (Byte % 4 * 2)) & 3;
+}
+
+// The sizes of the four planes whose modes are in a header byte.
+struct plane_size_table {
+  u8 Sizes[256];
+
+  plane_size_table()
+  {
+    for (size_t Modes = 0; Modes < 256; ++Modes) {
+      Sizes[Modes] = static_cast<u8>(PlaneSizes[Modes & 3] + PlaneSizes[(Modes >> 2) & 3]
+          + PlaneSizes[(Modes >> 4) & 3] + PlaneSizes[Modes >> 6]);
+    }
+  }
+};
+
+// True if a whole block starts at At.
+bool has_vertex_block(const u8* At, const u8* End, size_t VertexSize, const plane_size_table& Table)
+{
+  size_t HeaderSize = (VertexSize + 3) / 4;
+  if (static_cast<size_t>(End - At) < HeaderSize) {
+    return false;
+  }
+  size_t Size = HeaderSize;
+  for (size_t I = 0; I < VertexSize / 4; ++I) {
+    Size += Table.Sizes[At[I]];
+  }
+  if (VertexSize % 4 != 0) {
+    // Only the modes of bytes within the vertex count.
+    Size += Table.Sizes[At[VertexSize / 4] & ((1 << (VertexSize % 4 * 2)) - 1)];
+  }
+  return static_cast<size_t>(End - At) >= Size;
+}
+
+void unpack_plane_scalar(u32 Mode, const u8*& At, u8* Plane)
+{
+  for (size_t I = 0; I < VertexBlockSize; ++I) {
+    switch (Mode) {
+    case 0: Plane[I] = 0; break;
+    case 1: Plane[I] = static_cast<u8>((At[I / 4] >> (I % 4 * 2)) & 3); break;
+    case 2: Plane[I] = static_cast<u8>((At[I / 2] >> (I % 2 * 4)) & 15); break;
+    default: Plane[I] = At[I]; break;
+    }
+    Plane[I] = unzigzag8(Plane[I]);
+  }
+  At += PlaneSizes[Mode];
+}
+
+bool decode_vertex_buffer_scalar(u8* Vertices, size_t NumVertices, size_t VertexSize,
+    const u8*& At, const u8* End)
+{
+  plane_size_table Table;
+  u8 Previous[MaxVertexSize] = {};
+  u8 Plane[VertexBlockSize];
+  for (size_t Base = 0; Base < NumVertices; Base += VertexBlockSize) {
+    if (!has_vertex_block(At, End, VertexSize, Table)) {
+      return false;
+    }
+    size_t NumInBlock = std::min(VertexBlockSize, NumVertices - Base);
+    const u8* Header = At;
+    At += (VertexSize + 3) / 4;
+    for (size_t Byte = 0; Byte < VertexSize; ++Byte) {
+      unpack_plane_scalar(get_plane_mode(Header, Byte), At, Plane);
+      u8 Value = Previous[Byte];
+      for (size_t I = 0; I < NumInBlock; ++I) {
+        Value = static_cast<u8>(Value + Plane[I]);
+        Vertices[(Base + I) * VertexSize + Byte] = Value;
+      }
+      Previous[Byte] = Value;
+    }
+  }
+  return true;
+}
+
+#ifdef STORECAST_X64
+__m128i unpack_plane_sse2(u32 Mode, const u8*& At)
+{
+  __m128i Zigzagged;
+  switch (Mode) {
+  case 0:
+    return _mm_setzero_si128();
+  case 1: {
+    i32 Bits;
+    memcpy(&Bits, At, sizeof(Bits));
+    __m128i Packed = _mm_cvtsi32_si128(Bits);
+    __m128i Mask = _mm_set1_epi8(3);
+    __m128i V0 = _mm_and_si128(Packed, Mask);
+    __m128i V1 = _mm_and_si128(_mm_srli_epi16(Packed, 2), Mask);
+    __m128i V2 = _mm_and_si128(_mm_srli_epi16(Packed, 4), Mask);
+    __m128i V3 = _mm_and_si128(_mm_srli_epi16(Packed, 6), Mask);
+    Zigzagged = _mm_unpacklo_epi16(_mm_unpacklo_epi8(V0, V1), _mm_unpacklo_epi8(V2, V3));
+    break;
+  }
+  case 2: {
+    __m128i Packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(At));
+    __m128i Mask = _mm_set1_epi8(15);
+    Zigzagged = _mm_unpacklo_epi8(
+        _mm_and_si128(Packed, Mask), _mm_and_si128(_mm_srli_epi16(Packed, 4), Mask));
+    break;
+  }
+  default:
+    Zigzagged = _mm_loadu_si128(reinterpret_cast<const __m128i*>(At));
+    break;
+  }
+  At += PlaneSizes[Mode];
+  __m128i Half = _mm_and_si128(_mm_srli_epi16(Zigzagged, 1), _mm_set1_epi8(0x7F));
+  __m128i Sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(Zigzagged, _mm_set1_epi8(1)));
+  return _mm_xor_si128(Half, Sign);
+}
+
+// Four rounds of interleaving row I with row I + 8 rotate the 8 bits of row and column index by
+// 4, which swaps them.
+void transpose_16x16(__m128i* Rows)
+{
+  for4(Round) {
+    __m128i Interleaved[16];
+    for (i32 I = 0; I < 8; ++I) {
+      Interleaved[2 * I] = _mm_unpacklo_epi8(Rows[I], Rows[I + 8]);
+      Interleaved[2 * I + 1] = _mm_unpackhi_epi8(Rows[I], Rows[I + 8]);
+    }
+    for (i32 I = 0; I < 16; ++I) {
+      Rows[I] = Interleaved[I];
+    }
+  }
+}
+
+// Unpacks the planes of a block, transposes them 16 planes at a time into 16 vertices, and adds
+// up the differences, all in registers.
+bool decode_vertex_buffer_sse2(u8* Vertices, size_t NumVertices, size_t VertexSize,
+    const u8*& At, const u8* End)
+{
+  constexpr size_t MaxChunks = MaxVertexSize / 16;
+  size_t NumChunks = (VertexSize + 15) / 16;
+  // The planes past VertexSize in the last chunk stay zero.
+  __m128i Planes[MaxVertexSize];
+  __m128i Previous[MaxChunks];
+  for (size_t I = 0; I < 16 * NumChunks; ++I) {
+    Planes[I] = _mm_setzero_si128();
+  }
+  for (size_t I = 0; I < NumChunks; ++I) {
+    Previous[I] = _mm_setzero_si128();
+  }
+  // The block's vertices, VertexSize rounded up to whole chunks.
+  __m128i Block[VertexBlockSize][MaxChunks];
+  plane_size_table Table;
+
+  for (size_t Base = 0; Base < NumVertices; Base += VertexBlockSize) {
+    if (!has_vertex_block(At, End, VertexSize, Table)) {
+      return false;
+    }
+    size_t NumInBlock = std::min(VertexBlockSize, NumVertices - Base);
+    const u8* Header = At;
+    At += (VertexSize + 3) / 4;
+    for (size_t Byte = 0; Byte < VertexSize; ++Byte) {
+      Planes[Byte] = unpack_plane_sse2(get_plane_mode(Header, Byte), At);
+    }
+    u8* Out = Vertices + Base * VertexSize;
+    for (size_t Chunk = 0; Chunk < NumChunks; ++Chunk) {
+      __m128i Rows[16];
+      for (i32 I = 0; I < 16; ++I) {
+        Rows[I] = Planes[16 * Chunk + I];
+      }
+      transpose_16x16(Rows);
+      __m128i Sum = Previous[Chunk];
+      for (size_t I = 0; I < VertexBlockSize; ++I) {
+        Sum = _mm_add_epi8(Sum, Rows[I]);
+        Block[I][Chunk] = Sum;
+      }
+      Previous[Chunk] = Sum;
+    }
+    // Whole chunks spill into the next vertex, which is written right after. Only the end of
+    // the buffer needs an exact copy.
+    for (size_t I = 0; I < NumInBlock; ++I) {
+      u8* Vertex = Out + I * VertexSize;
+      if ((Base + I) * VertexSize + 16 * NumChunks <= NumVertices * VertexSize) {
+        for (size_t Chunk = 0; Chunk < NumChunks; ++Chunk) {
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(Vertex + 16 * Chunk), Block[I][Chunk]);
+        }
+      } else {
+        memcpy(Vertex, Block[I], VertexSize);
+      }
+    }
+  }
+  return true;
+}
+#endif // STORECAST_X64
+
+const char CompressedMeshMagic[8] = {'S', 'C', 'Z', 'M', 'E', 'S', 'H', 0};
+// Bump this whenever any of the codecs or the layout changes.
+const u32 CompressedMeshVersion = 1;
+const u32 ByteOrderMark = 0x01020304;
+
+// Followed by the vertex, triangle and quad data, the ranges as they are in memory, and the
+// material names, each one followed by a '\0'.
+struct compressed_mesh_header {
+  char Magic[8];
+  u32 Version;
+  u32 ByteOrderMark;
+  u32 VertexSize;
+  u32 RangeSize;
+  u64 NumVertices;
+  u64 NumTriangleIndices;
+  u64 NumQuadIndices;
+  u64 NumTriangleRanges;
+  u64 NumQuadRanges;
+  u64 MaterialNamesSize;
+  u64 VertexDataSize;
+  u64 TriangleDataSize;
+  u64 QuadDataSize;
+};
+
+template <class element_type>
+void append_bytes(vector<u8>& Out, const element_type* Data, size_t Count)
+{
+  auto* Bytes = reinterpret_cast<const u8*>(Data);
+  Out.insert(Out.end(), Bytes, Bytes + Count * sizeof(element_type));
+}
+
+// Points Section at the next Size bytes at At, and advances At past them. Returns false if
+// there aren't enough bytes left.
+bool read_section(const u8*& At, const u8* End, u64 Size, const u8*& Section)
+{
+  if (Size > static_cast<u64>(End - At)) {
+    return false;
+  }
+  Section = At;
+  At += Size;
+  return true;
+}
+
+// True if every range is within an index buffer of NumIndices.
+bool validate_ranges(const vector<mesh_range>& Ranges, size_t NumIndices)
+{
+  for (auto& Range: Ranges) {
+    if (Range.StartIndex < 0 || Range.NumIndices < 0
+        || static_cast<size_t>(Range.StartIndex) + static_cast<size_t>(Range.NumIndices)
+            > NumIndices) {
+      return false;
+    }
+  }
+  return true;
+}
+} // anonymous namespace
+
+vector<u8> encode_triangle_indices(const vector<i32>& Indices)
+{
+  size_t NumTriangles = Indices.size() / 3;
+  vector<u8> Result(NumTriangles + (NumTriangles + 3) / 4, 0);
+  u8* Rotations = Result.data() + NumTriangles;
+  vector<u8> Data;
+  vector<u8> Extra;
+  index_coder_state State;
+  for (size_t T = 0; T < NumTriangles; ++T) {
+    const i32* Triangle = &Indices[3 * T];
+    u32 Age;
+    i32 Rotation;
+    Extra.clear();
+    if (find_edge(State, Triangle, Age, Rotation)) {
+      i32 A = Triangle[Rotation];
+      i32 B = Triangle[(Rotation + 1) % 3];
+      i32 C = Triangle[(Rotation + 2) % 3];
+      Result[T] = static_cast<u8>(Age << 4 | encode_vertex(State, C, Extra));
+      Rotations[T / 4] |= static_cast<u8>(Rotation << (T % 4 * 2));
+      State.push_edges(A, B, C, false);
+    } else {
+      u32 CodeA = encode_vertex(State, Triangle[0], Extra);
+      u32 CodeB = encode_vertex(State, Triangle[1], Extra);
+      u32 CodeC = encode_vertex(State, Triangle[2], Extra);
+      Result[T] = static_cast<u8>(FreeTriangle << 4 | CodeA);
+      Data.push_back(static_cast<u8>(CodeB | CodeC << 4));
+      State.push_edges(Triangle[0], Triangle[1], Triangle[2], true);
+    }
+    Data.insert(Data.end(), Extra.begin(), Extra.end());
+  }
+  Result.insert(Result.end(), Data.begin(), Data.end());
+  return Result;
+}
+
+bool decode_triangle_indices(i32* Indices, size_t NumIndices, const u8* Data, size_t Size)
+{
+  size_t NumTriangles = NumIndices / 3;
+  size_t NumRotationBytes = (NumTriangles + 3) / 4;
+  if (NumIndices % 3 != 0 || Size < NumTriangles + NumRotationBytes) {
+    return false;
+  }
+  const u8* Codes = Data;
+  const u8* Rotations = Data + NumTriangles;
+  const u8* At = Rotations + NumRotationBytes;
+  const u8* End = Data + Size;
+  index_coder_state State;
+  for (size_t T = 0; T < NumTriangles; ++T) {
+    u32 Code = Codes[T];
+    i32* Triangle = Indices + 3 * T;
+    if ((Code >> 4) != FreeTriangle) {
+      const i32* Edge = State.get_edge(Code >> 4);
+      i32 A = Edge[0];
+      i32 B = Edge[1];
+      i32 C;
+      u32 Rotation = (Rotations[T / 4] >> (T % 4 * 2)) & 3;
+      if (Rotation > 2 || !decode_vertex(State, Code & 15, At, End, C)) {
+        return false;
+      }
+      Triangle[Rotation] = A;
+      Triangle[(Rotation + 1) % 3] = B;
+      Triangle[(Rotation + 2) % 3] = C;
+      State.push_edges(A, B, C, false);
+    } else {
+      if (At == End) {
+        return false;
+      }
+      u32 OtherCodes = *At++;
+      if (!decode_vertex(State, Code & 15, At, End, Triangle[0])
+          || !decode_vertex(State, OtherCodes & 15, At, End, Triangle[1])
+          || !decode_vertex(State, OtherCodes >> 4, At, End, Triangle[2])) {
+        return false;
+      }
+      State.push_edges(Triangle[0], Triangle[1], Triangle[2], true);
+    }
+  }
+  return At == End;
+}
+
+vector<u8> encode_index_sequence(const vector<i32>& Indices)
+{
+  vector<u8> Result;
+  Result.reserve(Indices.size());
+  u32 Last = 0;
+  for (auto Index: Indices) {
+    write_varint(Result, zigzag(static_cast<u32>(Index) - Last));
+    Last = static_cast<u32>(Index);
+  }
+  return Result;
+}
+
+bool decode_index_sequence(i32* Indices, size_t NumIndices, const u8* Data, size_t Size)
+{
+  const u8* At = Data;
+  const u8* End = Data + Size;
+  u32 Last = 0;
+  for (size_t I = 0; I < NumIndices; ++I) {
+    u32 Delta;
+    if (!read_varint(At, End, Delta)) {
+      return false;
+    }
+    Last += unzigzag(Delta);
+    Indices[I] = static_cast<i32>(Last);
+  }
+  return At == End;
+}
+
+vector<u8> encode_vertex_buffer(const void* Vertices, size_t NumVertices, size_t VertexSize)
+{
+  auto* Bytes = static_cast<const u8*>(Vertices);
+  vector<u8> Result;
+  u8 Previous[MaxVertexSize] = {};
+  u8 Plane[VertexBlockSize];
+  for (size_t Base = 0; Base < NumVertices; Base += VertexBlockSize) {
+    size_t NumInBlock = std::min(VertexBlockSize, NumVertices - Base);
+    size_t HeaderAt = Result.size();
+    Result.resize(Result.size() + (VertexSize + 3) / 4, 0);
+    for (size_t Byte = 0; Byte < VertexSize; ++Byte) {
+      u8 Value = Previous[Byte];
+      u8 Max = 0;
+      for (size_t I = 0; I < VertexBlockSize; ++I) {
+        u8 Last = Value;
+        if (I < NumInBlock) {
+          Value = Bytes[(Base + I) * VertexSize + Byte];
+        }
+        Plane[I] = zigzag8(static_cast<u8>(Value - Last));
+        Max = std::max(Max, Plane[I]);
+      }
+      Previous[Byte] = Value;
+      u32 Mode = Max == 0 ? 0 : Max < 4 ? 1 : Max < 16 ? 2 : 3;
+      Result[HeaderAt + Byte / 4] |= static_cast<u8>(Mode << (Byte % 4 * 2));
+      for (size_t I = 0; I < VertexBlockSize && Mode == 1; I += 4) {
+        Result.push_back(
+            static_cast<u8>(Plane[I] | Plane[I + 1] << 2 | Plane[I + 2] << 4 | Plane[I + 3] << 6));
+      }
+      for (size_t I = 0; I < VertexBlockSize && Mode == 2; I += 2) {
+        Result.push_back(static_cast<u8>(Plane[I] | Plane[I + 1] << 4));
+      }
+      if (Mode == 3) {
+        Result.insert(Result.end(), Plane, Plane + VertexBlockSize);
+      }
+    }
+  }
+  return Result;
+}
+
+bool decode_vertex_buffer(void* Vertices, size_t NumVertices, size_t VertexSize, const u8* Data,
+    size_t Size, simd_level Level)
+{
+  if (VertexSize == 0 || VertexSize > MaxVertexSize) {
+    return false;
+  }
+  auto* Bytes = static_cast<u8*>(Vertices);
+  const u8* At = Data;
+  const u8* End = Data + Size;
+  bool IsValid;
+  switch (Level) {
+#ifdef STORECAST_X64
+  case simd_level::AVX2:
+  case simd_level::SSE2:
+    IsValid = decode_vertex_buffer_sse2(Bytes, NumVertices, VertexSize, At, End);
+    break;
+#endif
+  default: IsValid = decode_vertex_buffer_scalar(Bytes, NumVertices, VertexSize, At, End); break;
+  }
+  return IsValid && At == End;
+}
+
+vector<u8> compress_mesh(const mesh& Mesh)
+{
+  auto VertexData =
+      encode_vertex_buffer(Mesh.Vertices.data(), Mesh.Vertices.size(), sizeof(vertex_data));
+  auto TriangleData = encode_triangle_indices(Mesh.TriangleIndices);
+  auto QuadData = encode_index_sequence(Mesh.QuadIndices);
+  std::string MaterialNames;
+  for (auto& Name: Mesh.MaterialNames) {
+    MaterialNames.append(Name.c_str(), Name.size() + 1);
+  }
+
+  compressed_mesh_header Header = {};
+  memcpy(Header.Magic, CompressedMeshMagic, sizeof(Header.Magic));
+  Header.Version = CompressedMeshVersion;
+  Header.ByteOrderMark = ByteOrderMark;
+  Header.VertexSize = sizeof(vertex_data);
+  Header.RangeSize = sizeof(mesh_range);
+  Header.NumVertices = Mesh.Vertices.size();
+  Header.NumTriangleIndices = Mesh.TriangleIndices.size();
+  Header.NumQuadIndices = Mesh.QuadIndices.size();
+  Header.NumTriangleRanges = Mesh.TriangleRanges.size();
+  Header.NumQuadRanges = Mesh.QuadRanges.size();
+  Header.MaterialNamesSize = MaterialNames.size();
+  Header.VertexDataSize = VertexData.size();
+  Header.TriangleDataSize = TriangleData.size();
+  Header.QuadDataSize = QuadData.size();
+
+  vector<u8> Result;
+  append_bytes(Result, &Header, 1);
+  append_bytes(Result, VertexData.data(), VertexData.size());
+  append_bytes(Result, TriangleData.data(), TriangleData.size());
+  append_bytes(Result, QuadData.data(), QuadData.size());
+  append_bytes(Result, Mesh.TriangleRanges.data(), Mesh.TriangleRanges.size());
+  append_bytes(Result, Mesh.QuadRanges.data(), Mesh.QuadRanges.size());
+  append_bytes(Result, MaterialNames.data(), MaterialNames.size());
+  return Result;
+}
+
+bool decompress_mesh(const u8* Data, size_t Size, mesh& Result, simd_level Level)
+{
+  Result = {};
+  compressed_mesh_header Header;
+  if (Size < sizeof(Header)) {
+    return false;
+  }
+  memcpy(&Header, Data, sizeof(Header));
+  if (memcmp(Header.Magic, CompressedMeshMagic, sizeof(Header.Magic))
+      || Header.Version != CompressedMeshVersion
+      || Header.ByteOrderMark != ByteOrderMark
+      || Header.VertexSize != sizeof(vertex_data)
+      || Header.RangeSize != sizeof(mesh_range)) {
+    return false;
+  }
+
+  // Every block of vertices, triangle and quad index takes at least a byte, so corrupt counts
+  // can't make us allocate much more than the data could hold.
+  if (Header.VertexDataSize > Size || Header.TriangleDataSize > Size
+      || Header.QuadDataSize > Size
+      || Header.NumVertices > VertexBlockSize * Header.VertexDataSize
+      || Header.NumTriangleIndices > 3 * Header.TriangleDataSize
+      || Header.NumQuadIndices > Header.QuadDataSize
+      || Header.NumTriangleRanges > Header.NumTriangleIndices
+      || Header.NumQuadRanges > Header.NumQuadIndices) {
+    return false;
+  }
+
+  const u8* At = Data + sizeof(Header);
+  const u8* End = Data + Size;
+  const u8* VertexData;
+  const u8* TriangleData;
+  const u8* QuadData;
+  const u8* TriangleRanges;
+  const u8* QuadRanges;
+  const u8* MaterialNames;
+  if (!read_section(At, End, Header.VertexDataSize, VertexData)
+      || !read_section(At, End, Header.TriangleDataSize, TriangleData)
+      || !read_section(At, End, Header.QuadDataSize, QuadData)
+      || !read_section(At, End, Header.NumTriangleRanges * sizeof(mesh_range), TriangleRanges)
+      || !read_section(At, End, Header.NumQuadRanges * sizeof(mesh_range), QuadRanges)
+      || !read_section(At, End, Header.MaterialNamesSize, MaterialNames)
+      || At != End
+      || (Header.MaterialNamesSize > 0 && MaterialNames[Header.MaterialNamesSize - 1] != 0)) {
+    return false;
+  }
+
+  Result.Vertices.resize(static_cast<size_t>(Header.NumVertices));
+  Result.TriangleIndices.resize(static_cast<size_t>(Header.NumTriangleIndices));
+  Result.QuadIndices.resize(static_cast<size_t>(Header.NumQuadIndices));
+  Result.TriangleRanges.resize(static_cast<size_t>(Header.NumTriangleRanges));
+  Result.QuadRanges.resize(static_cast<size_t>(Header.NumQuadRanges));
+  // The ranges may be unaligned in Data, so they are copied bytewise. An empty vector's data()
+  // may be null, which memcpy doesn't take even for 0 bytes.
+  if (!Result.TriangleRanges.empty()) {
+    memcpy(Result.TriangleRanges.data(), TriangleRanges, Result.TriangleRanges.size()
+        * sizeof(mesh_range));
+  }
+  if (!Result.QuadRanges.empty()) {
+    memcpy(Result.QuadRanges.data(), QuadRanges, Result.QuadRanges.size() * sizeof(mesh_range));
+  }
+  auto* Names = reinterpret_cast<const char*>(MaterialNames);
+  for (size_t I = 0; I < Header.MaterialNamesSize; ) {
+    Result.MaterialNames.push_back(Names + I);
+    I += Result.MaterialNames.back().size() + 1;
+  }
+  if (!decode_vertex_buffer(Result.Vertices.data(), Result.Vertices.size(), sizeof(vertex_data),
+          VertexData, static_cast<size_t>(Header.VertexDataSize), Level)
+      || !decode_triangle_indices(Result.TriangleIndices.data(), Result.TriangleIndices.size(),
+          TriangleData, static_cast<size_t>(Header.TriangleDataSize))
+      || !decode_index_sequence(Result.QuadIndices.data(), Result.QuadIndices.size(), QuadData,
+          static_cast<size_t>(Header.QuadDataSize))
+      // The streams decode to any indices, so check that they fit the mesh.
+      || !validate_indices(Result.TriangleIndices.data(), Result.TriangleIndices.size(),
+          Result.Vertices.size(), Level)
+      || !validate_indices(Result.QuadIndices.data(), Result.QuadIndices.size(),
+          Result.Vertices.size(), Level)
+      || !validate_ranges(Result.TriangleRanges, Result.TriangleIndices.size())
+      || !validate_ranges(Result.QuadRanges, Result.QuadIndices.size())) {
+    Result = {};
+    return false;
+  }
+  return true;
+}
+
+} // namespace storecast
@@ -0,0 +1,41 @@
+#pragma once
+#include "defines.hpp"
+#include "mesh.hpp"
+#include "mesh_soa.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace storecast
+{
+
+// Lossless compression for shipping meshes. The encoded buffers are much smaller than the raw
+// arrays, and still compress well with a general-purpose compressor afterwards. Decoding
+// reproduces the input bit for bit. Decoders never read past Size or write past NumIndices or
+// NumVertices, and they return false on malformed data, leaving the output partly written.
+// Like the mesh cache, the formats are meant for little-endian machines.
+
+// Triangle lists. Each triangle is coded relative to the recent edges and vertices, so the more
+// cache-friendly the order is (see optimize_vertex_cache and optimize_vertex_fetch), the
+// smaller the result: about 1 to 2 bytes per triangle instead of 12.
+std::vector<u8> encode_triangle_indices(const std::vector<i32>& Indices);
+bool decode_triangle_indices(i32* Indices, size_t NumIndices, const u8* Data, size_t Size);
+
+// Any index list, coded as the differences between consecutive indices. Used for quads.
+std::vector<u8> encode_index_sequence(const std::vector<i32>& Indices);
+bool decode_index_sequence(i32* Indices, size_t NumIndices, const u8* Data, size_t Size);
+
+// Arrays of VertexSize-byte vertices, with VertexSize in [1, 256]. Each byte of a vertex is
+// coded as the difference to the same byte of the previous vertex, in blocks of 16 vertices
+// that use only as many bits per difference as they need. Neighboring vertices tend to share
+// their sign, exponent and top mantissa bits, so those cost little.
+std::vector<u8> encode_vertex_buffer(const void* Vertices, size_t NumVertices, size_t VertexSize);
+bool decode_vertex_buffer(void* Vertices, size_t NumVertices, size_t VertexSize, const u8* Data,
+    size_t Size, simd_level Level = get_simd_level());
+
+// A whole mesh, with all of the above, in one buffer. Besides malformed data, decompress_mesh
+// also rejects indices outside the vertices and ranges outside their index buffers.
+std::vector<u8> compress_mesh(const mesh& Mesh);
+bool decompress_mesh(const u8* Data, size_t Size, mesh& Result,
+    simd_level Level = get_simd_level());
+
+} // namespace storecast
@@ -0,0 +1,263 @@
+#include "mesh_optimize.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace storecast
+{
+using std::vector;
+
+namespace {
+// Tipsify state for the triangles of one range. Vertices are renumbered in first-use order, so
+// that all arrays are sized by the range rather than the whole mesh.
+struct tipsify_state {
+  vector<i32> Triangles;
+  vector<i32> AdjacencyOffsets;
+  vector<i32> Adjacency;
+  vector<i32> LiveTriangles;
+  vector<i32> CacheTimes;
+  vector<i32> DeadEndStack;
+  vector<i32> Candidates;
+  vector<bool> Emitted;
+};
+
+// Picks the next fanning vertex among the vertices of the last emitted triangles: the one that
+// will stay in the cache longest after its remaining triangles are emitted, or -1 if none of
+// them still has triangles or would stay in the cache.
+i32 get_next_vertex(const tipsify_state& State, i32 Timestamp, i32 CacheSize)
+{
+  i32 Best = -1;
+  i32 BestPriority = -1;
+  for (auto V: State.Candidates) {
+    if (State.LiveTriangles[V] <= 0) {
+      continue;
+    }
+    i32 Priority = 0;
+    i32 Age = Timestamp - State.CacheTimes[V];
+    if (Age + 2 * State.LiveTriangles[V] <= CacheSize) {
+      Priority = Age;
+    }
+    if (Priority > BestPriority) {
+      Best = V;
+      BestPriority = Priority;
+    }
+  }
+  return Best;
+}
+
+// Recently used vertices that still have triangles come first, then the first unfinished vertex
+// in input order.
+i32 skip_dead_end(tipsify_state& State, i32& Cursor)
+{
+  while (!State.DeadEndStack.empty()) {
+    auto V = State.DeadEndStack.back();
+    State.DeadEndStack.pop_back();
+    if (State.LiveTriangles[V] > 0) {
+      return V;
+    }
+  }
+  auto NumVertices = static_cast<i32>(State.LiveTriangles.size());
+  for (; Cursor < NumVertices; ++Cursor) {
+    if (State.LiveTriangles[Cursor] > 0) {
+      return Cursor;
+    }
+  }
+  return -1;
+}
+
+// Reorders the NumIndices / 3 triangles at Indices in place. LocalIndices maps mesh vertices to
+// range vertices; it must be all -1 on entry, and is left that way.
+void tipsify(i32* Indices, i32 NumIndices, i32 CacheSize, vector<i32>& LocalIndices,
+    tipsify_state& State)
+{
+  auto& Triangles = State.Triangles;
+  Triangles.resize(NumIndices);
+  vector<i32> GlobalIndices;
+  for (i32 I = 0; I < NumIndices; ++I) {
+    auto& Local = LocalIndices[Indices[I]];
+    if (Local < 0) {
+      Local = static_cast<i32>(GlobalIndices.size());
+      GlobalIndices.push_back(Indices[I]);
+    }
+    Triangles[I] = Local;
+  }
+  auto NumVertices = static_cast<i32>(GlobalIndices.size());
+  auto NumTriangles = NumIndices / 3;
+
+  State.LiveTriangles.assign(NumVertices, 0);
+  for (auto V: Triangles) {
+    ++State.LiveTriangles[V];
+  }
+  State.AdjacencyOffsets.resize(NumVertices + 1);
+  State.AdjacencyOffsets[0] = 0;
+  for (i32 V = 0; V < NumVertices; ++V) {
+    State.AdjacencyOffsets[V + 1] = State.AdjacencyOffsets[V] + State.LiveTriangles[V];
+  }
+  State.Adjacency.resize(NumIndices);
+  {
+    vector<i32> Fill(State.AdjacencyOffsets.begin(), State.AdjacencyOffsets.end() - 1);
+    for (i32 I = 0; I < NumIndices; ++I) {
+      State.Adjacency[Fill[Triangles[I]]++] = I / 3;
+    }
+  }
+
+  // Timestamps start far enough ahead that no vertex counts as cached.
+  State.CacheTimes.assign(NumVertices, 0);
+  i32 Timestamp = CacheSize + 1;
+  i32 Cursor = 0;
+  State.DeadEndStack.clear();
+  State.Emitted.assign(NumTriangles, false);
+
+  vector<i32> Output;
+  Output.reserve(NumIndices);
+  i32 Fanning = NumVertices > 0 ? 0 : -1;
+  while (Fanning >= 0) {
+    State.Candidates.clear();
+    for (auto A = State.AdjacencyOffsets[Fanning]; A < State.AdjacencyOffsets[Fanning + 1]; ++A) {
+      auto T = State.Adjacency[A];
+      if (State.Emitted[T]) {
+        continue;
+      }
+      State.Emitted[T] = true;
+      for (i32 Corner = 0; Corner < 3; ++Corner) {
+        auto V = Triangles[3 * T + Corner];
+        Output.push_back(GlobalIndices[V]);
+        State.DeadEndStack.push_back(V);
+        State.Candidates.push_back(V);
+        --State.LiveTriangles[V];
+        if (Timestamp - State.CacheTimes[V] > CacheSize) {
+          State.CacheTimes[V] = Timestamp++;
+        }
+      }
+    }
+    Fanning = get_next_vertex(State, Timestamp, CacheSize);
+    if (Fanning < 0) {
+      Fanning = skip_dead_end(State, Cursor);
+    }
+  }
+
+  std::copy(Output.begin(), Output.end(), Indices);
+  for (auto V: GlobalIndices) {
+    LocalIndices[V] = -1;
+  }
+}
+} // anonymous namespace
+
+vertex_cache_stats measure_vertex_cache(const vector<i32>& TriangleIndices, i32 CacheSize)
+{
+  i32 NumVertices = 0;
+  for (auto V: TriangleIndices) {
+    NumVertices = std::max(NumVertices, V + 1);
+  }
+  // A vertex is in the FIFO cache if fewer than CacheSize misses happened since it was loaded.
+  vector<i64> LoadTimes(NumVertices, -1);
+  vector<bool> Referenced(NumVertices, false);
+  i64 NumMisses = 0;
+  i64 NumReferenced = 0;
+  for (auto V: TriangleIndices) {
+    if (LoadTimes[V] < 0 || NumMisses - LoadTimes[V] >= CacheSize) {
+      LoadTimes[V] = NumMisses++;
+    }
+    if (!Referenced[V]) {
+      Referenced[V] = true;
+      ++NumReferenced;
+    }
+  }
+  vertex_cache_stats Stats = {0.f, 0.f};
+  auto NumTriangles = TriangleIndices.size() / 3;
+  if (NumTriangles > 0) {
+    Stats.ACMR = static_cast<f32>(NumMisses) / static_cast<f32>(NumTriangles);
+    Stats.ATVR = static_cast<f32>(NumMisses) / static_cast<f32>(NumReferenced);
+  }
+  return Stats;
+}
+
+vertex_cache_report optimize_vertex_cache(mesh& Mesh, i32 CacheSize)
+{
+  vertex_cache_report Report;
+  Report.Before = measure_vertex_cache(Mesh.TriangleIndices, CacheSize);
+
+  vector<i32> LocalIndices(Mesh.Vertices.size(), -1);
+  tipsify_state State;
+  auto optimize_range = [&](i32 StartIndex, i32 NumIndices) {
+    tipsify(Mesh.TriangleIndices.data() + StartIndex, NumIndices, CacheSize, LocalIndices, State);
+  };
+  if (Mesh.TriangleRanges.empty()) {
+    optimize_range(0, static_cast<i32>(Mesh.TriangleIndices.size()));
+  } else {
+    for (auto& Range: Mesh.TriangleRanges) {
+      optimize_range(Range.StartIndex, Range.NumIndices);
+    }
+  }
+
+  Report.After = measure_vertex_cache(Mesh.TriangleIndices, CacheSize);
+  return Report;
+}
+
+vertex_fetch_stats measure_vertex_fetch(const mesh& Mesh)
+{
+  // A direct-mapped cache is close enough to what GPU vertex fetch and our CPU-side skinning see.
+  constexpr size_t LineSize = 64;
+  constexpr size_t NumCacheLines = 64;
+  constexpr size_t VertexSize = sizeof(vertex_data);
+
+  vector<size_t> CachedLines(NumCacheLines, SIZE_MAX);
+  vector<bool> Referenced(Mesh.Vertices.size(), false);
+  size_t NumLinesLoaded = 0;
+  size_t NumReferenced = 0;
+  auto fetch = [&](const vector<i32>& Indices) {
+    for (auto V: Indices) {
+      auto Begin = static_cast<size_t>(V) * VertexSize;
+      for (auto Line = Begin / LineSize; Line <= (Begin + VertexSize - 1) / LineSize; ++Line) {
+        auto& Cached = CachedLines[Line % NumCacheLines];
+        if (Cached != Line) {
+          Cached = Line;
+          ++NumLinesLoaded;
+        }
+      }
+      if (!Referenced[V]) {
+        Referenced[V] = true;
+        ++NumReferenced;
+      }
+    }
+  };
+  fetch(Mesh.TriangleIndices);
+  fetch(Mesh.QuadIndices);
+
+  vertex_fetch_stats Stats = {0.f};
+  if (NumReferenced > 0) {
+    Stats.Overfetch = static_cast<f32>(NumLinesLoaded * LineSize)
+        / static_cast<f32>(NumReferenced * VertexSize);
+  }
+  return Stats;
+}
+
+vertex_fetch_report optimize_vertex_fetch(mesh& Mesh)
+{
+  vertex_fetch_report Report;
+  Report.Before = measure_vertex_fetch(Mesh);
+
+  vector<i32> NewIndices(Mesh.Vertices.size(), -1);
+  vector<vertex_data> Vertices;
+  Vertices.reserve(Mesh.Vertices.size());
+  auto remap = [&](vector<i32>& Indices) {
+    for (auto& V: Indices) {
+      auto& NewIndex = NewIndices[V];
+      if (NewIndex < 0) {
+        NewIndex = static_cast<i32>(Vertices.size());
+        Vertices.push_back(Mesh.Vertices[V]);
+      }
+      V = NewIndex;
+    }
+  };
+  remap(Mesh.TriangleIndices);
+  remap(Mesh.QuadIndices);
+  Report.NumUnusedVertices = static_cast<i32>(Mesh.Vertices.size() - Vertices.size());
+  Mesh.Vertices = std::move(Vertices);
+
+  Report.After = measure_vertex_fetch(Mesh);
+  return Report;
+}
+
+} // namespace storecast
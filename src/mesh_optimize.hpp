@@ -0,0 +1,53 @@
+#pragma once
+#include "defines.hpp"
+#include "mesh.hpp"
+#include <vector>
+
+namespace storecast
+{
+
+// Post-transform vertex cache behaviour of an index buffer, simulated with a FIFO cache.
+struct vertex_cache_stats {
+  // Average cache miss ratio: vertex shader invocations per triangle. Between 0.5 for an ideal
+  // regular grid and 3.
+  f32 ACMR;
+  // Average transform to vertex ratio: vertex shader invocations per referenced vertex. 1 is
+  // optimal.
+  f32 ATVR;
+};
+struct vertex_cache_report {
+  vertex_cache_stats Before;
+  vertex_cache_stats After;
+};
+
+vertex_cache_stats measure_vertex_cache(const std::vector<i32>& TriangleIndices, i32 CacheSize);
+
+// Reorders the triangles in Mesh.TriangleIndices for better post-transform vertex cache reuse,
+// with Tipsify [Sander et al. 2007]. Runs in linear time. The triangles stay the same, including
+// their winding, and each one stays in its mesh_range, so the draw commands don't change. Quads
+// are left alone; triangulate on import to include them.
+vertex_cache_report optimize_vertex_cache(mesh& Mesh, i32 CacheSize = 16);
+
+// How well reading the vertices in index buffer order streams through memory, simulated with a
+// small cache of 64 byte lines.
+struct vertex_fetch_stats {
+  // Bytes loaded into the cache, divided by the size of the vertices the indices reference. 1 is
+  // optimal.
+  f32 Overfetch;
+};
+struct vertex_fetch_report {
+  vertex_fetch_stats Before;
+  vertex_fetch_stats After;
+  i32 NumUnusedVertices;
+};
+
+// Measures fetching the vertices for TriangleIndices and then QuadIndices, in the order the draw
+// commands do.
+vertex_fetch_stats measure_vertex_fetch(const mesh& Mesh);
+
+// Rewrites Mesh.Vertices into the order in which the triangles and then the quads first use
+// them, drops the vertices that no face uses, and remaps the indices to match. Run it after
+// optimize_vertex_cache, which changes the order of first use.
+vertex_fetch_report optimize_vertex_fetch(mesh& Mesh);
+
+} // namespace storecast
@@ -0,0 +1,269 @@
+#include "mesh_quantize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace storecast
+{
+using std::vector;
+
+namespace {
+f32 sign_not_zero(f32 Value)
+{
+  return Value >= 0.f ? 1.f : -1.f;
+}
+
+i32 round_to_i32(f32 Value)
+{
+  return static_cast<i32>(std::lround(Value));
+}
+
+i32 clamp(i32 Value, i32 Min, i32 Max)
+{
+  return std::min(std::max(Value, Min), Max);
+}
+
+u16 to_unorm16(f32 Value, f32 Offset, f32 Scale)
+{
+  if (Scale <= 0.f) {
+    return 0;
+  }
+  return static_cast<u16>(clamp(round_to_i32((Value - Offset) / Scale), 0, 65535));
+}
+
+void encode_octahedral(const vec3& Normal, i16 Encoded[2])
+{
+  f32 Length = std::fabs(Normal.X) + std::fabs(Normal.Y) + std::fabs(Normal.Z);
+  if (Length == 0.f) {
+    Encoded[0] = Encoded[1] = 0;
+    return;
+  }
+  f32 X = Normal.X / Length;
+  f32 Y = Normal.Y / Length;
+  if (Normal.Z < 0.f) {
+    f32 FoldedX = (1.f - std::fabs(Y)) * sign_not_zero(X);
+    f32 FoldedY = (1.f - std::fabs(X)) * sign_not_zero(Y);
+    X = FoldedX;
+    Y = FoldedY;
+  }
+  Encoded[0] = static_cast<i16>(clamp(round_to_i32(X * 32767.f), -32767, 32767));
+  Encoded[1] = static_cast<i16>(clamp(round_to_i32(Y * 32767.f), -32767, 32767));
+}
+
+vec3 decode_octahedral(const i16 Encoded[2])
+{
+  f32 X = Encoded[0] / 32767.f;
+  f32 Y = Encoded[1] / 32767.f;
+  vec3 Normal = {X, Y, 1.f - std::fabs(X) - std::fabs(Y)};
+  if (Normal.Z < 0.f) {
+    Normal.X = (1.f - std::fabs(Y)) * sign_not_zero(X);
+    Normal.Y = (1.f - std::fabs(X)) * sign_not_zero(Y);
+  }
+  return Normal * (1.f / std::sqrt(length_squared(Normal)));
+}
+
+void write_indices(const vector<i32>& Indices, u32 IndexSize, vector<u8>& Result)
+{
+  Result.resize(Indices.size() * IndexSize);
+  for (size_t I = 0; I < Indices.size(); ++I) {
+    if (IndexSize == 2) {
+      auto Index = static_cast<u16>(Indices[I]);
+      memcpy(&Result[2 * I], &Index, 2);
+    } else {
+      auto Index = static_cast<u32>(Indices[I]);
+      memcpy(&Result[4 * I], &Index, 4);
+    }
+  }
+}
+
+i32 read_index(const vector<u8>& Indices, u32 IndexSize, size_t I)
+{
+  if (IndexSize == 2) {
+    u16 Index;
+    memcpy(&Index, &Indices[2 * I], 2);
+    return Index;
+  }
+  u32 Index;
+  memcpy(&Index, &Indices[4 * I], 4);
+  return static_cast<i32>(Index);
+}
+} // anonymous namespace
+
+u16 f32_to_half(f32 Value)
+{
+  u32 Bits;
+  memcpy(&Bits, &Value, 4);
+  u32 Sign = (Bits >> 16) & 0x8000;
+  u32 Abs = Bits & 0x7fffffff;
+  if (Abs >= 0x7f800000) {
+    // Infinity stays infinity, and NaN stays a quiet NaN.
+    return static_cast<u16>(Sign | 0x7c00 | (Abs > 0x7f800000 ? 0x200 : 0));
+  }
+  // 65520 and up round to infinity.
+  if (Abs >= 0x477ff000) {
+    return static_cast<u16>(Sign | 0x7c00);
+  }
+  // Below 2^-14, halfs are subnormal, with a fixed step of 2^-24.
+  if (Abs < 0x38800000) {
+    f32 AbsValue;
+    memcpy(&AbsValue, &Abs, 4);
+    return static_cast<u16>(Sign | static_cast<u32>(std::nearbyint(AbsValue * 16777216.f)));
+  }
+  // Rebias the exponent from 127 to 15, and round the mantissa to nearest even.
+  u32 Rounded = Abs + 0xfff + ((Abs >> 13) & 1);
+  return static_cast<u16>(Sign | ((Rounded - 0x38000000) >> 13));
+}
+
+f32 half_to_f32(u16 Value)
+{
+  u32 Sign = static_cast<u32>(Value & 0x8000) << 16;
+  u32 Exponent = (Value >> 10) & 0x1f;
+  u32 Mantissa = Value & 0x3ff;
+  if (Exponent == 0) {
+    f32 Result = Mantissa / 16777216.f;
+    return Sign ? -Result : Result;
+  }
+  u32 Bits = Exponent == 31
+      ? Sign | 0x7f800000 | (Mantissa << 13)
+      : Sign | ((Exponent + 112) << 23) | (Mantissa << 13);
+  f32 Result;
+  memcpy(&Result, &Bits, 4);
+  return Result;
+}
+
+quantized_mesh quantize_mesh(const mesh& Mesh, const quantize_options& Options)
+{
+  quantized_mesh Result;
+  Result.QuantizedPositions = Options.QuantizePositions;
+  Result.UvFormat = Options.UvFormat;
+  // Three u16s are padded to 8 bytes, so that the normal stays 4 byte aligned.
+  Result.NormalByteOffset = Options.QuantizePositions ? 8 : 12;
+  Result.UvByteOffset = Result.NormalByteOffset + 4;
+  Result.VertexStride = Result.UvByteOffset + 4;
+
+  vec3 Min = {0.f, 0.f, 0.f};
+  vec3 Max = {0.f, 0.f, 0.f};
+  f32 UvMin[2] = {0.f, 0.f};
+  f32 UvMax[2] = {0.f, 0.f};
+  if (!Mesh.Vertices.empty()) {
+    Min = Max = Mesh.Vertices[0].Position;
+    for (i32 I = 0; I < 2; ++I) {
+      UvMin[I] = UvMax[I] = Mesh.Vertices[0].TextureCoords.Data[I];
+    }
+  }
+  for (auto& Vertex: Mesh.Vertices) {
+    for3(I) {
+      Min.Data[I] = std::min(Min.Data[I], Vertex.Position.Data[I]);
+      Max.Data[I] = std::max(Max.Data[I], Vertex.Position.Data[I]);
+    }
+    for (i32 I = 0; I < 2; ++I) {
+      UvMin[I] = std::min(UvMin[I], Vertex.TextureCoords.Data[I]);
+      UvMax[I] = std::max(UvMax[I], Vertex.TextureCoords.Data[I]);
+    }
+  }
+  Result.PositionOffset = Min;
+  Result.PositionScale = (Max - Min) * (1.f / 65535.f);
+  for (i32 I = 0; I < 2; ++I) {
+    Result.UvOffset[I] = UvMin[I];
+    Result.UvScale[I] = (UvMax[I] - UvMin[I]) / 65535.f;
+  }
+
+  Result.Vertices.assign(Mesh.Vertices.size() * Result.VertexStride, 0);
+  for (size_t V = 0; V < Mesh.Vertices.size(); ++V) {
+    auto& Vertex = Mesh.Vertices[V];
+    u8* Out = &Result.Vertices[V * Result.VertexStride];
+    if (Options.QuantizePositions) {
+      u16 Position[3];
+      for3(I) {
+        Position[I] = to_unorm16(
+            Vertex.Position.Data[I], Result.PositionOffset.Data[I], Result.PositionScale.Data[I]);
+      }
+      memcpy(Out, Position, sizeof(Position));
+    } else {
+      memcpy(Out, &Vertex.Position, sizeof(vec3));
+    }
+    i16 Normal[2];
+    encode_octahedral(Vertex.Normal, Normal);
+    memcpy(Out + Result.NormalByteOffset, Normal, sizeof(Normal));
+    u16 Uv[2];
+    for (i32 I = 0; I < 2; ++I) {
+      Uv[I] = Options.UvFormat == uv_format::HALF
+          ? f32_to_half(Vertex.TextureCoords.Data[I])
+          : to_unorm16(Vertex.TextureCoords.Data[I], Result.UvOffset[I], Result.UvScale[I]);
+    }
+    memcpy(Out + Result.UvByteOffset, Uv, sizeof(Uv));
+  }
+
+  Result.IndexSize = Mesh.Vertices.size() <= 65536 ? 2 : 4;
+  write_indices(Mesh.TriangleIndices, Result.IndexSize, Result.TriangleIndices);
+  write_indices(Mesh.QuadIndices, Result.IndexSize, Result.QuadIndices);
+  Result.TriangleRanges = Mesh.TriangleRanges;
+  Result.QuadRanges = Mesh.QuadRanges;
+  Result.MaterialNames = Mesh.MaterialNames;
+  return Result;
+}
+
+vertex_data dequantize_vertex(const quantized_mesh& Mesh, size_t Index)
+{
+  vertex_data Vertex;
+  const u8* In = &Mesh.Vertices[Index * Mesh.VertexStride];
+  if (Mesh.QuantizedPositions) {
+    u16 Position[3];
+    memcpy(Position, In, sizeof(Position));
+    for3(I) {
+      Vertex.Position.Data[I] =
+          Mesh.PositionOffset.Data[I] + Position[I] * Mesh.PositionScale.Data[I];
+    }
+  } else {
+    memcpy(&Vertex.Position, In, sizeof(vec3));
+  }
+  i16 Normal[2];
+  memcpy(Normal, In + Mesh.NormalByteOffset, sizeof(Normal));
+  Vertex.Normal = decode_octahedral(Normal);
+  u16 Uv[2];
+  memcpy(Uv, In + Mesh.UvByteOffset, sizeof(Uv));
+  for (i32 I = 0; I < 2; ++I) {
+    Vertex.TextureCoords.Data[I] = Mesh.UvFormat == uv_format::HALF
+        ? half_to_f32(Uv[I])
+        : Mesh.UvOffset[I] + Uv[I] * Mesh.UvScale[I];
+  }
+  Vertex.TextureCoords.Z = 0.f;
+  return Vertex;
+}
+
+i32 get_triangle_index(const quantized_mesh& Mesh, size_t I)
+{
+  return read_index(Mesh.TriangleIndices, Mesh.IndexSize, I);
+}
+
+i32 get_quad_index(const quantized_mesh& Mesh, size_t I)
+{
+  return read_index(Mesh.QuadIndices, Mesh.IndexSize, I);
+}
+
+quantization_error measure_quantization_error(const mesh& Mesh, const quantized_mesh& Quantized)
+{
+  quantization_error Error = {0.f, 0.f, 0.f};
+  for (size_t V = 0; V < Mesh.Vertices.size(); ++V) {
+    auto& Vertex = Mesh.Vertices[V];
+    auto Decoded = dequantize_vertex(Quantized, V);
+    Error.MaxPositionError = std::max(Error.MaxPositionError,
+        std::sqrt(length_squared(Decoded.Position - Vertex.Position)));
+    if (length_squared(Vertex.Normal) > 0.f) {
+      // Unlike acos of the dot product, this stays accurate for the tiny angles we expect.
+      f32 Angle = std::atan2(std::sqrt(length_squared(cross(Decoded.Normal, Vertex.Normal))),
+          dot(Decoded.Normal, Vertex.Normal));
+      Error.MaxNormalErrorDegrees = std::max(Error.MaxNormalErrorDegrees, Angle);
+    }
+    for (i32 I = 0; I < 2; ++I) {
+      Error.MaxUvError = std::max(Error.MaxUvError,
+          std::fabs(Decoded.TextureCoords.Data[I] - Vertex.TextureCoords.Data[I]));
+    }
+  }
+  Error.MaxNormalErrorDegrees *= 180.f / 3.14159265f;
+  return Error;
+}
+
+} // namespace storecast
@@ -0,0 +1,73 @@
+#pragma once
+#include "defines.hpp"
+#include "mesh.hpp"
+#include <vector>
+
+namespace storecast
+{
+
+// Compact vertex and index buffers for uploading a mesh, at roughly half the size of a mesh:
+// - Normals are octahedral-encoded into two snorm16s [Cigolle et al. 2014].
+// - Texture coordinates lose their Z, and become two halfs or two unorm16s.
+// - Positions stay three floats, or become three unorm16s relative to the bounding box.
+// - Indices are u16 if there are at most 65536 vertices, and u32 otherwise.
+// The faces and ranges are unchanged, so the draw commands of the mesh still apply.
+
+enum class uv_format { HALF, UNORM16 };
+
+struct quantize_options {
+  // Fixed-point positions are accurate to 1/65535 of the bounding box, which is fine for
+  // small meshes, but not for levels or terrain.
+  bool QuantizePositions = false;
+  uv_format UvFormat = uv_format::HALF;
+};
+
+struct quantized_mesh {
+  bool QuantizedPositions;
+  uv_format UvFormat;
+  // Each vertex is VertexStride bytes: the position at byte 0, the normal at NormalByteOffset,
+  // and the texture coordinates at UvByteOffset.
+  u32 VertexStride;
+  u32 NormalByteOffset;
+  u32 UvByteOffset;
+  std::vector<u8> Vertices;
+  // Fixed-point values decode to Offset + Value * Scale.
+  vec3 PositionOffset;
+  vec3 PositionScale;
+  f32 UvOffset[2];
+  f32 UvScale[2];
+  // 2 or 4.
+  u32 IndexSize;
+  std::vector<u8> TriangleIndices;
+  std::vector<u8> QuadIndices;
+  std::vector<mesh_range> TriangleRanges;
+  std::vector<mesh_range> QuadRanges;
+  std::vector<std::string> MaterialNames;
+
+  size_t get_num_vertices() const { return VertexStride > 0 ? Vertices.size() / VertexStride : 0; }
+  size_t get_size_in_bytes() const
+  {
+    return Vertices.size() + TriangleIndices.size() + QuadIndices.size();
+  }
+};
+
+quantized_mesh quantize_mesh(const mesh& Mesh, const quantize_options& Options = {});
+
+// Decodes one vertex. TextureCoords.Z is always 0, and vertices without a normal get (0, 0, 1).
+vertex_data dequantize_vertex(const quantized_mesh& Mesh, size_t Index);
+i32 get_triangle_index(const quantized_mesh& Mesh, size_t I);
+i32 get_quad_index(const quantized_mesh& Mesh, size_t I);
+
+// The largest difference between the mesh and its quantized version after decoding. Normals are
+// compared by angle, and vertices without a normal are skipped.
+struct quantization_error {
+  f32 MaxPositionError;
+  f32 MaxNormalErrorDegrees;
+  f32 MaxUvError;
+};
+quantization_error measure_quantization_error(const mesh& Mesh, const quantized_mesh& Quantized);
+
+u16 f32_to_half(f32 Value);
+f32 half_to_f32(u16 Value);
+
+} // namespace storecast
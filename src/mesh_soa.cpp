@@ -0,0 +1,491 @@
+#include "mesh_soa.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define STORECAST_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC compiles AVX2 intrinsics anywhere; we only call them after checking the CPU.
+#define STORECAST_TARGET_AVX2
+#else
+#define STORECAST_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Fusing a multiply and an add into an FMA changes the rounding, and the levels have to match
+// bit for bit. build.sh passes -ffp-contract=off and build.bat /fp:precise, so that the compiler
+// doesn't do it behind our back.
+
+namespace storecast
+{
+using std::vector;
+
+namespace {
+void copy_to_soa(const vector<vertex_data>& Vertices, vec3 vertex_data::*Member, soa_vec3& Result)
+{
+  size_t NumVertices = Vertices.size();
+  size_t Size = (NumVertices + SoaPadding - 1) / SoaPadding * SoaPadding;
+  Result.X.resize(Size);
+  Result.Y.resize(Size);
+  Result.Z.resize(Size);
+  for (size_t I = 0; I < NumVertices; ++I) {
+    auto& Value = Vertices[I].*Member;
+    Result.X[I] = Value.X;
+    Result.Y[I] = Value.Y;
+    Result.Z[I] = Value.Z;
+  }
+  for (size_t I = NumVertices; I < Size; ++I) {
+    Result.X[I] = Result.X[NumVertices - 1];
+    Result.Y[I] = Result.Y[NumVertices - 1];
+    Result.Z[I] = Result.Z[NumVertices - 1];
+  }
+}
+
+vec3 get(const soa_vec3& Values, size_t I)
+{
+  return {Values.X[I], Values.Y[I], Values.Z[I]};
+}
+
+// Like std::min and std::max, but with the operands in the order minps and maxps use, so that
+// all levels pick the same value.
+f32 min_f32(f32 A, f32 B) { return A < B ? A : B; }
+f32 max_f32(f32 A, f32 B) { return A > B ? A : B; }
+
+// Adding zero turns -0 into +0. Which zero wins a min or max depends on the order of the
+// comparisons, and that differs between the levels.
+vec3 without_negative_zero(const vec3& V) { return {V.X + 0.f, V.Y + 0.f, V.Z + 0.f}; }
+
+aabb compute_aabb_scalar(const soa_vec3& P)
+{
+  aabb Box = {get(P, 0), get(P, 0)};
+  for (size_t I = 0; I < P.X.size(); ++I) {
+    vec3 Position = get(P, I);
+    for3(Axis) {
+      Box.Min.Data[Axis] = min_f32(Box.Min.Data[Axis], Position.Data[Axis]);
+      Box.Max.Data[Axis] = max_f32(Box.Max.Data[Axis], Position.Data[Axis]);
+    }
+  }
+  return Box;
+}
+
+f32 get_max_distance_squared_scalar(const soa_vec3& P, const vec3& Center)
+{
+  f32 Result = 0.f;
+  for (size_t I = 0; I < P.X.size(); ++I) {
+    f32 DX = P.X[I] - Center.X;
+    f32 DY = P.Y[I] - Center.Y;
+    f32 DZ = P.Z[I] - Center.Z;
+    Result = max_f32(Result, DX * DX + DY * DY + DZ * DZ);
+  }
+  return Result;
+}
+
+void transform_positions_scalar(soa_vec3& P, const mat4& T)
+{
+  auto& M = T.M;
+  for (size_t I = 0; I < P.X.size(); ++I) {
+    f32 X = P.X[I];
+    f32 Y = P.Y[I];
+    f32 Z = P.Z[I];
+    f32 W = M[3][0] * X + M[3][1] * Y + M[3][2] * Z + M[3][3];
+    P.X[I] = (M[0][0] * X + M[0][1] * Y + M[0][2] * Z + M[0][3]) / W;
+    P.Y[I] = (M[1][0] * X + M[1][1] * Y + M[1][2] * Z + M[1][3]) / W;
+    P.Z[I] = (M[2][0] * X + M[2][1] * Y + M[2][2] * Z + M[2][3]) / W;
+  }
+}
+
+void renormalize_scalar(soa_vec3& N)
+{
+  for (size_t I = 0; I < N.X.size(); ++I) {
+    f32 LengthSquared = N.X[I] * N.X[I] + N.Y[I] * N.Y[I] + N.Z[I] * N.Z[I];
+    if (LengthSquared > 0.f) {
+      f32 InverseLength = 1.f / std::sqrt(LengthSquared);
+      N.X[I] *= InverseLength;
+      N.Y[I] *= InverseLength;
+      N.Z[I] *= InverseLength;
+    }
+  }
+}
+
+bool validate_indices_scalar(const i32* Indices, size_t NumIndices, size_t NumVertices)
+{
+  for (size_t I = 0; I < NumIndices; ++I) {
+    if (Indices[I] < 0 || static_cast<size_t>(Indices[I]) >= NumVertices) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#ifdef STORECAST_X64
+f32 reduce_min(const f32* Lanes, size_t NumLanes)
+{
+  f32 Result = Lanes[0];
+  for (size_t I = 1; I < NumLanes; ++I) {
+    Result = min_f32(Result, Lanes[I]);
+  }
+  return Result;
+}
+
+f32 reduce_max(const f32* Lanes, size_t NumLanes)
+{
+  f32 Result = Lanes[0];
+  for (size_t I = 1; I < NumLanes; ++I) {
+    Result = max_f32(Result, Lanes[I]);
+  }
+  return Result;
+}
+
+aabb compute_aabb_sse2(const soa_vec3& P)
+{
+  __m128 MinX = _mm_load_ps(&P.X[0]), MaxX = MinX;
+  __m128 MinY = _mm_load_ps(&P.Y[0]), MaxY = MinY;
+  __m128 MinZ = _mm_load_ps(&P.Z[0]), MaxZ = MinZ;
+  for (size_t I = 4; I < P.X.size(); I += 4) {
+    __m128 X = _mm_load_ps(&P.X[I]);
+    __m128 Y = _mm_load_ps(&P.Y[I]);
+    __m128 Z = _mm_load_ps(&P.Z[I]);
+    MinX = _mm_min_ps(MinX, X);
+    MinY = _mm_min_ps(MinY, Y);
+    MinZ = _mm_min_ps(MinZ, Z);
+    MaxX = _mm_max_ps(MaxX, X);
+    MaxY = _mm_max_ps(MaxY, Y);
+    MaxZ = _mm_max_ps(MaxZ, Z);
+  }
+  alignas(16) f32 Lanes[6][4];
+  _mm_store_ps(Lanes[0], MinX);
+  _mm_store_ps(Lanes[1], MinY);
+  _mm_store_ps(Lanes[2], MinZ);
+  _mm_store_ps(Lanes[3], MaxX);
+  _mm_store_ps(Lanes[4], MaxY);
+  _mm_store_ps(Lanes[5], MaxZ);
+  return {{reduce_min(Lanes[0], 4), reduce_min(Lanes[1], 4), reduce_min(Lanes[2], 4)},
+      {reduce_max(Lanes[3], 4), reduce_max(Lanes[4], 4), reduce_max(Lanes[5], 4)}};
+}
+
+STORECAST_TARGET_AVX2 aabb compute_aabb_avx2(const soa_vec3& P)
+{
+  __m256 MinX = _mm256_load_ps(&P.X[0]), MaxX = MinX;
+  __m256 MinY = _mm256_load_ps(&P.Y[0]), MaxY = MinY;
+  __m256 MinZ = _mm256_load_ps(&P.Z[0]), MaxZ = MinZ;
+  for (size_t I = 8; I < P.X.size(); I += 8) {
+    __m256 X = _mm256_load_ps(&P.X[I]);
+    __m256 Y = _mm256_load_ps(&P.Y[I]);
+    __m256 Z = _mm256_load_ps(&P.Z[I]);
+    MinX = _mm256_min_ps(MinX, X);
+    MinY = _mm256_min_ps(MinY, Y);
+    MinZ = _mm256_min_ps(MinZ, Z);
+    MaxX = _mm256_max_ps(MaxX, X);
+    MaxY = _mm256_max_ps(MaxY, Y);
+    MaxZ = _mm256_max_ps(MaxZ, Z);
+  }
+  alignas(32) f32 Lanes[6][8];
+  _mm256_store_ps(Lanes[0], MinX);
+  _mm256_store_ps(Lanes[1], MinY);
+  _mm256_store_ps(Lanes[2], MinZ);
+  _mm256_store_ps(Lanes[3], MaxX);
+  _mm256_store_ps(Lanes[4], MaxY);
+  _mm256_store_ps(Lanes[5], MaxZ);
+  return {{reduce_min(Lanes[0], 8), reduce_min(Lanes[1], 8), reduce_min(Lanes[2], 8)},
+      {reduce_max(Lanes[3], 8), reduce_max(Lanes[4], 8), reduce_max(Lanes[5], 8)}};
+}
+
+f32 get_max_distance_squared_sse2(const soa_vec3& P, const vec3& Center)
+{
+  __m128 CX = _mm_set1_ps(Center.X);
+  __m128 CY = _mm_set1_ps(Center.Y);
+  __m128 CZ = _mm_set1_ps(Center.Z);
+  __m128 Max = _mm_setzero_ps();
+  for (size_t I = 0; I < P.X.size(); I += 4) {
+    __m128 DX = _mm_sub_ps(_mm_load_ps(&P.X[I]), CX);
+    __m128 DY = _mm_sub_ps(_mm_load_ps(&P.Y[I]), CY);
+    __m128 DZ = _mm_sub_ps(_mm_load_ps(&P.Z[I]), CZ);
+    __m128 D =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(DX, DX), _mm_mul_ps(DY, DY)), _mm_mul_ps(DZ, DZ));
+    Max = _mm_max_ps(Max, D);
+  }
+  alignas(16) f32 Lanes[4];
+  _mm_store_ps(Lanes, Max);
+  return reduce_max(Lanes, 4);
+}
+
+STORECAST_TARGET_AVX2 f32 get_max_distance_squared_avx2(const soa_vec3& P, const vec3& Center)
+{
+  __m256 CX = _mm256_set1_ps(Center.X);
+  __m256 CY = _mm256_set1_ps(Center.Y);
+  __m256 CZ = _mm256_set1_ps(Center.Z);
+  __m256 Max = _mm256_setzero_ps();
+  for (size_t I = 0; I < P.X.size(); I += 8) {
+    __m256 DX = _mm256_sub_ps(_mm256_load_ps(&P.X[I]), CX);
+    __m256 DY = _mm256_sub_ps(_mm256_load_ps(&P.Y[I]), CY);
+    __m256 DZ = _mm256_sub_ps(_mm256_load_ps(&P.Z[I]), CZ);
+    __m256 D = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(DX, DX), _mm256_mul_ps(DY, DY)), _mm256_mul_ps(DZ, DZ));
+    Max = _mm256_max_ps(Max, D);
+  }
+  alignas(32) f32 Lanes[8];
+  _mm256_store_ps(Lanes, Max);
+  return reduce_max(Lanes, 8);
+}
+
+// Row . (X, Y, Z, 1), summed in the same order as the scalar version.
+__m128 transform_row_sse2(const f32 Row[4], __m128 X, __m128 Y, __m128 Z)
+{
+  __m128 Result =
+      _mm_add_ps(_mm_mul_ps(_mm_set1_ps(Row[0]), X), _mm_mul_ps(_mm_set1_ps(Row[1]), Y));
+  Result = _mm_add_ps(Result, _mm_mul_ps(_mm_set1_ps(Row[2]), Z));
+  return _mm_add_ps(Result, _mm_set1_ps(Row[3]));
+}
+
+void transform_positions_sse2(soa_vec3& P, const mat4& T)
+{
+  for (size_t I = 0; I < P.X.size(); I += 4) {
+    __m128 X = _mm_load_ps(&P.X[I]);
+    __m128 Y = _mm_load_ps(&P.Y[I]);
+    __m128 Z = _mm_load_ps(&P.Z[I]);
+    __m128 W = transform_row_sse2(T.M[3], X, Y, Z);
+    _mm_store_ps(&P.X[I], _mm_div_ps(transform_row_sse2(T.M[0], X, Y, Z), W));
+    _mm_store_ps(&P.Y[I], _mm_div_ps(transform_row_sse2(T.M[1], X, Y, Z), W));
+    _mm_store_ps(&P.Z[I], _mm_div_ps(transform_row_sse2(T.M[2], X, Y, Z), W));
+  }
+}
+
+STORECAST_TARGET_AVX2 __m256 transform_row_avx2(const f32 Row[4], __m256 X, __m256 Y, __m256 Z)
+{
+  __m256 Result = _mm256_add_ps(
+      _mm256_mul_ps(_mm256_set1_ps(Row[0]), X), _mm256_mul_ps(_mm256_set1_ps(Row[1]), Y));
+  Result = _mm256_add_ps(Result, _mm256_mul_ps(_mm256_set1_ps(Row[2]), Z));
+  return _mm256_add_ps(Result, _mm256_set1_ps(Row[3]));
+}
+
+STORECAST_TARGET_AVX2 void transform_positions_avx2(soa_vec3& P, const mat4& T)
+{
+  for (size_t I = 0; I < P.X.size(); I += 8) {
+    __m256 X = _mm256_load_ps(&P.X[I]);
+    __m256 Y = _mm256_load_ps(&P.Y[I]);
+    __m256 Z = _mm256_load_ps(&P.Z[I]);
+    __m256 W = transform_row_avx2(T.M[3], X, Y, Z);
+    _mm256_store_ps(&P.X[I], _mm256_div_ps(transform_row_avx2(T.M[0], X, Y, Z), W));
+    _mm256_store_ps(&P.Y[I], _mm256_div_ps(transform_row_avx2(T.M[1], X, Y, Z), W));
+    _mm256_store_ps(&P.Z[I], _mm256_div_ps(transform_row_avx2(T.M[2], X, Y, Z), W));
+  }
+}
+
+// Multiplies by 1 / sqrt instead of using rsqrtps, which is only accurate to 12 bits.
+void renormalize_sse2(soa_vec3& N)
+{
+  __m128 Zero = _mm_setzero_ps();
+  __m128 One = _mm_set1_ps(1.f);
+  for (size_t I = 0; I < N.X.size(); I += 4) {
+    __m128 X = _mm_load_ps(&N.X[I]);
+    __m128 Y = _mm_load_ps(&N.Y[I]);
+    __m128 Z = _mm_load_ps(&N.Z[I]);
+    __m128 LengthSquared =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y)), _mm_mul_ps(Z, Z));
+    __m128 Mask = _mm_cmpgt_ps(LengthSquared, Zero);
+    __m128 InverseLength = _mm_div_ps(One, _mm_sqrt_ps(LengthSquared));
+    // Where the length is zero, keep the original value.
+    __m128 Scale = _mm_or_ps(_mm_and_ps(Mask, InverseLength), _mm_andnot_ps(Mask, One));
+    _mm_store_ps(&N.X[I], _mm_mul_ps(X, Scale));
+    _mm_store_ps(&N.Y[I], _mm_mul_ps(Y, Scale));
+    _mm_store_ps(&N.Z[I], _mm_mul_ps(Z, Scale));
+  }
+}
+
+STORECAST_TARGET_AVX2 void renormalize_avx2(soa_vec3& N)
+{
+  __m256 Zero = _mm256_setzero_ps();
+  __m256 One = _mm256_set1_ps(1.f);
+  for (size_t I = 0; I < N.X.size(); I += 8) {
+    __m256 X = _mm256_load_ps(&N.X[I]);
+    __m256 Y = _mm256_load_ps(&N.Y[I]);
+    __m256 Z = _mm256_load_ps(&N.Z[I]);
+    __m256 LengthSquared = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(X, X), _mm256_mul_ps(Y, Y)), _mm256_mul_ps(Z, Z));
+    __m256 Mask = _mm256_cmp_ps(LengthSquared, Zero, _CMP_GT_OQ);
+    __m256 InverseLength = _mm256_div_ps(One, _mm256_sqrt_ps(LengthSquared));
+    __m256 Scale = _mm256_blendv_ps(One, InverseLength, Mask);
+    _mm256_store_ps(&N.X[I], _mm256_mul_ps(X, Scale));
+    _mm256_store_ps(&N.Y[I], _mm256_mul_ps(Y, Scale));
+    _mm256_store_ps(&N.Z[I], _mm256_mul_ps(Z, Scale));
+  }
+}
+
+// The largest valid index, or -1 if there are no vertices. Indices are i32, so vertices past
+// 2^31 can't be referenced anyway.
+i32 get_max_valid_index(size_t NumVertices)
+{
+  return static_cast<i32>(std::min<size_t>(NumVertices, 0x80000000u) - 1);
+}
+
+bool validate_indices_sse2(const i32* Indices, size_t NumIndices, size_t NumVertices)
+{
+  __m128i Zero = _mm_setzero_si128();
+  __m128i MaxIndex = _mm_set1_epi32(get_max_valid_index(NumVertices));
+  __m128i Invalid = Zero;
+  size_t I = 0;
+  for (; I + 4 <= NumIndices; I += 4) {
+    __m128i Index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Indices + I));
+    Invalid = _mm_or_si128(Invalid, _mm_cmplt_epi32(Index, Zero));
+    Invalid = _mm_or_si128(Invalid, _mm_cmpgt_epi32(Index, MaxIndex));
+  }
+  return _mm_movemask_epi8(Invalid) == 0
+      && validate_indices_scalar(Indices + I, NumIndices - I, NumVertices);
+}
+
+STORECAST_TARGET_AVX2 bool validate_indices_avx2(
+    const i32* Indices, size_t NumIndices, size_t NumVertices)
+{
+  __m256i Zero = _mm256_setzero_si256();
+  __m256i MaxIndex = _mm256_set1_epi32(get_max_valid_index(NumVertices));
+  __m256i Invalid = Zero;
+  size_t I = 0;
+  for (; I + 8 <= NumIndices; I += 8) {
+    __m256i Index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Indices + I));
+    Invalid = _mm256_or_si256(Invalid, _mm256_cmpgt_epi32(Zero, Index));
+    Invalid = _mm256_or_si256(Invalid, _mm256_cmpgt_epi32(Index, MaxIndex));
+  }
+  return _mm256_movemask_epi8(Invalid) == 0
+      && validate_indices_scalar(Indices + I, NumIndices - I, NumVertices);
+}
+
+bool is_avx2_supported()
+{
+#if defined(_MSC_VER)
+  int Info[4];
+  __cpuid(Info, 0);
+  if (Info[0] < 7) {
+    return false;
+  }
+  __cpuid(Info, 1);
+  // The OS has to save the YMM registers on context switches.
+  bool HasOsxsave = (Info[2] & (1 << 27)) != 0;
+  if (!HasOsxsave || (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+  __cpuidex(Info, 7, 0);
+  return (Info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // STORECAST_X64
+} // anonymous namespace
+
+soa_mesh::soa_mesh(const mesh& Mesh)
+  : NumVertices(Mesh.Vertices.size()),
+    TriangleIndices(Mesh.TriangleIndices),
+    QuadIndices(Mesh.QuadIndices),
+    TriangleRanges(Mesh.TriangleRanges),
+    QuadRanges(Mesh.QuadRanges),
+    MaterialNames(Mesh.MaterialNames)
+{
+  if (NumVertices > 0) {
+    copy_to_soa(Mesh.Vertices, &vertex_data::Position, Positions);
+    copy_to_soa(Mesh.Vertices, &vertex_data::Normal, Normals);
+    copy_to_soa(Mesh.Vertices, &vertex_data::TextureCoords, TextureCoords);
+  }
+}
+
+mesh soa_mesh::to_mesh() const
+{
+  mesh Result;
+  Result.Vertices.resize(NumVertices);
+  for (size_t I = 0; I < NumVertices; ++I) {
+    Result.Vertices[I] = {get(Positions, I), get(Normals, I), get(TextureCoords, I)};
+  }
+  Result.TriangleIndices = TriangleIndices;
+  Result.QuadIndices = QuadIndices;
+  Result.TriangleRanges = TriangleRanges;
+  Result.QuadRanges = QuadRanges;
+  Result.MaterialNames = MaterialNames;
+  return Result;
+}
+
+simd_level get_simd_level()
+{
+#ifdef STORECAST_X64
+  // SSE2 is part of x64.
+  static const simd_level Level = is_avx2_supported() ? simd_level::AVX2 : simd_level::SSE2;
+  return Level;
+#else
+  return simd_level::SCALAR;
+#endif
+}
+
+aabb compute_aabb(const soa_mesh& Mesh, simd_level Level)
+{
+  if (Mesh.NumVertices == 0) {
+    return {{0.f, 0.f, 0.f}, {0.f, 0.f, 0.f}};
+  }
+  aabb Box;
+  switch (Level) {
+#ifdef STORECAST_X64
+  case simd_level::AVX2: Box = compute_aabb_avx2(Mesh.Positions); break;
+  case simd_level::SSE2: Box = compute_aabb_sse2(Mesh.Positions); break;
+#endif
+  default: Box = compute_aabb_scalar(Mesh.Positions); break;
+  }
+  return {without_negative_zero(Box.Min), without_negative_zero(Box.Max)};
+}
+
+bounding_sphere compute_bounding_sphere(const soa_mesh& Mesh, simd_level Level)
+{
+  aabb Box = compute_aabb(Mesh, Level);
+  vec3 Center = (Box.Min + Box.Max) * 0.5f;
+  if (Mesh.NumVertices == 0) {
+    return {Center, 0.f};
+  }
+  f32 MaxDistanceSquared;
+  switch (Level) {
+#ifdef STORECAST_X64
+  case simd_level::AVX2:
+    MaxDistanceSquared = get_max_distance_squared_avx2(Mesh.Positions, Center);
+    break;
+  case simd_level::SSE2:
+    MaxDistanceSquared = get_max_distance_squared_sse2(Mesh.Positions, Center);
+    break;
+#endif
+  default: MaxDistanceSquared = get_max_distance_squared_scalar(Mesh.Positions, Center); break;
+  }
+  return {Center, std::sqrt(MaxDistanceSquared)};
+}
+
+void transform_positions(soa_mesh& Mesh, const mat4& Transform, simd_level Level)
+{
+  switch (Level) {
+#ifdef STORECAST_X64
+  case simd_level::AVX2: transform_positions_avx2(Mesh.Positions, Transform); break;
+  case simd_level::SSE2: transform_positions_sse2(Mesh.Positions, Transform); break;
+#endif
+  default: transform_positions_scalar(Mesh.Positions, Transform); break;
+  }
+}
+
+void renormalize_normals(soa_mesh& Mesh, simd_level Level)
+{
+  switch (Level) {
+#ifdef STORECAST_X64
+  case simd_level::AVX2: renormalize_avx2(Mesh.Normals); break;
+  case simd_level::SSE2: renormalize_sse2(Mesh.Normals); break;
+#endif
+  default: renormalize_scalar(Mesh.Normals); break;
+  }
+}
+
+bool validate_indices(const i32* Indices, size_t NumIndices, size_t NumVertices,
+    simd_level Level)
+{
+  switch (Level) {
+#ifdef STORECAST_X64
+  case simd_level::AVX2: return validate_indices_avx2(Indices, NumIndices, NumVertices);
+  case simd_level::SSE2: return validate_indices_sse2(Indices, NumIndices, NumVertices);
+#endif
+  default: return validate_indices_scalar(Indices, NumIndices, NumVertices);
+  }
+}
+
+} // namespace storecast
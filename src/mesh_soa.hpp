@@ -0,0 +1,110 @@
+#pragma once
+#include "defines.hpp"
+#include "math.hpp"
+#include "mesh.hpp"
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace storecast
+{
+
+// Hands out memory aligned for AVX loads and stores, or to any other power of two, e.g. 64 for
+// cache lines.
+template <typename T, size_t Alignment = 32>
+struct aligned_allocator {
+  typedef T value_type;
+  template <typename U>
+  struct rebind {
+    typedef aligned_allocator<U, Alignment> other;
+  };
+
+  aligned_allocator() = default;
+  template <typename U>
+  aligned_allocator(const aligned_allocator<U, Alignment>&) {}
+
+  T* allocate(size_t Count)
+  {
+    // Over-allocate, and keep the original pointer right before the aligned block.
+    auto* Block = static_cast<char*>(::operator new(Count * sizeof(T) + Alignment + sizeof(void*)));
+    auto Aligned = (reinterpret_cast<size_t>(Block) + sizeof(void*) + Alignment - 1)
+        & ~(Alignment - 1);
+    reinterpret_cast<void**>(Aligned)[-1] = Block;
+    return reinterpret_cast<T*>(Aligned);
+  }
+  void deallocate(T* Pointer, size_t) { ::operator delete(reinterpret_cast<void**>(Pointer)[-1]); }
+
+  template <typename U>
+  bool operator==(const aligned_allocator<U, Alignment>&) const { return true; }
+  template <typename U>
+  bool operator!=(const aligned_allocator<U, Alignment>&) const { return false; }
+};
+
+typedef std::vector<f32, aligned_allocator<f32>> aligned_f32_array;
+
+struct soa_vec3 {
+  aligned_f32_array X;
+  aligned_f32_array Y;
+  aligned_f32_array Z;
+};
+
+// The vertices of a mesh as one array per component, for SIMD kernels. The arrays are padded to
+// a multiple of SoaPadding elements by repeating the last vertex, so kernels can work on whole
+// registers without changing their result. The index buffers and ranges are the same as in the
+// mesh.
+constexpr size_t SoaPadding = 8;
+
+struct soa_mesh {
+  soa_mesh() = default;
+  explicit soa_mesh(const mesh& Mesh);
+  mesh to_mesh() const;
+
+  size_t NumVertices = 0;
+  soa_vec3 Positions;
+  soa_vec3 Normals;
+  soa_vec3 TextureCoords;
+  std::vector<i32> TriangleIndices;
+  std::vector<i32> QuadIndices;
+  std::vector<mesh_range> TriangleRanges;
+  std::vector<mesh_range> QuadRanges;
+  std::vector<std::string> MaterialNames;
+};
+
+// The instruction sets the kernels are written for. Each kernel defaults to the best one the
+// CPU supports, and can be asked for a lower one, so the tests can compare them.
+enum class simd_level { SCALAR, SSE2, AVX2 };
+simd_level get_simd_level();
+
+struct aabb {
+  vec3 Min;
+  vec3 Max;
+};
+struct bounding_sphere {
+  vec3 Center;
+  f32 Radius;
+};
+
+// All kernels give bit-identical results at every simd_level.
+
+// An empty mesh gets an all-zero box.
+aabb compute_aabb(const soa_mesh& Mesh, simd_level Level = get_simd_level());
+// The sphere around the center of the AABB that contains all positions. Not the smallest one,
+// but close for most assets, and cheap.
+bounding_sphere compute_bounding_sphere(const soa_mesh& Mesh, simd_level Level = get_simd_level());
+// Applies Transform to each position, including the division by w.
+void transform_positions(
+    soa_mesh& Mesh, const mat4& Transform, simd_level Level = get_simd_level());
+// Scales each normal to unit length. Zero normals stay zero.
+void renormalize_normals(soa_mesh& Mesh, simd_level Level = get_simd_level());
+// True if all indices are in [0, NumVertices).
+bool validate_indices(const i32* Indices, size_t NumIndices, size_t NumVertices,
+    simd_level Level = get_simd_level());
+inline bool validate_indices(const soa_mesh& Mesh, simd_level Level = get_simd_level())
+{
+  return validate_indices(Mesh.TriangleIndices.data(), Mesh.TriangleIndices.size(),
+             Mesh.NumVertices, Level)
+      && validate_indices(Mesh.QuadIndices.data(), Mesh.QuadIndices.size(), Mesh.NumVertices,
+             Level);
+}
+
+} // namespace storecast
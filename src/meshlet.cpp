@@ -0,0 +1,279 @@
+#include "meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace storecast
+{
+using std::vector;
+
+namespace {
+struct meshlet_builder {
+  const mesh& Mesh;
+  const meshlet_options& Options;
+  meshlet_list& Result;
+
+  // Which triangles use each vertex.
+  vector<i32> AdjacencyOffsets;
+  vector<i32> Adjacency;
+  vector<bool> Used;
+  vector<vec3> TriangleCenters;
+  // The triangles of the range being split, [Begin, End), counted in triangles.
+  i32 Begin = 0;
+  i32 End = 0;
+  // The unused triangles in the range that share a vertex with the current meshlet, and for
+  // each triangle, the last meshlet it was a candidate for, and how many vertices it would add.
+  vector<i32> Candidates;
+  vector<i32> CandidateFor;
+  vector<u8> NumNewVertices;
+  // Each vertex's index in the current meshlet, or -1.
+  vector<i32> LocalIndices;
+  // The reordered Mesh.TriangleIndices.
+  vector<i32> Output;
+  meshlet Current;
+  // The sum of the current meshlet's vertex positions.
+  vec3 PositionSum;
+  // Scratch space for the cone.
+  vector<vec3> TriangleNormals;
+
+  meshlet_builder(const mesh& Mesh, const meshlet_options& Options, meshlet_list& Result)
+    : Mesh(Mesh), Options(Options), Result(Result)
+  {
+    auto& Indices = Mesh.TriangleIndices;
+    AdjacencyOffsets.assign(Mesh.Vertices.size() + 1, 0);
+    for (auto V: Indices) {
+      ++AdjacencyOffsets[V + 1];
+    }
+    for (size_t V = 0; V < Mesh.Vertices.size(); ++V) {
+      AdjacencyOffsets[V + 1] += AdjacencyOffsets[V];
+    }
+    Adjacency.resize(Indices.size());
+    vector<i32> Fill(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+    for (size_t I = 0; I < Indices.size(); ++I) {
+      Adjacency[Fill[Indices[I]]++] = static_cast<i32>(I / 3);
+    }
+    Used.assign(Indices.size() / 3, false);
+    CandidateFor.assign(Indices.size() / 3, -1);
+    NumNewVertices.resize(Indices.size() / 3);
+    TriangleCenters.resize(Indices.size() / 3);
+    for (size_t T = 0; T < TriangleCenters.size(); ++T) {
+      vec3 Sum = Mesh.Vertices[Indices[3 * T]].Position + Mesh.Vertices[Indices[3 * T + 1]].Position
+          + Mesh.Vertices[Indices[3 * T + 2]].Position;
+      TriangleCenters[T] = Sum * (1.f / 3.f);
+    }
+    LocalIndices.assign(Mesh.Vertices.size(), -1);
+    Output.reserve(Indices.size());
+  }
+
+  i32 count_new_vertices(i32 Triangle) const
+  {
+    i32 Count = 0;
+    for3(Corner) {
+      Count += LocalIndices[Mesh.TriangleIndices[3 * Triangle + Corner]] < 0;
+    }
+    return Count;
+  }
+
+  bool fits(i32 Triangle) const
+  {
+    return static_cast<i32>(Current.NumVertices) + count_new_vertices(Triangle)
+        <= Options.MaxVertices && Current.NumIndices / 3 < Options.MaxTriangles;
+  }
+
+  void add_candidates(i32 Vertex)
+  {
+    auto MeshletId = static_cast<i32>(Result.Meshlets.size());
+    for (auto A = AdjacencyOffsets[Vertex]; A < AdjacencyOffsets[Vertex + 1]; ++A) {
+      auto T = Adjacency[A];
+      if (Used[T] || T < Begin || T >= End) {
+        continue;
+      }
+      if (CandidateFor[T] == MeshletId) {
+        --NumNewVertices[T];
+      } else {
+        CandidateFor[T] = MeshletId;
+        NumNewVertices[T] = static_cast<u8>(count_new_vertices(T));
+        Candidates.push_back(T);
+      }
+    }
+  }
+
+  void add(i32 Triangle)
+  {
+    Used[Triangle] = true;
+    for3(Corner) {
+      auto V = Mesh.TriangleIndices[3 * Triangle + Corner];
+      if (LocalIndices[V] < 0) {
+        LocalIndices[V] = static_cast<i32>(Current.NumVertices++);
+        Result.Vertices.push_back(V);
+        PositionSum = PositionSum + Mesh.Vertices[V].Position;
+        add_candidates(V);
+      }
+      Output.push_back(V);
+      Result.LocalIndices.push_back(static_cast<u8>(LocalIndices[V]));
+    }
+    Current.NumIndices += 3;
+  }
+
+  // The candidate that adds the fewest vertices to the meshlet, and of those the one closest to
+  // its centroid, so that meshlets stay round. Returns -1 if there's none.
+  i32 find_neighbor()
+  {
+    vec3 Centroid = PositionSum * (1.f / static_cast<f32>(Current.NumVertices));
+    i32 Best = -1;
+    i32 BestNewVertices = 4;
+    f32 BestDistance = 0.f;
+    for (size_t I = 0; I < Candidates.size();) {
+      auto T = Candidates[I];
+      if (Used[T]) {
+        Candidates[I] = Candidates.back();
+        Candidates.pop_back();
+        continue;
+      }
+      ++I;
+      i32 NewVertices = NumNewVertices[T];
+      if (NewVertices > BestNewVertices) {
+        continue;
+      }
+      f32 Distance = length_squared(TriangleCenters[T] - Centroid);
+      if (NewVertices < BestNewVertices || Distance < BestDistance) {
+        Best = T;
+        BestNewVertices = NewVertices;
+        BestDistance = Distance;
+      }
+    }
+    return Best;
+  }
+
+  void finish()
+  {
+    const i32* Vertices = &Result.Vertices[Current.FirstVertex];
+    vec3 Min = Mesh.Vertices[Vertices[0]].Position;
+    vec3 Max = Min;
+    for (u32 I = 0; I < Current.NumVertices; ++I) {
+      auto& Position = Mesh.Vertices[Vertices[I]].Position;
+      for3(Axis) {
+        Min.Data[Axis] = std::min(Min.Data[Axis], Position.Data[Axis]);
+        Max.Data[Axis] = std::max(Max.Data[Axis], Position.Data[Axis]);
+      }
+    }
+    Current.Center = (Min + Max) * 0.5f;
+    f32 MaxDistanceSquared = 0.f;
+    for (u32 I = 0; I < Current.NumVertices; ++I) {
+      auto& Position = Mesh.Vertices[Vertices[I]].Position;
+      MaxDistanceSquared =
+          std::max(MaxDistanceSquared, length_squared(Position - Current.Center));
+    }
+    Current.Radius = std::sqrt(MaxDistanceSquared);
+
+    // The cone axis is the average of the triangle normals, and the cone is as wide as the
+    // normal farthest from it. Degenerate triangles can't be seen, so they don't count.
+    TriangleNormals.clear();
+    vec3 Sum = {0.f, 0.f, 0.f};
+    for (i32 I = Current.StartIndex; I < Current.StartIndex + Current.NumIndices; I += 3) {
+      auto& A = Mesh.Vertices[Output[I]].Position;
+      auto& B = Mesh.Vertices[Output[I + 1]].Position;
+      auto& C = Mesh.Vertices[Output[I + 2]].Position;
+      vec3 Normal = cross(B - A, C - A);
+      f32 Length = std::sqrt(length_squared(Normal));
+      if (Length > 0.f) {
+        TriangleNormals.push_back(Normal * (1.f / Length));
+        Sum = Sum + TriangleNormals.back();
+      }
+    }
+    Current.ConeAxis = {0.f, 0.f, 1.f};
+    // A cutoff of 1 means the meshlet is never backfacing.
+    Current.ConeCutoff = 1.f;
+    f32 SumLength = std::sqrt(length_squared(Sum));
+    if (SumLength > 0.f) {
+      Current.ConeAxis = Sum * (1.f / SumLength);
+      f32 MinDot = 1.f;
+      for (auto& Normal: TriangleNormals) {
+        MinDot = std::min(MinDot, dot(Normal, Current.ConeAxis));
+      }
+      // Past 90 degrees, some triangle always faces the camera.
+      if (MinDot > 0.f) {
+        Current.ConeCutoff = std::sqrt(1.f - MinDot * MinDot);
+      }
+    }
+
+    for (u32 I = 0; I < Current.NumVertices; ++I) {
+      LocalIndices[Vertices[I]] = -1;
+    }
+    Result.Meshlets.push_back(Current);
+  }
+
+  void start(i32 Material)
+  {
+    Current = {};
+    Current.Material = Material;
+    Current.StartIndex = static_cast<i32>(Output.size());
+    Current.FirstVertex = static_cast<u32>(Result.Vertices.size());
+    PositionSum = {0.f, 0.f, 0.f};
+    Candidates.clear();
+  }
+
+  void build_range(i32 Material, i32 StartIndex, i32 NumIndices)
+  {
+    Begin = StartIndex / 3;
+    End = (StartIndex + NumIndices) / 3;
+    i32 Cursor = Begin;
+    while (true) {
+      while (Cursor < End && Used[Cursor]) {
+        ++Cursor;
+      }
+      if (Cursor == End) {
+        break;
+      }
+      start(Material);
+      i32 Next = Cursor;
+      while (Next >= 0 && fits(Next)) {
+        add(Next);
+        Next = find_neighbor();
+      }
+      finish();
+    }
+  }
+};
+} // anonymous namespace
+
+meshlet_list build_meshlets(mesh& Mesh, const meshlet_options& Options)
+{
+  meshlet_list Result;
+  Result.LocalIndices.reserve(Mesh.TriangleIndices.size());
+  meshlet_builder Builder(Mesh, Options, Result);
+  if (Mesh.TriangleRanges.empty()) {
+    Builder.build_range(-1, 0, static_cast<i32>(Mesh.TriangleIndices.size()));
+  }
+  for (auto& Range: Mesh.TriangleRanges) {
+    Builder.build_range(Range.Material, Range.StartIndex, Range.NumIndices);
+  }
+  Mesh.TriangleIndices = std::move(Builder.Output);
+  return Result;
+}
+
+bool is_meshlet_backfacing(const meshlet& Meshlet, const vec3& CameraPosition)
+{
+  vec3 ToCenter = Meshlet.Center - CameraPosition;
+  return dot(ToCenter, Meshlet.ConeAxis)
+      >= Meshlet.ConeCutoff * std::sqrt(length_squared(ToCenter)) + Meshlet.Radius;
+}
+
+std::vector<draw_command> get_draw_command_list(const mesh& Mesh, const meshlet_list& Meshlets)
+{
+  vector<draw_command> Result;
+  Result.reserve(Meshlets.Meshlets.size() + Mesh.QuadRanges.size() + 1);
+  for (auto& Meshlet: Meshlets.Meshlets) {
+    Result.push_back(
+        {draw_command::type::TRIANGLE, Meshlet.StartIndex, Meshlet.NumIndices, Meshlet.Material});
+  }
+  for (auto& Command: get_draw_command_list(Mesh)) {
+    if (Command.Type != draw_command::type::TRIANGLE) {
+      Result.push_back(Command);
+    }
+  }
+  return Result;
+}
+
+} // namespace storecast
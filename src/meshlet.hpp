@@ -0,0 +1,56 @@
+#pragma once
+#include "defines.hpp"
+#include "math.hpp"
+#include "mesh.hpp"
+#include <vector>
+
+namespace storecast
+{
+
+// Small clusters of triangles with their own bounds, so that renderers and occlusion passes can
+// cull parts of a dense mesh instead of all or nothing. Only triangles are clustered;
+// triangulate on import to include quads.
+
+struct meshlet_options {
+  // The usual limits for mesh shaders. MaxVertices must be in [3, 256], since local indices
+  // are bytes, and MaxTriangles at least 1.
+  i32 MaxVertices = 64;
+  i32 MaxTriangles = 124;
+};
+
+struct meshlet {
+  i32 Material;
+  // The meshlet's triangles are Mesh.TriangleIndices[StartIndex, StartIndex + NumIndices).
+  i32 StartIndex;
+  i32 NumIndices;
+  // The mesh vertices it uses are meshlet_list::Vertices[FirstVertex, FirstVertex + NumVertices).
+  u32 FirstVertex;
+  u32 NumVertices;
+  vec3 Center;
+  f32 Radius;
+  // All triangle normals are within the cone around ConeAxis; see is_meshlet_backfacing.
+  vec3 ConeAxis;
+  f32 ConeCutoff;
+};
+
+struct meshlet_list {
+  std::vector<meshlet> Meshlets;
+  std::vector<i32> Vertices;
+  // Parallel to Mesh.TriangleIndices: the same vertices, numbered within their meshlet.
+  std::vector<u8> LocalIndices;
+};
+
+// Splits each of the mesh's triangle ranges into meshlets, and reorders the triangles within
+// each range so that every meshlet's triangles are consecutive. Meshlets are grown over shared
+// vertices, so they are spatially compact.
+meshlet_list build_meshlets(mesh& Mesh, const meshlet_options& Options = {});
+
+// True if every triangle of the meshlet faces away from a camera at CameraPosition. Conservative
+// for perspective cameras.
+bool is_meshlet_backfacing(const meshlet& Meshlet, const vec3& CameraPosition);
+
+// Like get_draw_command_list(Mesh), but with one triangle command per meshlet, so that each one
+// can be culled separately. Mesh must be the mesh the meshlets were built for.
+std::vector<draw_command> get_draw_command_list(const mesh& Mesh, const meshlet_list& Meshlets);
+
+} // namespace storecast
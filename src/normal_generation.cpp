@@ -0,0 +1,149 @@
+#include "normal_generation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include "parallel.hpp"
+
+namespace storecast
+{
+
+namespace {
+const size_t ItemsPerTask = 1 << 16;
+
+vec3 get_unit_or_zero(const vec3& Value)
+{
+  f32 LengthSquared = length_squared(Value);
+  return LengthSquared > 0.f ? Value * (1.f / std::sqrt(LengthSquared)) : vec3{0.f, 0.f, 0.f};
+}
+
+// Runs Function(Begin, End) on [0, NumItems) in tasks of ItemsPerTask items.
+template <class function>
+void for_each_task(size_t NumItems, i32 NumThreads, const function& Function)
+{
+  auto NumTasks = static_cast<i32>((NumItems + ItemsPerTask - 1) / ItemsPerTask);
+  parallel_for(NumTasks, NumThreads, [&](i32 Task) {
+    auto Begin = Task * ItemsPerTask;
+    Function(Begin, std::min(Begin + ItemsPerTask, NumItems));
+  });
+}
+} // anonymous namespace
+
+void generate_normals(const vec3* Positions, size_t NumPositions, vertex_key* Keys,
+    const size_t* FaceOffsets, size_t NumFaces, i32 FirstId, const normal_options& Options,
+    vec3* Normals, i32 NumThreads, memory_arena* Arena)
+{
+  if (Options.Mode == normal_options::mode::NONE || NumFaces == 0) {
+    return;
+  }
+  NumThreads = NumThreads > 0 ? NumThreads : get_num_hardware_threads();
+  auto NumKeys = FaceOffsets[NumFaces];
+  bool IsSmooth = Options.Mode == normal_options::mode::SMOOTH;
+  bool HasCreases = IsSmooth && Options.CreaseAngle < 180.f;
+  auto MinCreaseCosine = std::cos(Options.CreaseAngle * (3.14159265f / 180.f));
+
+  // The unit normal of every face, and what each corner adds to the smooth normal at its
+  // position. The face normal is the sum of the normals of a triangle fan, which is twice the
+  // area of the face if it is planar.
+  arena_allocator<vec3> Allocator(Arena);
+  arena_vector<vec3> FaceNormals(NumFaces, vec3(), Allocator);
+  arena_vector<vec3> CornerWeights(IsSmooth ? NumKeys : 0, vec3(), Allocator);
+  arena_vector<i32> CornerFaces(NumKeys, 0, Allocator);
+  for_each_task(NumFaces, NumThreads, [&](size_t Begin, size_t End) {
+    for (auto Face = Begin; Face < End; ++Face) {
+      auto First = FaceOffsets[Face];
+      auto NumCorners = static_cast<i32>(FaceOffsets[Face + 1] - First);
+      auto get_position = [&](i32 Corner) { return Positions[Keys[First + Corner].V - 1]; };
+      vec3 Normal = {0.f, 0.f, 0.f};
+      auto P0 = get_position(0);
+      for (i32 Corner = 1; Corner + 1 < NumCorners; ++Corner) {
+        Normal = Normal + cross(get_position(Corner) - P0, get_position(Corner + 1) - P0);
+      }
+      auto UnitNormal = get_unit_or_zero(Normal);
+      FaceNormals[Face] = UnitNormal;
+      for (i32 Corner = 0; Corner < NumCorners; ++Corner) {
+        CornerFaces[First + Corner] = static_cast<i32>(Face);
+        if (!IsSmooth) {
+          continue;
+        }
+        if (Options.Weighting == normal_options::weighting::AREA) {
+          CornerWeights[First + Corner] = Normal;
+          continue;
+        }
+        auto P = get_position(Corner);
+        auto Next = get_position(Corner + 1 == NumCorners ? 0 : Corner + 1) - P;
+        auto Previous = get_position(Corner == 0 ? NumCorners - 1 : Corner - 1) - P;
+        auto Angle = std::atan2(std::sqrt(length_squared(cross(Next, Previous))),
+            dot(Next, Previous));
+        CornerWeights[First + Corner] = UnitNormal * Angle;
+      }
+    }
+  });
+
+  // Counting sort of the keys by V, so that the corners around each position are next to each
+  // other. The keys of a position stay in order, which makes the sums below independent of the
+  // number of threads. This is a single pass over the keys, so it stays on one thread.
+  arena_vector<size_t> PositionStarts(NumPositions + 1, 0, Allocator);
+  arena_vector<i32> SortedKeys(NumKeys, 0, Allocator);
+  for (size_t I = 0; I < NumKeys; ++I) {
+    ++PositionStarts[Keys[I].V];
+  }
+  std::partial_sum(PositionStarts.begin(), PositionStarts.end(), PositionStarts.begin());
+  for (size_t I = 0; I < NumKeys; ++I) {
+    SortedKeys[PositionStarts[Keys[I].V - 1]++] = static_cast<i32>(I);
+  }
+  // Each start has moved to the start of the next position.
+  std::copy_backward(PositionStarts.begin(), PositionStarts.end() - 1, PositionStarts.end());
+  PositionStarts[0] = 0;
+
+  // Each task owns a range of positions, and only writes the keys and normals of their corners.
+  for_each_task(NumPositions, NumThreads, [&](size_t Begin, size_t End) {
+    // The keys with distinct normals at the current position.
+    arena_vector<i32> DistinctKeys(Allocator);
+    for (auto Position = Begin; Position < End; ++Position) {
+      auto First = SortedKeys.begin() + PositionStarts[Position];
+      auto Last = SortedKeys.begin() + PositionStarts[Position + 1];
+      vec3 Sum = {0.f, 0.f, 0.f};
+      if (IsSmooth && !HasCreases) {
+        for (auto Key = First; Key != Last; ++Key) {
+          Sum = Sum + CornerWeights[*Key];
+        }
+        Sum = get_unit_or_zero(Sum);
+      }
+      DistinctKeys.clear();
+      for (auto Key = First; Key != Last; ++Key) {
+        if (Keys[*Key].Vn != 0) {
+          continue;
+        }
+        auto& FaceNormal = FaceNormals[CornerFaces[*Key]];
+        vec3 Normal = FaceNormal;
+        if (IsSmooth) {
+          auto Smooth = Sum;
+          if (HasCreases) {
+            Smooth = {0.f, 0.f, 0.f};
+            for (auto Other = First; Other != Last; ++Other) {
+              if (CornerFaces[*Other] == CornerFaces[*Key]
+                  || dot(FaceNormals[CornerFaces[*Other]], FaceNormal) >= MinCreaseCosine) {
+                Smooth = Smooth + CornerWeights[*Other];
+              }
+            }
+            Smooth = get_unit_or_zero(Smooth);
+          }
+          Normal = length_squared(Smooth) > 0.f ? Smooth : FaceNormal;
+        }
+        auto Same = std::find_if(DistinctKeys.begin(), DistinctKeys.end(),
+            [&](i32 Distinct) { return memcmp(&Normals[Distinct], &Normal, sizeof(vec3)) == 0; });
+        if (Same == DistinctKeys.end()) {
+          Normals[*Key] = Normal;
+          DistinctKeys.push_back(*Key);
+          Same = DistinctKeys.end() - 1;
+        }
+        Keys[*Key].Vn = FirstId + *Same;
+      }
+    }
+  });
+}
+
+} // namespace storecast
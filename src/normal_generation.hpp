@@ -0,0 +1,53 @@
+#pragma once
+#include "defines.hpp"
+#include "math.hpp"
+#include "memory_arena.hpp"
+#include "vertex_dedup.hpp"
+#include <cstddef>
+
+namespace storecast
+{
+
+// Normals for face vertices that have none in the OBJ file, generated during convert_to_mesh.
+// They are generated before the face vertices are merged into mesh vertices, so that face
+// vertices at the same position with the same texture coordinates and the same generated normal
+// still become one mesh vertex, and those on either side of a crease don't.
+struct normal_options {
+  enum class mode {
+    // Normals that aren't in the file stay 0.
+    NONE,
+    // Every face vertex gets the normal of its face.
+    FLAT,
+    // Every face vertex gets the average normal of the faces that share its v, so that texture
+    // seams don't show up as seams in the shading. Where the weights add up to nothing,
+    // e.g. at a corner between two edges of zero length, it gets the normal of its face.
+    SMOOTH,
+  } Mode = mode::NONE;
+  // For SMOOTH: how much each face counts in the average at one of its corners. AREA is cheaper
+  // and favors large faces. ANGLE uses the angle at the corner, so that the result doesn't
+  // depend on how the faces around a vertex are split into triangles.
+  enum class weighting {
+    AREA,
+    ANGLE,
+  } Weighting = weighting::AREA;
+  // For SMOOTH: a face only counts at a corner if its normal is at most this many degrees away
+  // from the normal of the corner's own face. 180 averages over all faces, which is the fastest.
+  f32 CreaseAngle = 180.f;
+};
+
+// Generates a normal for each key with Vn == 0, and sets Vn to its id, which starts at FirstId.
+// Keys with the same V and bitwise equal normals get the same id. The normal of id FirstId + I
+// is Normals[I]; Normals has room for NumKeys normals, of which only those with ids are set.
+//
+// The keys of face F are Keys[FaceOffsets[F], FaceOffsets[F + 1]), and Keys[I].V - 1 indexes
+// Positions. All faces count for the normals, including those whose vertices have a Vn.
+//
+// The normals of the corners around a position are gathered rather than scattered, from a list
+// of the keys sorted by V, so no two threads (0 means one per hardware thread) ever write the
+// same normal, and the result is the same for any number of threads. All temporary memory comes
+// from Arena if that is set.
+void generate_normals(const vec3* Positions, size_t NumPositions, vertex_key* Keys,
+    const size_t* FaceOffsets, size_t NumFaces, i32 FirstId, const normal_options& Options,
+    vec3* Normals, i32 NumThreads = 1, memory_arena* Arena = nullptr);
+
+} // namespace storecast
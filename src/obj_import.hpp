@@ -1,10 +1,20 @@
 #pragma once
 #include "defines.hpp"
+#include "import_stats.hpp"
 #include "math.hpp"
+#include "memory_arena.hpp"
+#include "mesh.hpp"
+#include "normal_generation.hpp"
+#include "vertex_dedup.hpp"
+#include <cstddef>
+#include <initializer_list>
+#include <istream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace storecast {
-struct mesh;
 
 // Flattened list of data in the f face element. For example `f 1/2/3 2/3/4 3/4/5` would be
 // represented as {3, true, true, {1,2,3, 2,3,4, 3,4,5}}, while `f 1//2 3//4` would be
@@ -15,14 +25,255 @@ struct obj_face_data {
   bool HasVn;
   std::vector<i32> Indices;
 };
+
+// Read-only view of the indices of one face in an obj_face_list.
+struct obj_index_range {
+  const i32* Data;
+  size_t Count;
+
+  size_t size() const { return Count; }
+  const i32& operator[](size_t I) const { return Data[I]; }
+  const i32* begin() const { return Data; }
+  const i32* end() const { return Data + Count; }
+};
+// Same as obj_face_data, but Indices points into the obj_face_list it came from.
+struct obj_face {
+  i32 NumVertices;
+  bool HasVt;
+  bool HasVn;
+  obj_index_range Indices;
+};
+
+// All faces of a file. Storing a vector per face would cost one heap allocation per face and
+// scatter the indices all over the heap (see the comment on mesh). Instead, the indices of all
+// faces are stored back to back, and face I owns Indices[Offsets[I]..Offsets[I+1]). Formats[I]
+// says which of vt and vn the face references, and with that how many indices each of its
+// vertices has.
+struct obj_face_list {
+  enum format_flags : u8 {
+    HAS_VT = 1,
+    HAS_VN = 2,
+  };
+
+  std::vector<i32> Indices;
+  std::vector<u32> Offsets = std::vector<u32>(1, 0);
+  std::vector<u8> Formats;
+
+  obj_face_list() = default;
+  obj_face_list(std::initializer_list<obj_face_data> Faces);
+
+  size_t size() const { return Formats.size(); }
+  bool empty() const { return Formats.empty(); }
+  void clear();
+  void reserve(size_t NumFaces, size_t NumIndices);
+  void push_back(const obj_face_data& Face);
+  // Appends a face whose indices have already been appended to Indices.
+  void push_back_format(bool HasVt, bool HasVn)
+  {
+    Formats.push_back(static_cast<u8>((HasVt ? HAS_VT : 0) | (HasVn ? HAS_VN : 0)));
+    Offsets.push_back(static_cast<u32>(Indices.size()));
+  }
+
+  static i32 get_stride(u8 Format)
+  {
+    return 1 + (Format & HAS_VT ? 1 : 0) + (Format & HAS_VN ? 1 : 0);
+  }
+  i32 get_num_vertices(size_t I) const
+  {
+    return static_cast<i32>(Offsets[I + 1] - Offsets[I]) / get_stride(Formats[I]);
+  }
+  obj_face operator[](size_t I) const
+  {
+    return {get_num_vertices(I), (Formats[I] & HAS_VT) != 0, (Formats[I] & HAS_VN) != 0,
+        {Indices.data() + Offsets[I], Offsets[I + 1] - Offsets[I]}};
+  }
+
+  struct const_iterator {
+    typedef std::input_iterator_tag iterator_category;
+    typedef obj_face value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const obj_face* pointer;
+    typedef obj_face reference;
+
+    const obj_face_list* List;
+    size_t Index;
+
+    obj_face operator*() const { return (*List)[Index]; }
+    const_iterator& operator++() { ++Index; return *this; }
+    const_iterator operator++(int) { auto Result = *this; ++Index; return Result; }
+    bool operator==(const const_iterator& Other) const { return Index == Other.Index; }
+    bool operator!=(const const_iterator& Other) const { return Index != Other.Index; }
+  };
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, size()}; }
+};
+
+// Material and group set by usemtl and g statements. The faces from FirstFace up to the FirstFace
+// of the next run use the material and belong to the group with these indices into
+// obj_file_data::MaterialNames and GroupNames. Faces before the first run, or with index -1,
+// have no material or group.
+struct obj_face_run {
+  u32 FirstFace;
+  i32 Material;
+  i32 Group;
+};
+
 struct obj_file_data {
   std::vector<vec3> v;
   std::vector<vec3> vt;
   std::vector<vec3> vn;
-  std::vector<obj_face_data> f;
+  obj_face_list f;
+  // Names in the order in which they first appear in the file.
+  std::vector<std::string> MaterialNames;
+  std::vector<std::string> GroupNames;
+  std::vector<obj_face_run> FaceRuns;
+};
+
+struct obj_parse_options {
+  // Number of threads used to parse the input; 0 means one per hardware thread. With more than
+  // one thread, the input is split at line boundaries into chunks that are parsed independently
+  // and merged afterwards. The result is identical to parsing on one thread.
+  i32 NumThreads = 1;
+  // Approximate number of bytes per chunk. Inputs smaller than this are parsed on one thread.
+  size_t ChunkSize = 4 << 20;
+  // If set, parse_obj adds its phases and counters to it, see import_stats.hpp.
+  import_stats* Stats = nullptr;
+  // Bytes read at a time by parse_obj(std::istream&). A separate thread reads up to two blocks
+  // ahead while the calling thread parses, see pipelined_reader.hpp. Parsing a stream always
+  // happens on the calling thread, whatever NumThreads is.
+  size_t ReadBlockSize = 1 << 20;
+};
+
+struct obj_convert_options {
+  // Number of threads used for the conversion; 0 means one per hardware thread. The result is
+  // identical to converting on one thread.
+  i32 NumThreads = 1;
+  // How face vertices with the same (v, vt, vn) are merged into one mesh vertex. The mesh is the
+  // same either way, see vertex_dedup.hpp.
+  enum class dedup_method {
+    HASH,
+    RADIX_SORT,
+  } DedupMethod = dedup_method::HASH;
+  // Split quads and polygons with more than four vertices into triangles, so that all faces end
+  // up in mesh::TriangleIndices, see triangulate_polygon. Otherwise quads go to
+  // mesh::QuadIndices, and larger polygons are ignored.
+  bool Triangulate = false;
+  // Whether and how to generate normals for face vertices without vn, see normal_generation.hpp.
+  normal_options Normals;
+  // If set, convert_to_mesh adds its phases and counters to it, see import_stats.hpp.
+  import_stats* Stats = nullptr;
+  // If set, all temporary arrays of convert_to_mesh come from this arena instead of the general
+  // heap. It only grows, so reset it between imports.
+  memory_arena* Arena = nullptr;
+};
+
+mesh convert_to_mesh(const obj_file_data& Obj,
+    const obj_convert_options& Options = obj_convert_options());
+obj_file_data parse_obj(std::istream& In,
+    const obj_parse_options& Options = obj_parse_options());
+// Parses the OBJ text in [Data, Data+Size) in place, without copying lines or tokens. The buffer
+// doesn't have to be null-terminated.
+obj_file_data parse_obj(const char* Data, size_t Size,
+    const obj_parse_options& Options = obj_parse_options());
+// Memory-maps the file and parses it with parse_obj(const char*, size_t). Returns empty data if
+// the file can't be opened.
+obj_file_data parse_obj_file(const std::string& Filename,
+    const obj_parse_options& Options = obj_parse_options());
+
+// The same, but they overwrite Result and keep the capacity of its arrays. A service that
+// imports one file after another can keep one obj_file_data and one mesh for all of them, and
+// one memory_arena for obj_convert_options::Arena that it resets after each import. Once they
+// have grown to the largest input, single-threaded imports don't allocate anymore, apart from
+// material and group names that don't fit into a std::string's inline buffer, and from
+// triangulation and interleaved materials.
+void convert_to_mesh(const obj_file_data& Obj, mesh& Result,
+    const obj_convert_options& Options = obj_convert_options());
+void parse_obj(const char* Data, size_t Size, obj_file_data& Result,
+    const obj_parse_options& Options = obj_parse_options());
+void parse_obj(std::istream& In, obj_file_data& Result,
+    const obj_parse_options& Options = obj_parse_options());
+void parse_obj_file(const std::string& Filename, obj_file_data& Result,
+    const obj_parse_options& Options = obj_parse_options());
+
+// Receives the elements of an OBJ file from read_obj, in the order in which they appear in the
+// file. Face indices are already resolved, i.e. relative indices are turned into regular 1-based
+// ones. The Indices of a face point into a buffer that is only valid during the call. on_end is
+// called once after the last element.
+struct obj_visitor {
+  virtual ~obj_visitor() = default;
+  virtual void on_v(const vec3& Value) {}
+  virtual void on_vt(const vec3& Value) {}
+  virtual void on_vn(const vec3& Value) {}
+  virtual void on_face(const obj_face& Face) {}
+  // usemtl and g statements. The name is the rest of the line without surrounding whitespace.
+  virtual void on_material(const std::string& Name) {}
+  virtual void on_group(const std::string& Name) {}
+  virtual void on_end() {}
 };
 
-mesh convert_to_mesh(const obj_file_data& Obj);
-obj_file_data parse_obj(std::istream& In);
+// Streams the OBJ text through Visitor without building an obj_file_data. The input is read
+// BufferSize bytes at a time on a separate thread, a few blocks ahead of the visitor, so apart
+// from what Visitor keeps, memory use doesn't depend on the size of the input. The blocks only
+// grow if a single line doesn't fit into one.
+void read_obj(std::istream& In, obj_visitor& Visitor, size_t BufferSize = 1 << 20);
+// Same as read_obj on the contents of the file. Reads nothing if the file can't be opened.
+void read_obj_file(const std::string& Filename, obj_visitor& Visitor,
+    size_t BufferSize = 1 << 20);
+
+// Goes straight from OBJ text to a mesh in a single pass on the calling thread, without an
+// obj_file_data in between: face vertices are deduplicated while their line is parsed, and
+// written to Result right away. Apart from v, vt and vn, memory use is about the size of the
+// mesh. The result is the same as convert_to_mesh(parse_obj(...)), with the exception noted at
+// obj_mesh_builder. Of Options, NumThreads and DedupMethod don't apply. Like the overloads of
+// convert_to_mesh, the in-place ones keep the capacity of Result's arrays.
+//
+// Generated normals depend on all faces around a vertex, so with Options.Normals, these go
+// through parse_obj and convert_to_mesh instead.
+mesh import_obj_to_mesh(const char* Data, size_t Size,
+    const obj_convert_options& Options = obj_convert_options());
+void import_obj_to_mesh(const char* Data, size_t Size, mesh& Result,
+    const obj_convert_options& Options = obj_convert_options());
+// Memory-maps the file and imports it with import_obj_to_mesh. Returns an empty mesh if the file
+// can't be opened.
+mesh import_obj_file_to_mesh(const std::string& Filename,
+    const obj_convert_options& Options = obj_convert_options());
+void import_obj_file_to_mesh(const std::string& Filename, mesh& Result,
+    const obj_convert_options& Options = obj_convert_options());
+
+// Builds a mesh from the events of read_obj as they come in. Faces are turned into mesh vertices
+// and indices right away and never stored, so only v, vt, vn and the mesh itself are kept in
+// memory. Mesh ends up the same as convert_to_mesh(parse_obj(...)) would return, except that
+// faces which reference elements that only come later in the file are dropped.
+struct obj_mesh_builder : obj_visitor {
+  // Only Options.Triangulate and Options.Arena apply here. Normals aren't generated.
+  explicit obj_mesh_builder(const obj_convert_options& Options = obj_convert_options());
+  // Makes room for that many v, vt and vn elements, and for as many mesh vertices as there are
+  // of the most common one, which is what most files end up with.
+  void reserve(size_t NumV, size_t NumVt, size_t NumVn);
+
+  void on_v(const vec3& Value) override;
+  void on_vt(const vec3& Value) override;
+  void on_vn(const vec3& Value) override;
+  void on_face(const obj_face& Face) override;
+  void on_material(const std::string& Name) override;
+  void on_end() override;
+
+  mesh Mesh;
+
+private:
+  std::vector<vec3> v;
+  std::vector<vec3> vt;
+  std::vector<vec3> vn;
+  vertex_key_map VertexIndices;
+  // The index of every name in Mesh.MaterialNames.
+  std::unordered_map<std::string, i32> MaterialIndices;
+  i32 Material = -1;
+  bool Triangulate;
+  // Scratch space for the current face.
+  std::vector<vertex_key> FaceKeys;
+  std::vector<i32> FaceIndices;
+  std::vector<vec3> Positions;
+  std::vector<i32> Triangles;
+};
 
 } // namespace storecast
@@ -0,0 +1,76 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+namespace storecast
+{
+
+i32 get_num_hardware_threads()
+{
+  return std::max(1, static_cast<i32>(std::thread::hardware_concurrency()));
+}
+
+void parallel_for(i32 NumTasks, i32 NumThreads, const std::function<void(i32 TaskIndex)>& Task)
+{
+  if (NumThreads <= 0) {
+    NumThreads = get_num_hardware_threads();
+  }
+  NumThreads = std::min(NumThreads, NumTasks);
+  if (NumThreads <= 1) {
+    for (i32 I = 0; I < NumTasks; ++I) {
+      Task(I);
+    }
+    return;
+  }
+
+  // Within a pool, e.g. while importing many files at once, nested loops share the pool's threads
+  // instead of starting their own. Idle pool threads steal the tasks.
+  if (auto Pool = thread_pool::get_current()) {
+    thread_pool::task_group Group;
+    for (i32 I = 0; I < NumTasks; ++I) {
+      Pool->submit(Group, [&Task, I] { Task(I); });
+    }
+    Pool->wait(Group);
+    return;
+  }
+
+  std::atomic<i32> NextTask(0);
+  std::mutex ExceptionMutex;
+  std::exception_ptr Exception;
+  auto Worker = [&]() {
+    for (i32 I = NextTask++; I < NumTasks; I = NextTask++) {
+      try {
+        Task(I);
+      } catch (...) {
+        std::lock_guard<std::mutex> Lock(ExceptionMutex);
+        if (!Exception) {
+          Exception = std::current_exception();
+        }
+        // No point in starting more tasks.
+        NextTask = NumTasks;
+      }
+    }
+  };
+  // The calling thread is one of the workers.
+  std::vector<std::thread> Threads;
+  Threads.reserve(NumThreads - 1);
+  for (i32 I = 1; I < NumThreads; ++I) {
+    Threads.emplace_back(Worker);
+  }
+  Worker();
+  for (auto& Thread: Threads) {
+    Thread.join();
+  }
+  if (Exception) {
+    std::rethrow_exception(Exception);
+  }
+}
+
+} // namespace storecast
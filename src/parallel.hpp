@@ -0,0 +1,25 @@
+#pragma once
+#include "defines.hpp"
+#include <functional>
+
+namespace storecast
+{
+
+// Number of threads the hardware can run concurrently, at least 1.
+i32 get_num_hardware_threads();
+
+// Calls Task(I) for every I in [0, NumTasks) on up to NumThreads threads and returns once all
+// of them are done. NumThreads == 0 means one thread per hardware thread. Tasks are handed out in
+// order, but may finish in any order, so each task has to write to its own output. Called from
+// a thread_pool thread, the tasks run on that pool. If tasks throw, the first exception is
+// rethrown once the tasks that have started are done; the others may not run at all.
+void parallel_for(i32 NumTasks, i32 NumThreads, const std::function<void(i32 TaskIndex)>& Task);
+// Same for lambdas and other function objects. They are passed on by reference, since a
+// std::function that holds a lambda with more than a couple of captures allocates.
+template <class task_type>
+void parallel_for(i32 NumTasks, i32 NumThreads, const task_type& Task)
+{
+  parallel_for(NumTasks, NumThreads, std::function<void(i32 TaskIndex)>(std::cref(Task)));
+}
+
+} // namespace storecast
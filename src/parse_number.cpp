@@ -0,0 +1,268 @@
+#include "parse_number.hpp"
+
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if !defined(STORECAST_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define STORECAST_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace storecast
+{
+
+namespace {
+// A u64 can hold any 19 digit decimal number.
+const i32 MaxMantissaDigits = 19;
+
+// All powers of ten that are exactly representable as a double.
+const f64 ExactPowersOfTen[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+const i32 MaxExactPowerOfTen = 22;
+
+bool is_space(char C)
+{
+  return C == ' ' || C == '\t' || C == '\r' || C == '\n' || C == '\v' || C == '\f';
+}
+
+#ifdef STORECAST_SSE2
+i32 count_trailing_zeros(u32 Mask)
+{
+#ifdef _MSC_VER
+  unsigned long Index;
+  _BitScanForward(&Index, Mask);
+  return static_cast<i32>(Index);
+#else
+  return __builtin_ctz(Mask);
+#endif
+}
+#endif
+
+// SWAR ("SIMD within a register") conversion of eight ASCII digits at once. The bytes are
+// loaded little-endian, so the first digit ends up in the lowest byte.
+u64 load_eight_bytes(const char* At)
+{
+  u64 Value;
+  memcpy(&Value, At, sizeof(Value));
+  return Value;
+}
+u32 parse_eight_digits(u64 Value)
+{
+  Value -= 0x3030303030303030ull;
+  Value = (Value * 10) + (Value >> 8);
+  Value = (((Value & 0x000000FF000000FFull) * 0x000F424000000064ull)
+      + (((Value >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+  return static_cast<u32>(Value);
+}
+
+// Appends the N digits at At to Mantissa, as long as it doesn't exceed MaxMantissaDigits.
+// Leading zeros don't count as significant digits. Returns the number of digits that didn't
+// fit; Truncated is set if any of those is not a zero.
+i32 accumulate_digits(const char* At, i32 N, u64& Mantissa, i32& NumDigits, bool& Truncated)
+{
+  if (Mantissa == 0) {
+    for (; N > 0 && *At == '0'; ++At, --N) {}
+  }
+  for (; N >= 8 && NumDigits + 8 <= MaxMantissaDigits; At += 8, N -= 8, NumDigits += 8) {
+    Mantissa = 100000000 * Mantissa + parse_eight_digits(load_eight_bytes(At));
+  }
+  for (; N > 0 && NumDigits < MaxMantissaDigits; ++At, --N, ++NumDigits) {
+    Mantissa = 10 * Mantissa + static_cast<u64>(*At - '0');
+  }
+  for (auto I = 0; I < N; ++I) {
+    Truncated |= At[I] != '0';
+  }
+  return N;
+}
+
+// Converting a correctly rounded double to float rounds twice. That only gives a different
+// result than rounding the exact decimal value once if the double lies exactly halfway between
+// two floats. Denormal and overflowing results are left to strtof as well.
+bool is_ambiguous_as_f32(f64 Value)
+{
+  if (!(FLT_MIN <= Value && Value <= FLT_MAX)) {
+    return true;
+  }
+  u64 Bits;
+  memcpy(&Bits, &Value, sizeof(Bits));
+  const u64 DroppedBits = (u64(1) << (DBL_MANT_DIG - FLT_MANT_DIG)) - 1;
+  const u64 Halfway = u64(1) << (DBL_MANT_DIG - FLT_MANT_DIG - 1);
+  return (Bits & DroppedBits) == Halfway;
+}
+
+// Exact fallback for everything the fast path can't handle: more than 19 significant digits,
+// large exponents, hex floats, inf and nan. strtof needs a null-terminated string, so the token
+// is copied to the stack.
+bool scan_float_with_strtof(const char*& At, const char* End, f32& Value)
+{
+  auto TokenEnd = At;
+  for (; TokenEnd != End && !is_space(*TokenEnd); ++TokenEnd) {}
+  auto Length = static_cast<size_t>(TokenEnd - At);
+  if (Length == 0) {
+    return false;
+  }
+  char Buffer[64];
+  std::string LongToken;
+  const char* Token = Buffer;
+  if (Length < sizeof(Buffer)) {
+    memcpy(Buffer, At, Length);
+    Buffer[Length] = '\0';
+  } else {
+    LongToken.assign(At, Length);
+    Token = LongToken.c_str();
+  }
+  char* ParseEnd;
+  f32 Result = std::strtof(Token, &ParseEnd);
+  if (ParseEnd == Token) {
+    return false;
+  }
+  Value = Result;
+  At += ParseEnd - Token;
+  return true;
+}
+} // anonymous namespace
+
+i32 count_digits(const char* At, const char* End)
+{
+  auto Begin = At;
+#ifdef STORECAST_SSE2
+  const __m128i BeforeZero = _mm_set1_epi8('0' - 1);
+  const __m128i AfterNine = _mm_set1_epi8('9' + 1);
+  for (; End - At >= 16; At += 16) {
+    __m128i Chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(At));
+    __m128i IsDigit = _mm_and_si128(_mm_cmpgt_epi8(Chars, BeforeZero),
+        _mm_cmplt_epi8(Chars, AfterNine));
+    u32 NonDigits = ~static_cast<u32>(_mm_movemask_epi8(IsDigit)) & 0xFFFF;
+    if (NonDigits) {
+      return static_cast<i32>(At - Begin) + count_trailing_zeros(NonDigits);
+    }
+  }
+#endif
+  for (; At != End && static_cast<u8>(*At - '0') < 10; ++At) {}
+  return static_cast<i32>(At - Begin);
+}
+
+bool scan_float(const char*& At, const char* End, f32& Value)
+{
+  auto P = At;
+  bool Negative = false;
+  if (P != End && (*P == '-' || *P == '+')) {
+    Negative = *P == '-';
+    ++P;
+  }
+
+  u64 Mantissa = 0;
+  i32 NumDigits = 0;
+  i32 Exponent = 0;
+  bool Truncated = false;
+
+  auto NumIntegerDigits = count_digits(P, End);
+  Exponent += accumulate_digits(P, NumIntegerDigits, Mantissa, NumDigits, Truncated);
+  P += NumIntegerDigits;
+
+  i32 NumFractionDigits = 0;
+  if (P != End && *P == '.') {
+    ++P;
+    NumFractionDigits = count_digits(P, End);
+    auto NumDropped = accumulate_digits(P, NumFractionDigits, Mantissa, NumDigits, Truncated);
+    Exponent -= NumFractionDigits - NumDropped;
+    P += NumFractionDigits;
+  }
+
+  bool IsHex = NumIntegerDigits == 1 && P != End && (*P == 'x' || *P == 'X');
+  if (NumIntegerDigits + NumFractionDigits == 0 || IsHex) {
+    return scan_float_with_strtof(At, End, Value);
+  }
+
+  // An 'e' without digits after it is not part of the number.
+  if (P != End && (*P == 'e' || *P == 'E')) {
+    auto ExponentAt = P + 1;
+    bool NegativeExponent = false;
+    if (ExponentAt != End && (*ExponentAt == '-' || *ExponentAt == '+')) {
+      NegativeExponent = *ExponentAt == '-';
+      ++ExponentAt;
+    }
+    auto NumExponentDigits = count_digits(ExponentAt, End);
+    if (NumExponentDigits > 0) {
+      i32 ExplicitExponent = 0;
+      for (auto I = 0; I < NumExponentDigits && ExplicitExponent < 100000; ++I) {
+        ExplicitExponent = 10 * ExplicitExponent + (ExponentAt[I] - '0');
+      }
+      Exponent += NegativeExponent ? -ExplicitExponent : ExplicitExponent;
+      P = ExponentAt + NumExponentDigits;
+    }
+  }
+
+  if (Mantissa == 0 && !Truncated) {
+    Value = Negative ? -0.f : 0.f;
+    At = P;
+    return true;
+  }
+
+  // Clinger's fast path: both the mantissa and the power of ten are exact doubles, so a single
+  // multiplication or division rounds correctly.
+  if (!Truncated && Mantissa <= (u64(1) << 53)
+      && -MaxExactPowerOfTen <= Exponent && Exponent <= MaxExactPowerOfTen) {
+    auto Result = static_cast<f64>(Mantissa);
+    if (Exponent < 0) {
+      Result /= ExactPowersOfTen[-Exponent];
+    } else {
+      Result *= ExactPowersOfTen[Exponent];
+    }
+    if (!is_ambiguous_as_f32(Result)) {
+      auto SingleResult = static_cast<f32>(Result);
+      Value = Negative ? -SingleResult : SingleResult;
+      At = P;
+      return true;
+    }
+  }
+  return scan_float_with_strtof(At, End, Value);
+}
+
+bool scan_int(const char*& At, const char* End, i32& Value)
+{
+  auto P = At;
+  bool Negative = false;
+  if (P != End && (*P == '-' || *P == '+')) {
+    Negative = *P == '-';
+    ++P;
+  }
+  auto NumDigits = count_digits(P, End);
+  if (NumDigits == 0) {
+    return false;
+  }
+
+  const u64 MaxMagnitude = 2147483647;
+  auto DigitsEnd = P + NumDigits;
+  // Leading zeros don't count towards the digits that can overflow.
+  while (P != DigitsEnd && *P == '0') {
+    ++P;
+  }
+  NumDigits = static_cast<i32>(DigitsEnd - P);
+  u64 Magnitude = 0;
+  if (NumDigits > 10) {
+    Magnitude = MaxMagnitude;
+  } else {
+    if (NumDigits >= 8) {
+      Magnitude = parse_eight_digits(load_eight_bytes(P));
+      P += 8;
+    }
+    for (; P != DigitsEnd; ++P) {
+      Magnitude = 10 * Magnitude + static_cast<u64>(*P - '0');
+    }
+    Magnitude = Magnitude < MaxMagnitude ? Magnitude : MaxMagnitude;
+  }
+  Value = Negative ? -static_cast<i32>(Magnitude) : static_cast<i32>(Magnitude);
+  At = DigitsEnd;
+  return true;
+}
+
+} // namespace storecast
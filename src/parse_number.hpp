@@ -0,0 +1,24 @@
+#pragma once
+#include "defines.hpp"
+
+namespace storecast
+{
+
+// Allocation-free number scanning for the OBJ importer. All functions work on [At, End) ranges
+// that don't need to be null-terminated, and advance At past the characters they consumed.
+//
+// Set STORECAST_NO_SIMD to disable the SSE2 digit scanner. The results don't depend on it.
+
+// Number of consecutive decimal digits starting at At.
+i32 count_digits(const char* At, const char* End);
+
+// Parses a decimal floating point number such as "-12.5e-3" and rounds it correctly to the
+// nearest f32, i.e. the result is bit-identical to std::strtof. Leading whitespace is not
+// skipped. Returns false and leaves At unchanged if there's no number at At.
+bool scan_float(const char*& At, const char* End, f32& Value);
+
+// Parses an optionally signed decimal integer. Values that don't fit into an i32 are clamped.
+// Returns false and leaves At unchanged if there are no digits.
+bool scan_int(const char*& At, const char* End, i32& Value);
+
+} // namespace storecast
@@ -0,0 +1,118 @@
+#include "pipelined_reader.hpp"
+
+#include <algorithm>
+
+namespace storecast
+{
+
+pipelined_reader::pipelined_reader(std::istream& In, size_t BlockSize, i32 NumBlocks,
+    import_stats* Stats)
+  : In(In), BlockSize(std::max<size_t>(BlockSize, 1)), Stats(get_enabled_stats(Stats)),
+    Blocks(std::max(NumBlocks, 1)), FilledBlocks(Blocks.size() + 1), FreeBlocks(Blocks.size())
+{
+  for (i32 I = 0; I < static_cast<i32>(Blocks.size()); ++I) {
+    FreeBlocks.try_push(I);
+  }
+  Reader = std::thread([this] { run_reader(); });
+}
+
+pipelined_reader::~pipelined_reader()
+{
+  IsStopping = true;
+  Reader.join();
+  if (Stats) {
+    Stats->Events.insert(Stats->Events.end(), ReadEvents.begin(), ReadEvents.end());
+  }
+}
+
+bool pipelined_reader::next(const char*& Begin, const char*& End)
+{
+  if (CurrentBlock >= 0) {
+    // There's always room, since the queue holds all blocks.
+    FreeBlocks.try_push(CurrentBlock);
+    CurrentBlock = -1;
+  }
+  if (IsAtEnd) {
+    return false;
+  }
+  i32 Index = -1;
+  FilledBlocks.pop(Index, [] { return false; });
+  if (Index < 0) {
+    IsAtEnd = true;
+    if (Error) {
+      std::rethrow_exception(Error);
+    }
+    return false;
+  }
+  CurrentBlock = Index;
+  auto& Block = Blocks[Index];
+  Begin = Block.Data.data();
+  End = Begin + Block.LinesEnd;
+  return true;
+}
+
+void pipelined_reader::run_reader()
+{
+  try {
+    read_blocks();
+  } catch (...) {
+    Error = std::current_exception();
+    // FilledBlocks has room for every block and the end marker.
+    FilledBlocks.try_push(-1);
+  }
+}
+
+void pipelined_reader::read_blocks()
+{
+  auto ShouldStop = [this] { return IsStopping.load(); };
+  // The incomplete last line of the previous block.
+  std::vector<char> Carry;
+  for (;;) {
+    i32 Index = -1;
+    if (!FreeBlocks.pop(Index, ShouldStop)) {
+      return;
+    }
+    import_event Event = {};
+    if (Stats) {
+      Event = begin_import_event("read_block");
+    }
+    auto& Block = Blocks[Index];
+    if (Block.Data.size() < Carry.size() + BlockSize) {
+      Block.Data.resize(Carry.size() + BlockSize);
+    }
+    std::copy(Carry.begin(), Carry.end(), Block.Data.begin());
+    Block.NumBytes = Carry.size();
+    bool AtEndOfInput = false;
+    for (;;) {
+      In.read(Block.Data.data() + Block.NumBytes, Block.Data.size() - Block.NumBytes);
+      Block.NumBytes += static_cast<size_t>(In.gcount());
+      AtEndOfInput = !In;
+      if (AtEndOfInput) {
+        Block.LinesEnd = Block.NumBytes;
+        break;
+      }
+      auto LinesEnd = Block.NumBytes;
+      while (LinesEnd != 0 && Block.Data[LinesEnd - 1] != '\n') {
+        --LinesEnd;
+      }
+      if (LinesEnd != 0) {
+        Block.LinesEnd = LinesEnd;
+        break;
+      }
+      // Not even one line fits into the block.
+      Block.Data.resize(2 * Block.Data.size());
+    }
+    Carry.assign(Block.Data.begin() + Block.LinesEnd, Block.Data.begin() + Block.NumBytes);
+    if (Stats) {
+      end_import_event(Event);
+      ReadEvents.push_back(Event);
+    }
+    FilledBlocks.try_push(Index);
+    if (AtEndOfInput) {
+      FilledBlocks.try_push(-1);
+      return;
+    }
+  }
+}
+
+} // namespace storecast
@@ -0,0 +1,66 @@
+#pragma once
+#include "defines.hpp"
+#include "import_stats.hpp"
+#include "spsc_queue.hpp"
+#include <atomic>
+#include <exception>
+#include <istream>
+#include <thread>
+#include <vector>
+
+namespace storecast
+{
+
+// Reads a stream on a separate thread, one block ahead of the caller, and hands out the input
+// in ranges of complete lines. While the caller parses one block, the next ones are being read,
+// so that an import from slow storage takes about as long as the slower of reading and parsing
+// instead of their sum. Filled and emptied blocks go back and forth through two spsc_queues.
+//
+// The platform's asynchronous file APIs (io_uring, overlapped I/O) would save the thread, but
+// they don't work on a std::istream, and a thread that mostly sleeps in read costs next to
+// nothing.
+class pipelined_reader {
+public:
+  // Blocks start at BlockSize bytes, and only grow if a single line doesn't fit. NumBlocks of
+  // them are in flight, so that's about how much memory the reader takes. If Stats is set, the
+  // reading thread records a read_block phase per block, see import_stats.hpp.
+  pipelined_reader(std::istream& In, size_t BlockSize = 1 << 20, i32 NumBlocks = 3,
+      import_stats* Stats = nullptr);
+  // Stops reading, even if the caller didn't get to the end of the input.
+  ~pipelined_reader();
+  pipelined_reader(const pipelined_reader&) = delete;
+  pipelined_reader& operator=(const pipelined_reader&) = delete;
+
+  // Sets [Begin, End) to the next complete lines, including their '\n' except for the last line
+  // of the input if it has none. The range stays valid until the next call. Returns false at the
+  // end of the input. Rethrows exceptions from the reading thread, e.g. std::bad_alloc.
+  bool next(const char*& Begin, const char*& End);
+
+private:
+  struct block {
+    std::vector<char> Data;
+    // Bytes read into Data, and the end of its last complete line. The rest is copied to the
+    // start of the next block.
+    size_t NumBytes = 0;
+    size_t LinesEnd = 0;
+  };
+  std::istream& In;
+  size_t BlockSize;
+  import_stats* Stats;
+  std::vector<block> Blocks;
+  // Indices of blocks, filled ones to the caller, and emptied ones back to the reading thread.
+  // -1 marks the end of the input.
+  spsc_queue<i32> FilledBlocks;
+  spsc_queue<i32> FreeBlocks;
+  i32 CurrentBlock = -1;
+  bool IsAtEnd = false;
+  std::atomic<bool> IsStopping{false};
+  std::exception_ptr Error;
+  std::vector<import_event> ReadEvents;
+  std::thread Reader;
+
+  void run_reader();
+  void read_blocks();
+};
+
+} // namespace storecast
@@ -0,0 +1,553 @@
+#include "simplify.hpp"
+
+#include "parallel.hpp"
+#include "vertex_dedup.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace storecast
+{
+using std::vector;
+
+namespace {
+// Sum of squared distances to a set of planes: Error(P) = P^T A P + 2 B.P + C.
+struct quadric {
+  f64 A00, A01, A02, A11, A12, A22;
+  f64 B0, B1, B2;
+  f64 C;
+};
+
+quadric operator+(const quadric& L, const quadric& R)
+{
+  return {L.A00 + R.A00, L.A01 + R.A01, L.A02 + R.A02, L.A11 + R.A11, L.A12 + R.A12,
+      L.A22 + R.A22, L.B0 + R.B0, L.B1 + R.B1, L.B2 + R.B2, L.C + R.C};
+}
+
+// Adds the plane through Point with the unit normal Normal.
+void add_plane(quadric& Q, const vec3& Normal, const vec3& Point)
+{
+  f64 A = Normal.X, B = Normal.Y, C = Normal.Z;
+  f64 D = -(A * Point.X + B * Point.Y + C * Point.Z);
+  Q.A00 += A * A; Q.A01 += A * B; Q.A02 += A * C;
+  Q.A11 += B * B; Q.A12 += B * C; Q.A22 += C * C;
+  Q.B0 += A * D; Q.B1 += B * D; Q.B2 += C * D;
+  Q.C += D * D;
+}
+
+f64 evaluate(const quadric& Q, const vec3& P)
+{
+  f64 X = P.X, Y = P.Y, Z = P.Z;
+  f64 Error = Q.A00 * X * X + Q.A11 * Y * Y + Q.A22 * Z * Z
+      + 2 * (Q.A01 * X * Y + Q.A02 * X * Z + Q.A12 * Y * Z)
+      + 2 * (Q.B0 * X + Q.B1 * Y + Q.B2 * Z) + Q.C;
+  // Rounding can make it slightly negative.
+  return std::max(Error, 0.0);
+}
+
+vec3 get_unit(const vec3& V)
+{
+  f32 LengthSquared = length_squared(V);
+  return LengthSquared > 0.f ? V * (1.f / std::sqrt(LengthSquared)) : vec3{0.f, 0.f, 0.f};
+}
+
+enum class vertex_kind : u8 { INTERIOR, BORDER, LOCKED };
+
+constexpr f64 Infinity = std::numeric_limits<f64>::infinity();
+constexpr i32 VerticesPerTask = 1 << 14;
+// Relative to the quadric error, which is a squared distance too.
+constexpr f64 EdgeLengthWeight = 1e-4;
+
+struct simplifier {
+  const vector<vertex_data>& Vertices;
+  i32 NumVertices;
+  // Three per triangle. Collapses rewrite the corners in place.
+  vector<i32> Indices;
+  vector<i32> Materials;
+  vector<bool> DeadTriangles;
+  i32 NumLiveTriangles;
+
+  // The triangles of each vertex are Adjacency[AdjacencyOffsets[V], + AdjacencyCounts[V]), dead
+  // ones included. Collapsing into V rewrites its list with only the live ones, in place while
+  // they fit into AdjacencyCapacities[V], and otherwise at the end of Adjacency.
+  vector<i32> AdjacencyOffsets;
+  vector<i32> AdjacencyCounts;
+  vector<i32> AdjacencyCapacities;
+  vector<i32> Adjacency;
+  vector<bool> Removed;
+
+  vector<quadric> Quadrics;
+  vector<vertex_kind> Kinds;
+  // The cheapest collapse of each vertex, and a min-heap of vertices by that cost.
+  vector<f64> Costs;
+  vector<i32> Targets;
+  vector<i32> Heap;
+  vector<i32> HeapPositions;
+
+  // Scratch space.
+  vector<i32> Merged;
+  vector<std::pair<f64, i32>> Candidates;
+  vector<i32> Neighbors;
+  vector<u32> Marks;
+  u32 Stamp = 0;
+
+  simplifier(const vector<vertex_data>& Vertices, vector<i32>&& Indices, vector<i32>&& Materials)
+    : Vertices(Vertices), NumVertices(static_cast<i32>(Vertices.size())),
+      Indices(std::move(Indices)), Materials(std::move(Materials))
+  {
+    auto NumTriangles = static_cast<i32>(this->Indices.size() / 3);
+    NumLiveTriangles = NumTriangles;
+    DeadTriangles.assign(NumTriangles, false);
+    AdjacencyOffsets.assign(NumVertices + 1, 0);
+    for (auto V: this->Indices) {
+      ++AdjacencyOffsets[V + 1];
+    }
+    for (i32 V = 0; V < NumVertices; ++V) {
+      AdjacencyOffsets[V + 1] += AdjacencyOffsets[V];
+    }
+    Adjacency.resize(this->Indices.size());
+    AdjacencyCounts.assign(NumVertices, 0);
+    for (size_t I = 0; I < this->Indices.size(); ++I) {
+      auto V = this->Indices[I];
+      Adjacency[AdjacencyOffsets[V] + AdjacencyCounts[V]++] = static_cast<i32>(I / 3);
+    }
+    AdjacencyOffsets.pop_back();
+    AdjacencyCapacities = AdjacencyCounts;
+    Removed.assign(NumVertices, false);
+    Marks.assign(NumVertices, 0);
+  }
+
+  template <typename function>
+  void for_each_triangle(i32 V, const function& Function) const
+  {
+    auto* Triangles = &Adjacency[AdjacencyOffsets[V]];
+    for (i32 I = 0; I < AdjacencyCounts[V]; ++I) {
+      if (!DeadTriangles[Triangles[I]]) {
+        Function(Triangles[I]);
+      }
+    }
+  }
+
+  bool has_corner(i32 Triangle, i32 V) const
+  {
+    auto* Corners = &Indices[3 * Triangle];
+    return Corners[0] == V || Corners[1] == V || Corners[2] == V;
+  }
+
+  i32 count_shared_triangles(i32 U, i32 V) const
+  {
+    i32 Count = 0;
+    for_each_triangle(U, [&](i32 T) { Count += has_corner(T, V); });
+    return Count;
+  }
+
+  void classify_and_accumulate(i32 V, const vector<i32>& PositionIds,
+      const vector<i32>& NumVerticesAtPosition)
+  {
+    quadric Q = {};
+    bool IsLocked = NumVerticesAtPosition[PositionIds[V]] > 1;
+    bool IsBorder = false;
+    i32 Material = -2;
+    for_each_triangle(V, [&](i32 T) {
+      if (Material != -2 && Materials[T] != Material) {
+        IsLocked = true;
+      }
+      Material = Materials[T];
+      auto* Corners = &Indices[3 * T];
+      auto& P0 = Vertices[Corners[0]].Position;
+      auto& P1 = Vertices[Corners[1]].Position;
+      auto& P2 = Vertices[Corners[2]].Position;
+      vec3 Normal = get_unit(cross(P1 - P0, P2 - P0));
+      if (length_squared(Normal) == 0.f) {
+        return;
+      }
+      add_plane(Q, Normal, P0);
+      for3(Corner) {
+        if (Corners[Corner] != V) {
+          continue;
+        }
+        // The two edges of T at V. Edges with one triangle are on a border, and edges with more
+        // than two aren't manifold.
+        for (auto Other: {Corners[(Corner + 1) % 3], Corners[(Corner + 2) % 3]}) {
+          auto NumShared = count_shared_triangles(V, Other);
+          if (NumShared > 2) {
+            IsLocked = true;
+          } else if (NumShared == 1) {
+            IsBorder = true;
+            // A plane through the edge, perpendicular to the triangle, keeps the border in place.
+            auto& Position = Vertices[Other].Position;
+            add_plane(Q, get_unit(cross(Position - Vertices[V].Position, Normal)), Position);
+          }
+        }
+      }
+    });
+    Quadrics[V] = Q;
+    Kinds[V] = IsLocked ? vertex_kind::LOCKED
+        : IsBorder ? vertex_kind::BORDER : vertex_kind::INTERIOR;
+  }
+
+  // Whether collapsing U into V keeps the mesh manifold and doesn't flip any triangle.
+  bool is_collapse_valid(i32 U, i32 V)
+  {
+    // The link condition: U and V may only share the neighbors across their common triangles.
+    // V's neighbors get marked with Stamp, and common ones with Stamp + 1 once counted.
+    Stamp += 2;
+    for_each_triangle(V, [&](i32 T) {
+      for3(Corner) {
+        Marks[Indices[3 * T + Corner]] = Stamp;
+      }
+    });
+    Marks[U] = 0;
+    Marks[V] = 0;
+    i32 NumCommon = 0;
+    i32 NumShared = 0;
+    for_each_triangle(U, [&](i32 T) {
+      NumShared += has_corner(T, V);
+      for3(Corner) {
+        auto& Mark = Marks[Indices[3 * T + Corner]];
+        if (Mark == Stamp) {
+          Mark = Stamp + 1;
+          ++NumCommon;
+        }
+      }
+    });
+    if (NumCommon != NumShared) {
+      return false;
+    }
+
+    bool IsValid = true;
+    auto& Target = Vertices[V].Position;
+    for_each_triangle(U, [&](i32 T) {
+      if (!IsValid || has_corner(T, V)) {
+        return;
+      }
+      auto* Corners = &Indices[3 * T];
+      vec3 Old[3];
+      vec3 New[3];
+      for3(Corner) {
+        Old[Corner] = Vertices[Corners[Corner]].Position;
+        New[Corner] = Corners[Corner] == U ? Target : Old[Corner];
+      }
+      vec3 OldNormal = cross(Old[1] - Old[0], Old[2] - Old[0]);
+      vec3 NewNormal = cross(New[1] - New[0], New[2] - New[0]);
+      IsValid = dot(OldNormal, NewNormal) > 0.f;
+    });
+    return IsValid;
+  }
+
+  f64 get_error(i32 U, i32 V) const
+  {
+    return evaluate(Quadrics[U] + Quadrics[V], Vertices[V].Position);
+  }
+
+  // Where many collapses cost nothing, as on flat areas, preferring the short ones spreads them
+  // evenly instead of piling them up on a few vertices with huge fans.
+  f64 get_cost(i32 U, i32 V) const
+  {
+    return get_error(U, V)
+        + EdgeLengthWeight * length_squared(Vertices[V].Position - Vertices[U].Position);
+  }
+
+  // Finds U's cheapest collapse. With Validate, only collapses that pass is_collapse_valid count;
+  // otherwise that's checked when the collapse comes up. Only the serial part may validate,
+  // since that uses the scratch space.
+  void update_cost(i32 U, bool Validate)
+  {
+    Costs[U] = Infinity;
+    Targets[U] = -1;
+    if (Kinds[U] == vertex_kind::LOCKED) {
+      return;
+    }
+    if (Validate) {
+      Candidates.clear();
+    }
+    for_each_triangle(U, [&](i32 T) {
+      for3(Corner) {
+        auto V = Indices[3 * T + Corner];
+        if (V == U) {
+          continue;
+        }
+        // A border vertex may only move along the border.
+        if (Kinds[U] == vertex_kind::BORDER
+            && (Kinds[V] == vertex_kind::INTERIOR || count_shared_triangles(U, V) != 1)) {
+          continue;
+        }
+        f64 Cost = get_cost(U, V);
+        if (Validate) {
+          Candidates.push_back({Cost, V});
+        } else if (Cost < Costs[U]) {
+          Costs[U] = Cost;
+          Targets[U] = V;
+        }
+      }
+    });
+    if (!Validate) {
+      return;
+    }
+    // Checking is far more expensive than the cost, so check the cheapest first.
+    std::sort(Candidates.begin(), Candidates.end());
+    for (auto& Candidate: Candidates) {
+      if (is_collapse_valid(U, Candidate.second)) {
+        Costs[U] = Candidate.first;
+        Targets[U] = Candidate.second;
+        return;
+      }
+    }
+  }
+
+  void swap_in_heap(size_t I, size_t J)
+  {
+    std::swap(Heap[I], Heap[J]);
+    HeapPositions[Heap[I]] = static_cast<i32>(I);
+    HeapPositions[Heap[J]] = static_cast<i32>(J);
+  }
+
+  void sift_up(size_t I)
+  {
+    while (I > 0 && Costs[Heap[I]] < Costs[Heap[(I - 1) / 2]]) {
+      swap_in_heap(I, (I - 1) / 2);
+      I = (I - 1) / 2;
+    }
+  }
+
+  void sift_down(size_t I)
+  {
+    while (true) {
+      size_t Smallest = I;
+      for (auto Child: {2 * I + 1, 2 * I + 2}) {
+        if (Child < Heap.size() && Costs[Heap[Child]] < Costs[Heap[Smallest]]) {
+          Smallest = Child;
+        }
+      }
+      if (Smallest == I) {
+        return;
+      }
+      swap_in_heap(I, Smallest);
+      I = Smallest;
+    }
+  }
+
+  void remove_from_heap(i32 V)
+  {
+    auto I = static_cast<size_t>(HeapPositions[V]);
+    swap_in_heap(I, Heap.size() - 1);
+    Heap.pop_back();
+    HeapPositions[V] = -1;
+    if (I < Heap.size()) {
+      sift_up(I);
+      sift_down(I);
+    }
+  }
+
+  // Puts V where its new cost belongs, adding or removing it as needed.
+  void update_heap(i32 V)
+  {
+    if (Costs[V] == Infinity) {
+      if (HeapPositions[V] >= 0) {
+        remove_from_heap(V);
+      }
+      return;
+    }
+    if (HeapPositions[V] < 0) {
+      HeapPositions[V] = static_cast<i32>(Heap.size());
+      Heap.push_back(V);
+    }
+    sift_up(HeapPositions[V]);
+    sift_down(HeapPositions[V]);
+  }
+
+  void initialize(i32 NumThreads)
+  {
+    vector<i32> PositionIds(NumVertices);
+    vector<i32> NumVerticesAtPosition(NumVertices, 0);
+    {
+      // Vertices with bitwise equal positions were split by convert_to_mesh because their UVs or
+      // normals differ.
+      vertex_key_map Positions(Vertices.size());
+      for (i32 V = 0; V < NumVertices; ++V) {
+        vertex_key Key;
+        memcpy(&Key, &Vertices[V].Position, sizeof(Key));
+        PositionIds[V] = Positions.insert(Key, V);
+        ++NumVerticesAtPosition[PositionIds[V]];
+      }
+    }
+
+    Quadrics.resize(NumVertices);
+    Kinds.resize(NumVertices);
+    Costs.resize(NumVertices);
+    Targets.resize(NumVertices);
+    auto NumTasks = (NumVertices + VerticesPerTask - 1) / VerticesPerTask;
+    // Every vertex sums up the planes of its own triangles, so the tasks don't share any output.
+    parallel_for(NumTasks, NumThreads, [&](i32 Task) {
+      auto End = std::min(NumVertices, (Task + 1) * VerticesPerTask);
+      for (auto V = Task * VerticesPerTask; V < End; ++V) {
+        classify_and_accumulate(V, PositionIds, NumVerticesAtPosition);
+      }
+    });
+    parallel_for(NumTasks, NumThreads, [&](i32 Task) {
+      auto End = std::min(NumVertices, (Task + 1) * VerticesPerTask);
+      for (auto V = Task * VerticesPerTask; V < End; ++V) {
+        update_cost(V, false);
+      }
+    });
+
+    HeapPositions.assign(NumVertices, -1);
+    for (i32 V = 0; V < NumVertices; ++V) {
+      if (Costs[V] != Infinity) {
+        HeapPositions[V] = static_cast<i32>(Heap.size());
+        Heap.push_back(V);
+      }
+    }
+    for (auto I = Heap.size() / 2; I-- > 0;) {
+      sift_down(I);
+    }
+  }
+
+  void collapse(i32 U, i32 V)
+  {
+    Merged.clear();
+    for_each_triangle(U, [&](i32 T) {
+      if (has_corner(T, V)) {
+        DeadTriangles[T] = true;
+        --NumLiveTriangles;
+        return;
+      }
+      for3(Corner) {
+        if (Indices[3 * T + Corner] == U) {
+          Indices[3 * T + Corner] = V;
+        }
+      }
+      Merged.push_back(T);
+    });
+    for_each_triangle(V, [&](i32 T) { Merged.push_back(T); });
+    auto NumMerged = static_cast<i32>(Merged.size());
+    if (NumMerged > AdjacencyCapacities[V]) {
+      AdjacencyOffsets[V] = static_cast<i32>(Adjacency.size());
+      AdjacencyCapacities[V] = 2 * NumMerged;
+      Adjacency.resize(Adjacency.size() + AdjacencyCapacities[V]);
+    }
+    std::copy(Merged.begin(), Merged.end(), Adjacency.begin() + AdjacencyOffsets[V]);
+    AdjacencyCounts[V] = NumMerged;
+    AdjacencyCounts[U] = 0;
+    Quadrics[V] = Quadrics[V] + Quadrics[U];
+    Kinds[U] = vertex_kind::LOCKED;
+    Removed[U] = true;
+    if (HeapPositions[U] >= 0) {
+      remove_from_heap(U);
+    }
+
+    // Everything around V can now collapse differently.
+    collect_around(V);
+    for (auto W: Neighbors) {
+      update_cost(W, false);
+      update_heap(W);
+    }
+  }
+
+  void collect_around(i32 V)
+  {
+    Neighbors.clear();
+    Neighbors.push_back(V);
+    for_each_triangle(V, [&](i32 T) {
+      for3(Corner) {
+        Neighbors.push_back(Indices[3 * T + Corner]);
+      }
+    });
+    std::sort(Neighbors.begin(), Neighbors.end());
+    Neighbors.erase(std::unique(Neighbors.begin(), Neighbors.end()), Neighbors.end());
+  }
+
+  // Collapses the cheapest edges until at most TargetTriangles are left, or nothing can
+  // collapse anymore. Returns the largest error of any collapse so far.
+  f64 simplify(i32 TargetTriangles, f64 MaxError)
+  {
+    while (NumLiveTriangles > TargetTriangles && !Heap.empty()) {
+      auto U = Heap[0];
+      auto V = Targets[U];
+      // Costs are only updated around each collapse, so the target may be gone already.
+      if (Removed[V] || !is_collapse_valid(U, V)) {
+        update_cost(U, true);
+        update_heap(U);
+        continue;
+      }
+      MaxError = std::max(MaxError, get_error(U, V));
+      collapse(U, V);
+    }
+    return MaxError;
+  }
+
+  mesh get_mesh(const vector<std::string>& MaterialNames) const
+  {
+    mesh Result;
+    vector<i32> NewIndices(NumVertices, -1);
+    Result.TriangleIndices.reserve(3 * NumLiveTriangles);
+    for (size_t T = 0; T < DeadTriangles.size(); ++T) {
+      if (DeadTriangles[T]) {
+        continue;
+      }
+      add_to_ranges(Result.TriangleRanges, Materials[T],
+          static_cast<i32>(Result.TriangleIndices.size()), 3);
+      for3(Corner) {
+        auto& NewIndex = NewIndices[Indices[3 * T + Corner]];
+        if (NewIndex < 0) {
+          NewIndex = static_cast<i32>(Result.Vertices.size());
+          Result.Vertices.push_back(Vertices[Indices[3 * T + Corner]]);
+        }
+        Result.TriangleIndices.push_back(NewIndex);
+      }
+    }
+    group_by_material(Result.TriangleIndices, Result.TriangleRanges);
+    Result.MaterialNames = MaterialNames;
+    return Result;
+  }
+};
+
+// Appends the faces of Ranges to Triangles, with one material per triangle. Quads are split
+// along their first diagonal.
+void append_triangles(const vector<i32>& FaceIndices, i32 FaceSize,
+    const vector<mesh_range>& Ranges, vector<i32>& Triangles, vector<i32>& Materials)
+{
+  auto append = [&](i32 Material, i32 StartIndex, i32 NumIndices) {
+    for (auto I = StartIndex; I < StartIndex + NumIndices; I += FaceSize) {
+      auto* Face = &FaceIndices[I];
+      for (i32 Corner = 1; Corner + 1 < FaceSize; ++Corner) {
+        Triangles.insert(Triangles.end(), {Face[0], Face[Corner], Face[Corner + 1]});
+        Materials.push_back(Material);
+      }
+    }
+  };
+  if (Ranges.empty()) {
+    append(-1, 0, static_cast<i32>(FaceIndices.size()));
+  }
+  for (auto& Range: Ranges) {
+    append(Range.Material, Range.StartIndex, Range.NumIndices);
+  }
+}
+} // anonymous namespace
+
+vector<lod_level> build_lod_chain(const mesh& Mesh, const lod_options& Options)
+{
+  vector<i32> Triangles;
+  vector<i32> Materials;
+  append_triangles(Mesh.TriangleIndices, 3, Mesh.TriangleRanges, Triangles, Materials);
+  append_triangles(Mesh.QuadIndices, 4, Mesh.QuadRanges, Triangles, Materials);
+  auto NumTriangles = static_cast<f32>(Materials.size());
+
+  simplifier Simplifier(Mesh.Vertices, std::move(Triangles), std::move(Materials));
+  Simplifier.initialize(Options.NumThreads);
+  vector<lod_level> Result;
+  f64 MaxError = 0.0;
+  for (auto Ratio: Options.TriangleRatios) {
+    auto TargetTriangles = static_cast<i32>(NumTriangles * Ratio);
+    MaxError = Simplifier.simplify(TargetTriangles, MaxError);
+    Result.push_back({Simplifier.get_mesh(Mesh.MaterialNames), TargetTriangles,
+        static_cast<f32>(std::sqrt(MaxError))});
+  }
+  return Result;
+}
+
+} // namespace storecast
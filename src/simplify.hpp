@@ -0,0 +1,35 @@
+#pragma once
+#include "defines.hpp"
+#include "mesh.hpp"
+#include <vector>
+
+namespace storecast
+{
+
+// Levels of detail by edge collapse with quadric error metrics [Garland and Heckbert 1997].
+// Vertices only ever collapse into a neighbor, so the LODs use a subset of the input vertices,
+// with their attributes unchanged. UV and normal seams stay intact: a position that
+// convert_to_mesh split into several vertices is locked, and so are vertices on the boundary
+// between materials. Vertices on an open border only slide along the border.
+
+struct lod_options {
+  // Target triangle counts, as fractions of the input's, from the most to the least detailed.
+  std::vector<f32> TriangleRatios = {0.5f, 0.25f, 0.1f};
+  // Threads for building the quadrics and the initial collapse costs; 0 means one per hardware
+  // thread. The collapses themselves run serially, and the result doesn't depend on this.
+  i32 NumThreads = 1;
+};
+
+struct lod_level {
+  // Triangles only; quads are split before simplifying.
+  mesh Mesh;
+  i32 TargetTriangles;
+  // The square root of the largest quadric error of any collapse so far, in the units of the
+  // positions: roughly how far the surface has moved. Levels can end up above TargetTriangles if
+  // every remaining collapse is locked or would flip a triangle.
+  f32 Error;
+};
+
+std::vector<lod_level> build_lod_chain(const mesh& Mesh, const lod_options& Options = {});
+
+} // namespace storecast
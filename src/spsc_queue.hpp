@@ -0,0 +1,78 @@
+#pragma once
+#include "defines.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace storecast
+{
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread. Both
+// ends only touch their own index and read the other one, so handing an item over costs two
+// atomic operations and never blocks in the kernel. Meant for small items like buffer indices.
+template <class value_type>
+class spsc_queue {
+public:
+  explicit spsc_queue(size_t Capacity) : Items(Capacity + 1) {}
+  spsc_queue(const spsc_queue&) = delete;
+  spsc_queue& operator=(const spsc_queue&) = delete;
+
+  // Producer only. Returns false if the queue is full.
+  bool try_push(const value_type& Value)
+  {
+    auto Tail = WriteIndex.Value.load(std::memory_order_relaxed);
+    auto NextTail = Tail + 1 == Items.size() ? 0 : Tail + 1;
+    if (NextTail == ReadIndex.Value.load(std::memory_order_acquire)) {
+      return false;
+    }
+    Items[Tail] = Value;
+    WriteIndex.Value.store(NextTail, std::memory_order_release);
+    return true;
+  }
+  // Consumer only. Returns false if the queue is empty.
+  bool try_pop(value_type& Value)
+  {
+    auto Head = ReadIndex.Value.load(std::memory_order_relaxed);
+    if (Head == WriteIndex.Value.load(std::memory_order_acquire)) {
+      return false;
+    }
+    Value = Items[Head];
+    ReadIndex.Value.store(Head + 1 == Items.size() ? 0 : Head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Waits for an item, or until ShouldStop() returns true, in which case it
+  // returns false. It spins briefly, since the producer is usually just about to deliver, and
+  // then sleeps in short steps, so that a consumer that waits for a slow disk doesn't take a
+  // core away from the producer.
+  template <class stop_function>
+  bool pop(value_type& Value, const stop_function& ShouldStop)
+  {
+    for (i32 Attempt = 0; !try_pop(Value); ++Attempt) {
+      if (ShouldStop()) {
+        return false;
+      }
+      if (Attempt < 64) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    }
+    return true;
+  }
+
+private:
+  // Padded to a cache line each, so that the two threads don't keep taking the line from each
+  // other. Padding instead of alignas, since C++14 doesn't align over-aligned types on the heap.
+  struct padded_index {
+    std::atomic<size_t> Value{0};
+    char Padding[64 - sizeof(std::atomic<size_t>)];
+  };
+  std::vector<value_type> Items;
+  padded_index ReadIndex;
+  padded_index WriteIndex;
+};
+
+} // namespace storecast
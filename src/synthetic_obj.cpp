@@ -0,0 +1,268 @@
+#include "synthetic_obj.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+
+namespace storecast
+{
+using std::string;
+
+namespace {
+const f64 Pi = 3.14159265358979323846;
+const size_t FlushSize = 4 << 20;
+
+// SplitMix64: tiny, fast, and the same sequence everywhere, unlike the std distributions.
+struct random_generator {
+  u64 State;
+
+  u64 next()
+  {
+    u64 Z = (State += 0x9E3779B97F4A7C15ull);
+    Z = (Z ^ (Z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    Z = (Z ^ (Z >> 27)) * 0x94D049BB133111EBull;
+    return Z ^ (Z >> 31);
+  }
+  // Uniform in [0, 1).
+  f64 next_unit() { return static_cast<f64>(next() >> 11) * (1.0 / 9007199254740992.0); }
+  // Uniform in [-1, 1).
+  f64 next_signed() { return 2.0 * next_unit() - 1.0; }
+};
+
+struct obj_writer {
+  std::ostream& Out;
+  string Buffer;
+  u64 NumBytes = 0;
+
+  explicit obj_writer(std::ostream& Out) : Out(Out) { Buffer.reserve(FlushSize + 256); }
+
+  void flush()
+  {
+    Out.write(Buffer.data(), static_cast<std::streamsize>(Buffer.size()));
+    NumBytes += Buffer.size();
+    Buffer.clear();
+  }
+  void end_line()
+  {
+    Buffer.push_back('\n');
+    if (Buffer.size() >= FlushSize) {
+      flush();
+    }
+  }
+
+  void write_u64(u64 Value)
+  {
+    char Digits[20];
+    i32 NumDigits = 0;
+    do {
+      Digits[NumDigits++] = static_cast<char>('0' + Value % 10);
+      Value /= 10;
+    } while (Value != 0);
+    while (NumDigits > 0) {
+      Buffer.push_back(Digits[--NumDigits]);
+    }
+  }
+  // Six decimals, like %.6f, without going through the locale.
+  void write_f64(f64 Value)
+  {
+    auto Scaled = static_cast<u64>(std::floor(std::fabs(Value) * 1e6 + 0.5));
+    if (Value < 0 && Scaled != 0) {
+      Buffer.push_back('-');
+    }
+    write_u64(Scaled / 1000000);
+    Buffer.push_back('.');
+    auto Fraction = Scaled % 1000000;
+    for (u64 Divisor = 100000; Divisor > 0; Divisor /= 10) {
+      Buffer.push_back(static_cast<char>('0' + Fraction / Divisor % 10));
+    }
+  }
+  void write_element(const char* Keyword, const f64* Values, i32 NumValues)
+  {
+    Buffer.append(Keyword);
+    for (i32 I = 0; I < NumValues; ++I) {
+      Buffer.push_back(' ');
+      write_f64(Values[I]);
+    }
+    end_line();
+  }
+  // Vertices are 0-based here. Each vertex has its own vt and vn, with the same index.
+  void write_face(const u64* Vertices, i32 NumVertices, obj_face_format Format)
+  {
+    Buffer.push_back('f');
+    for (i32 I = 0; I < NumVertices; ++I) {
+      Buffer.push_back(' ');
+      write_u64(Vertices[I] + 1);
+      if (Format == obj_face_format::V_VT || Format == obj_face_format::V_VT_VN) {
+        Buffer.push_back('/');
+        write_u64(Vertices[I] + 1);
+      }
+      if (Format == obj_face_format::V_VN) {
+        Buffer.push_back('/');
+      }
+      if (Format == obj_face_format::V_VN || Format == obj_face_format::V_VT_VN) {
+        Buffer.push_back('/');
+        write_u64(Vertices[I] + 1);
+      }
+    }
+    end_line();
+  }
+};
+
+void write_random_mesh(obj_writer& Writer, const synthetic_obj_options& Options, bool HasVt,
+    bool HasVn)
+{
+  random_generator Random = {Options.Seed};
+  u64 NumVertices = std::max<u64>(Options.VerticesPerFace, Options.NumFaces / 2);
+  for (u64 I = 0; I < NumVertices; ++I) {
+    f64 Position[3] = {Random.next_signed(), Random.next_signed(), Random.next_signed()};
+    Writer.write_element("v", Position, 3);
+  }
+  for (u64 I = 0; I < NumVertices && HasVt; ++I) {
+    f64 TextureCoords[2] = {Random.next_unit(), Random.next_unit()};
+    Writer.write_element("vt", TextureCoords, 2);
+  }
+  for (u64 I = 0; I < NumVertices && HasVn; ++I) {
+    f64 Normal[3] = {Random.next_signed(), Random.next_signed(), Random.next_signed()};
+    f64 Length = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+    for3(Axis) {
+      Normal[Axis] = Length > 0.0 ? Normal[Axis] / Length : (Axis == 2 ? 1.0 : 0.0);
+    }
+    Writer.write_element("vn", Normal, 3);
+  }
+  u64 Face[4];
+  for (u64 F = 0; F < Options.NumFaces; ++F) {
+    for (i32 I = 0; I < Options.VerticesPerFace; ++I) {
+      Face[I] = Random.next() % NumVertices;
+    }
+    Writer.write_face(Face, Options.VerticesPerFace, Options.FaceFormat);
+  }
+}
+
+// Rows x Columns cells, with one quad or two triangles each, and as many faces as asked for.
+void write_grid_mesh(obj_writer& Writer, const synthetic_obj_options& Options, bool HasVt,
+    bool HasVn)
+{
+  u64 FacesPerCell = Options.VerticesPerFace == 4 ? 1 : 2;
+  u64 NumCells = std::max<u64>(1, (Options.NumFaces + FacesPerCell - 1) / FacesPerCell);
+  auto Columns = std::max<u64>(1, static_cast<u64>(std::ceil(std::sqrt(
+      static_cast<f64>(NumCells)))));
+  u64 Rows = (NumCells + Columns - 1) / Columns;
+  bool IsSphere = Options.Topology == synthetic_topology::SPHERE;
+  random_generator Random = {Options.Seed};
+
+  auto for_each_vertex = [&](auto Function) {
+    for (u64 Row = 0; Row <= Rows; ++Row) {
+      for (u64 Column = 0; Column <= Columns; ++Column) {
+        Function(static_cast<f64>(Column) / static_cast<f64>(Columns),
+            static_cast<f64>(Row) / static_cast<f64>(Rows));
+      }
+    }
+  };
+  for_each_vertex([&](f64 U, f64 V) {
+    if (IsSphere) {
+      f64 Theta = 2.0 * Pi * U;
+      f64 Phi = Pi * V;
+      f64 Position[3] = {std::sin(Phi) * std::cos(Theta), std::cos(Phi),
+          std::sin(Phi) * std::sin(Theta)};
+      Writer.write_element("v", Position, 3);
+    } else {
+      f64 Position[3] = {U, V, 0.001 * Random.next_signed()};
+      Writer.write_element("v", Position, 3);
+    }
+  });
+  if (HasVt) {
+    for_each_vertex([&](f64 U, f64 V) {
+      f64 TextureCoords[2] = {U, V};
+      Writer.write_element("vt", TextureCoords, 2);
+    });
+  }
+  if (HasVn) {
+    for_each_vertex([&](f64 U, f64 V) {
+      f64 Theta = 2.0 * Pi * U;
+      f64 Phi = Pi * V;
+      f64 Normal[3] = {0.0, 0.0, 1.0};
+      if (IsSphere) {
+        Normal[0] = std::sin(Phi) * std::cos(Theta);
+        Normal[1] = std::cos(Phi);
+        Normal[2] = std::sin(Phi) * std::sin(Theta);
+      }
+      Writer.write_element("vn", Normal, 3);
+    });
+  }
+
+  // The last row may only be partly filled.
+  u64 NumFaces = 0;
+  for (u64 Row = 0; Row < Rows; ++Row) {
+    for (u64 Column = 0; Column < Columns; ++Column) {
+      u64 A = Row * (Columns + 1) + Column;
+      u64 Quad[4] = {A, A + 1, A + Columns + 2, A + Columns + 1};
+      u64 Triangles[2][3] = {{Quad[0], Quad[1], Quad[2]}, {Quad[0], Quad[2], Quad[3]}};
+      for (u64 I = 0; I < FacesPerCell; ++I) {
+        if (NumFaces++ == Options.NumFaces) {
+          return;
+        }
+        if (FacesPerCell == 1) {
+          Writer.write_face(Quad, 4, Options.FaceFormat);
+        } else {
+          Writer.write_face(Triangles[I], 3, Options.FaceFormat);
+        }
+      }
+    }
+  }
+}
+} // anonymous namespace
+
+u64 write_synthetic_obj(std::ostream& Out, const synthetic_obj_options& Options)
+{
+  obj_writer Writer(Out);
+  auto Format = Options.FaceFormat;
+  bool HasVt = Format == obj_face_format::V_VT || Format == obj_face_format::V_VT_VN;
+  bool HasVn = Format == obj_face_format::V_VN || Format == obj_face_format::V_VT_VN;
+  Writer.Buffer.append("# storecast synthetic ");
+  Writer.Buffer.append(get_name(Options.Topology));
+  Writer.Buffer.append(", ");
+  Writer.write_u64(Options.NumFaces);
+  Writer.Buffer.append(Options.VerticesPerFace == 4 ? " quads, " : " triangles, ");
+  Writer.Buffer.append(get_name(Format));
+  Writer.end_line();
+  if (Options.Topology == synthetic_topology::RANDOM) {
+    write_random_mesh(Writer, Options, HasVt, HasVn);
+  } else {
+    write_grid_mesh(Writer, Options, HasVt, HasVn);
+  }
+  Writer.flush();
+  return Writer.NumBytes;
+}
+
+bool write_synthetic_obj_file(const string& Filename, const synthetic_obj_options& Options)
+{
+  std::ofstream Out(Filename, std::ios::binary | std::ios::trunc);
+  if (!Out) {
+    return false;
+  }
+  write_synthetic_obj(Out, Options);
+  Out.close();
+  return !Out.fail();
+}
+
+const char* get_name(synthetic_topology Topology)
+{
+  switch (Topology) {
+  case synthetic_topology::GRID: return "grid";
+  case synthetic_topology::SPHERE: return "sphere";
+  default: return "random";
+  }
+}
+
+const char* get_name(obj_face_format Format)
+{
+  switch (Format) {
+  case obj_face_format::V: return "v";
+  case obj_face_format::V_VT: return "v/vt";
+  case obj_face_format::V_VN: return "v//vn";
+  default: return "v/vt/vn";
+  }
+}
+
+} // namespace storecast
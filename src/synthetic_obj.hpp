@@ -0,0 +1,44 @@
+#pragma once
+#include "defines.hpp"
+#include <ostream>
+#include <string>
+
+namespace storecast
+{
+
+// OBJ files of any size for benchmarks, generated on the fly. The output only depends on the
+// options, so runs on different days or machines parse the same text.
+
+enum class synthetic_topology {
+  // A slightly bumpy plane, with neighboring faces next to each other in the file.
+  GRID,
+  // The grid wrapped around a sphere, with a UV seam and degenerate faces at the poles.
+  SPHERE,
+  // Random positions, and faces between random vertices, so the indices have no locality.
+  RANDOM,
+};
+
+// Which indices the face vertices have: f 1 2 3, f 1/1 2/2 3/3, f 1//1 2//2 3//3 or
+// f 1/1/1 2/2/2 3/3/3. The file only has vt and vn lines if the faces use them.
+enum class obj_face_format { V, V_VT, V_VN, V_VT_VN };
+
+struct synthetic_obj_options {
+  synthetic_topology Topology = synthetic_topology::GRID;
+  obj_face_format FaceFormat = obj_face_format::V_VT_VN;
+  u64 NumFaces = 1000;
+  // 3 for triangles, 4 for quads.
+  i32 VerticesPerFace = 4;
+  u64 Seed = 1;
+};
+
+// Writes the file a few MB at a time, so that memory use doesn't depend on NumFaces. Returns the
+// number of bytes written.
+u64 write_synthetic_obj(std::ostream& Out, const synthetic_obj_options& Options);
+// Returns false if the file can't be written.
+bool write_synthetic_obj_file(const std::string& Filename, const synthetic_obj_options& Options);
+
+const char* get_name(synthetic_topology Topology);
+// The format as it appears in the file, e.g. "v/vt/vn" or "v//vn".
+const char* get_name(obj_face_format Format);
+
+} // namespace storecast
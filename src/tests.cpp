@@ -5,13 +5,41 @@
 #include <istream>
 #include <fstream>
 #include <functional>
+#include <algorithm>
 #include <sstream>
 #include <vector>
+#include <array>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <cfloat>
+#include <atomic>
+#include <thread>
+#include <new>
 
 #include "defines.hpp"
 #include "math.hpp"
 #include "obj_import.hpp"
 #include "mesh.hpp"
+#include "parse_number.hpp"
+#include "mapped_file.hpp"
+#include "mesh_cache.hpp"
+#include "triangulate.hpp"
+#include "mesh_optimize.hpp"
+#include "mesh_quantize.hpp"
+#include "mesh_soa.hpp"
+#include "meshlet.hpp"
+#include "simplify.hpp"
+#include "mesh_codec.hpp"
+#include "synthetic_obj.hpp"
+#include "import_stats.hpp"
+#include "memory_arena.hpp"
+#include "thread_pool.hpp"
+#include "batch_import.hpp"
+#include "pipelined_reader.hpp"
+#include "spsc_queue.hpp"
+#include "parallel.hpp"
+#include "bvh.hpp"
 
 namespace storecast
 {
@@ -260,7 +288,7 @@ bool test_parse_cube_faces()
   ifstream File(CubeFilePath);
   obj_file_data Data = parse_obj(File);
   ASSERT_EQ(Data.f.size(), 12);
-  for(auto& f: Data.f) {
+  for(auto f: Data.f) {
     ASSERT_EQ(f.HasVt, true);
     ASSERT_EQ(f.HasVn, true);
     ASSERT_EQ(f.NumVertices, 3);
@@ -297,7 +325,7 @@ bool test_parse_ducky_faces()
   ifstream File(DuckyFilePath);
   obj_file_data Data = parse_obj(File);
   ASSERT_EQ(Data.f.size(), 7064);
-  for(auto& f: Data.f) {
+  for(auto f: Data.f) {
     ASSERT_EQ(f.HasVt, true);
     ASSERT_EQ(f.HasVn, false);
     ASSERT_EQ(f.NumVertices, 4);
@@ -316,7 +344,7 @@ bool test_parse_faces_with_only_vertices()
   stringstream File(Contents);
   obj_file_data Data = parse_obj(File);
   ASSERT_EQ(Data.f.size(), 4);
-  for(auto& f: Data.f) {
+  for(auto f: Data.f) {
     ASSERT_EQ(f.HasVt, false);
     ASSERT_EQ(f.HasVn, false);
     ASSERT_EQ(f.NumVertices, 3);
@@ -335,7 +363,7 @@ bool test_parse_faces_with_vertices_and_tex_coords()
   stringstream File(Contents);
   obj_file_data Data = parse_obj(File);
   ASSERT_EQ(Data.f.size(), 4);
-  for(auto& f: Data.f) {
+  for(auto f: Data.f) {
     ASSERT_EQ(f.HasVt, true);
     ASSERT_EQ(f.HasVn, false);
     ASSERT_EQ(f.NumVertices, 3);
@@ -354,7 +382,7 @@ bool test_parse_faces_with_vertices_and_normals()
   stringstream File(Contents);
   obj_file_data Data = parse_obj(File);
   ASSERT_EQ(Data.f.size(), 4);
-  for(auto& f: Data.f) {
+  for(auto f: Data.f) {
     ASSERT_EQ(f.HasVt, false);
     ASSERT_EQ(f.HasVn, true);
     ASSERT_EQ(f.NumVertices, 3);
@@ -363,6 +391,1746 @@ bool test_parse_faces_with_vertices_and_normals()
   return true;
 }
 
+bool test_parse_cube_file_in_place()
+{
+  obj_file_data Data = parse_obj_file(CubeFilePath);
+  ASSERT_EQ(Data.v.size(), 8);
+  ASSERT_EQ(Data.vt.size(), 4);
+  ASSERT_EQ(Data.vn.size(), 6);
+  ASSERT_EQ(Data.f.size(), 12);
+  ASSERT_EQ(Data.vt[3].Z, 1.f);
+  ASSERT_EQ(Data.f[8].Indices.size(), 9);
+  ASSERT_EQ(Data.f[8].Indices[1], 1);
+  ASSERT_EQ(Data.f[8].Indices[5], 5);
+  return true;
+}
+
+bool test_parse_faces_from_buffer()
+{
+  // No trailing newline, and the buffer ends in the middle of the string.
+  string Contents =
+      "f 1//1 2//2 3//4\n"
+      "f 4//1 5//2 6//7 8//1 9//1\n"
+      "f 7//1 8//2 9//7 10//3\r\n"
+      "f 7//1 8//2 9//7 IGNORED";
+  obj_file_data Data = parse_obj(Contents.data(), Contents.size() - 8);
+  ASSERT_EQ(Data.f.size(), 4);
+  ASSERT_EQ(Data.f[1].NumVertices, 5);
+  ASSERT_EQ(Data.f[2].NumVertices, 4);
+  ASSERT_EQ(Data.f[2].Indices[7], 3);
+  ASSERT_EQ(Data.f[3].HasVt, false);
+  ASSERT_EQ(Data.f[3].HasVn, true);
+  ASSERT_EQ(Data.f[3].Indices.size(), 6);
+  return true;
+}
+
+bool test_parse_ducky_file_in_place_matches_stream()
+{
+  ifstream File(DuckyFilePath);
+  obj_file_data Expected = parse_obj(File);
+  obj_file_data Data = parse_obj_file(DuckyFilePath);
+  ASSERT_EQ(Data.v.size(), Expected.v.size());
+  ASSERT_EQ(Data.vt.size(), Expected.vt.size());
+  ASSERT_EQ(Data.vn.size(), Expected.vn.size());
+  ASSERT_EQ(Data.f.size(), Expected.f.size());
+  ASSERT_EQ(memcmp(Data.v.data(), Expected.v.data(), sizeof(vec3)*Data.v.size()), 0);
+  ASSERT_EQ(memcmp(Data.vt.data(), Expected.vt.data(), sizeof(vec3)*Data.vt.size()), 0);
+  for (size_t I = 0; I < Data.f.size(); ++I) {
+    ASSERT_EQ(Data.f[I].NumVertices, Expected.f[I].NumVertices);
+    ASSERT_EQ(Data.f[I].HasVt, Expected.f[I].HasVt);
+    ASSERT_EQ(Data.f[I].HasVn, Expected.f[I].HasVn);
+    auto Indices = Data.f[I].Indices;
+    ASSERT_EQ(std::equal(Indices.begin(), Indices.end(), Expected.f[I].Indices.begin()), true);
+  }
+  return true;
+}
+
+bool test_parse_relative_face_indices()
+{
+  string Contents =
+      "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+      "vt 0 0\nvt 1 0\n"
+      "f -4/-2 -3/-1 -2/-1\n"
+      "f 2/1 -1/-1 3/1\n";
+  obj_file_data Data = parse_obj(Contents.data(), Contents.size());
+  ASSERT_EQ(Data.f.size(), 2);
+  ASSERT_EQ(Data.f[0].HasVt, true);
+  ASSERT_EQ(Data.f[0].Indices[0], 1);
+  ASSERT_EQ(Data.f[0].Indices[1], 1);
+  ASSERT_EQ(Data.f[0].Indices[2], 2);
+  ASSERT_EQ(Data.f[0].Indices[3], 2);
+  ASSERT_EQ(Data.f[1].Indices[2], 4);
+  ASSERT_EQ(Data.f[1].Indices[3], 2);
+  return true;
+}
+
+bool test_scan_float_matches_strtof()
+{
+  const char* Numbers[] = {
+    "0", "-0", "0.5", "-12.75", "29.564405", "1e-45", "1.17549435e-38", "3.4028235e38",
+    "3.4028236e38", "16777217", "33554435", "7.038531e-26", "1.00000005960464477539062500001",
+    "123456789012345678901234", "0.000000000000000000000000000001", ".5", "5.", "+7.25E2",
+    "1e", "0x1p3", "inf",
+  };
+  for (auto Number: Numbers) {
+    const char* At = Number;
+    auto End = Number + strlen(Number);
+    f32 Value = 0.f;
+    ASSERT_EQ(scan_float(At, End, Value), true);
+    char* ExpectedEnd;
+    f32 Expected = std::strtof(Number, &ExpectedEnd);
+    ASSERT_EQ(memcmp(&Value, &Expected, sizeof(f32)), 0);
+    ASSERT_EQ(At == ExpectedEnd, true);
+  }
+  const char* NotANumber = "/12";
+  const char* At = NotANumber;
+  f32 Value = 0.f;
+  ASSERT_EQ(scan_float(At, NotANumber + 3, Value), false);
+  ASSERT_EQ(At == NotANumber, true);
+  return true;
+}
+
+bool test_scan_int()
+{
+  const char* Text = "-1234/56789012//7 99999999999 00000000001 -000000000002147483648";
+  auto End = Text + strlen(Text);
+  i32 Value = 0;
+  ASSERT_EQ(scan_int(Text, End, Value), true);
+  ASSERT_EQ(Value, -1234);
+  ASSERT_EQ(scan_int(Text, End, Value), false);
+  ++Text;
+  ASSERT_EQ(scan_int(Text, End, Value), true);
+  ASSERT_EQ(Value, 56789012);
+  Text += 2;
+  ASSERT_EQ(scan_int(Text, End, Value), true);
+  ASSERT_EQ(Value, 7);
+  ++Text;
+  ASSERT_EQ(scan_int(Text, End, Value), true);
+  ASSERT_EQ(Value, 2147483647);
+  // Zero padding doesn't make an index overflow.
+  ++Text;
+  ASSERT_EQ(scan_int(Text, End, Value), true);
+  ASSERT_EQ(Value, 1);
+  ++Text;
+  ASSERT_EQ(scan_int(Text, End, Value), true);
+  ASSERT_EQ(Value, -2147483647);
+  return true;
+}
+
+// parse_obj used to read coordinates with operator>>. Make sure we still get the exact same bits.
+bool test_parse_ducky_floats_bit_identical()
+{
+  obj_file_data Data = parse_obj_file(DuckyFilePath);
+  ifstream File(DuckyFilePath);
+  size_t NumV = 0, NumVt = 0;
+  for (string Line; getline(File, Line); ) {
+    stringstream LineStream(Line);
+    string Keyword;
+    LineStream >> Keyword;
+    if (Keyword != "v" && Keyword != "vt") {
+      continue;
+    }
+    vec3 Expected = {0.f, 0.f, 1.f};
+    LineStream >> Expected.X >> Expected.Y >> Expected.Z;
+    auto& Values = Keyword == "v" ? Data.v : Data.vt;
+    auto& Index = Keyword == "v" ? NumV : NumVt;
+    ASSERT_EQ(Index < Values.size(), true);
+    ASSERT_EQ(memcmp(&Values[Index], &Expected, sizeof(vec3)), 0);
+    ++Index;
+  }
+  ASSERT_EQ(NumV, Data.v.size());
+  ASSERT_EQ(NumVt, Data.vt.size());
+  return true;
+}
+
+bool test_parse_obj_in_parallel_matches_serial()
+{
+  mapped_file File(DuckyFilePath);
+  ASSERT_EQ(File.Size > 0, true);
+  // Append some faces with relative indices so that they end up in different chunks.
+  string Contents(File.Data, File.Size);
+  // Also change the group and material, so that some chunks start with faces that inherit them.
+  for (i32 I = 0; I < 2000; ++I) {
+    Contents += "v 1.5 2.5 3.5\nvt 0.25 0.75\nf -1/-1 -2/-1 -3/-2 -4/-2\n";
+    if (I % 700 == 0) {
+      Contents += I % 1400 ? "g Extra\n" : "usemtl Unused\nusemtl DBill\n";
+    }
+  }
+  obj_file_data Expected = parse_obj(Contents.data(), Contents.size());
+  obj_parse_options Options;
+  Options.NumThreads = 4;
+  Options.ChunkSize = 20000;
+  obj_file_data Data = parse_obj(Contents.data(), Contents.size(), Options);
+  ASSERT_EQ(Data.v.size(), Expected.v.size());
+  ASSERT_EQ(Data.vt.size(), Expected.vt.size());
+  ASSERT_EQ(Data.vn.size(), Expected.vn.size());
+  ASSERT_EQ(Data.f.size(), Expected.f.size());
+  ASSERT_EQ(memcmp(Data.v.data(), Expected.v.data(), sizeof(vec3)*Data.v.size()), 0);
+  ASSERT_EQ(memcmp(Data.vt.data(), Expected.vt.data(), sizeof(vec3)*Data.vt.size()), 0);
+  for (size_t I = 0; I < Data.f.size(); ++I) {
+    ASSERT_EQ(Data.f[I].NumVertices, Expected.f[I].NumVertices);
+    ASSERT_EQ(Data.f[I].HasVt, Expected.f[I].HasVt);
+    ASSERT_EQ(Data.f[I].HasVn, Expected.f[I].HasVn);
+    auto Indices = Data.f[I].Indices;
+    ASSERT_EQ(std::equal(Indices.begin(), Indices.end(), Expected.f[I].Indices.begin()), true);
+  }
+  ASSERT_EQ(Data.f[Data.f.size() - 1].Indices[0], static_cast<i32>(Data.v.size()));
+  ASSERT_EQ(Data.MaterialNames == Expected.MaterialNames, true);
+  ASSERT_EQ(Data.GroupNames == Expected.GroupNames, true);
+  ASSERT_EQ(Data.FaceRuns.size(), Expected.FaceRuns.size());
+  ASSERT_EQ(memcmp(Data.FaceRuns.data(), Expected.FaceRuns.data(),
+      sizeof(obj_face_run) * Data.FaceRuns.size()), 0);
+  ASSERT_EQ(Data.MaterialNames.size(), 5);
+  ASSERT_EQ(Data.FaceRuns.back().Material, 1);
+  ASSERT_EQ(Data.FaceRuns.back().Group, 4);
+  return true;
+}
+
+bool test_face_list_layout()
+{
+  obj_face_list Faces = {
+    {3, true, true, {1,1,1, 2,2,1, 3,3,1}},
+    {4, false, true, {1,1, 2,1, 3,1, 4,1}},
+    {3, false, false, {5, 6, 7}},
+  };
+  ASSERT_EQ(Faces.size(), 3);
+  ASSERT_EQ(Faces.Indices.size(), 9 + 8 + 3);
+  ASSERT_EQ(Faces.Offsets.size(), 4);
+  ASSERT_EQ(Faces.Offsets[2], 17);
+  ASSERT_EQ(Faces[1].NumVertices, 4);
+  ASSERT_EQ(Faces[1].HasVt, false);
+  ASSERT_EQ(Faces[1].HasVn, true);
+  ASSERT_EQ(Faces[2].NumVertices, 3);
+  ASSERT_EQ(Faces[2].Indices[2], 7);
+  Faces.clear();
+  ASSERT_EQ(Faces.empty(), true);
+  ASSERT_EQ(Faces.Offsets.size(), 1);
+  return true;
+}
+
+bool test_convert_ducky_to_mesh()
+{
+  obj_file_data Obj = parse_obj_file(DuckyFilePath);
+  mesh Mesh = convert_to_mesh(Obj);
+  ASSERT_EQ(Mesh.QuadIndices.size(), 4*Obj.f.size());
+  i32 NumVerticesSeen = 0;
+  for (i32 QuadIndex = 0; QuadIndex < Obj.f.size(); ++QuadIndex) {
+    for4(I) {
+      auto MeshVertexIndex = Mesh.QuadIndices[4*QuadIndex + I];
+      // Vertices are numbered in the order of their first occurrence.
+      ASSERT_EQ(MeshVertexIndex <= NumVerticesSeen, true);
+      if (MeshVertexIndex == NumVerticesSeen) {
+        ++NumVerticesSeen;
+      }
+      auto& Vertex = Mesh.Vertices[MeshVertexIndex];
+      auto& ObjVertex = Obj.v[Obj.f[QuadIndex].Indices[2*I+0]-1];
+      auto& ObjUV = Obj.vt[Obj.f[QuadIndex].Indices[2*I+1]-1];
+      ASSERT_EQ(memcmp(&Vertex.Position, &ObjVertex, sizeof(vec3)), 0);
+      ASSERT_EQ(memcmp(&Vertex.TextureCoords, &ObjUV, sizeof(vec3)), 0);
+    }
+  }
+  ASSERT_EQ(NumVerticesSeen, Mesh.Vertices.size());
+  return true;
+}
+
+bool test_dedup_methods_match()
+{
+  obj_file_data Obj = parse_obj_file(DuckyFilePath);
+  // Some faces with large indices, so that the radix sort has to look at more than one byte
+  // per field.
+  Obj.v.resize(70000);
+  Obj.vn = CubeNormals;
+  Obj.f.push_back({3, false, true, {70000,1, 1,1, 65536,1}});
+  Obj.f.push_back({3, false, true, {65536,1, 1,1, 70000,2}});
+  obj_convert_options Options;
+  Options.DedupMethod = obj_convert_options::dedup_method::HASH;
+  mesh Hashed = convert_to_mesh(Obj, Options);
+  Options.DedupMethod = obj_convert_options::dedup_method::RADIX_SORT;
+  mesh Sorted = convert_to_mesh(Obj, Options);
+  ASSERT_EQ(Hashed.Vertices.size(), Sorted.Vertices.size());
+  ASSERT_EQ(memcmp(Hashed.Vertices.data(), Sorted.Vertices.data(),
+      Hashed.Vertices.size() * sizeof(vertex_data)), 0);
+  ASSERT_EQ(Hashed.TriangleIndices == Sorted.TriangleIndices, true);
+  ASSERT_EQ(Hashed.QuadIndices == Sorted.QuadIndices, true);
+  ASSERT_EQ(Hashed.TriangleIndices[3], Hashed.TriangleIndices[2]);
+  ASSERT_EQ(Hashed.TriangleIndices[4], Hashed.TriangleIndices[1]);
+  ASSERT_EQ(Hashed.TriangleIndices[5] == Hashed.TriangleIndices[0], false);
+  return true;
+}
+
+bool test_convert_to_mesh_in_parallel_matches_serial()
+{
+  obj_file_data Ducky = parse_obj_file(DuckyFilePath);
+  // Repeat the faces often enough to get several runs of faces, and shift every other copy to
+  // a second set of positions, so that new vertices keep showing up.
+  obj_file_data Obj = Ducky;
+  auto NumPositions = static_cast<i32>(Ducky.v.size());
+  Obj.v.insert(Obj.v.end(), Ducky.v.begin(), Ducky.v.end());
+  for (i32 Copy = 1; Copy < 12; ++Copy) {
+    for (auto f: Ducky.f) {
+      obj_face_data Face = {f.NumVertices, f.HasVt, f.HasVn, {f.Indices.begin(), f.Indices.end()}};
+      for (size_t I = 0; I < Face.Indices.size(); I += 2) {
+        Face.Indices[I] += Copy % 2 ? NumPositions : 0;
+      }
+      Obj.f.push_back(Face);
+    }
+  }
+  ASSERT_EQ(Obj.f.size() > (1 << 16), true);
+
+  mesh Expected = convert_to_mesh(Obj);
+  obj_convert_options Options;
+  Options.NumThreads = 4;
+  mesh Mesh = convert_to_mesh(Obj, Options);
+  ASSERT_EQ(Mesh.Vertices.size(), 2 * convert_to_mesh(Ducky).Vertices.size());
+  ASSERT_EQ(Mesh.Vertices.size(), Expected.Vertices.size());
+  ASSERT_EQ(memcmp(Mesh.Vertices.data(), Expected.Vertices.data(),
+      Mesh.Vertices.size() * sizeof(vertex_data)), 0);
+  ASSERT_EQ(Mesh.TriangleIndices == Expected.TriangleIndices, true);
+  ASSERT_EQ(Mesh.QuadIndices == Expected.QuadIndices, true);
+  return true;
+}
+
+bool test_stream_ducky_file_into_mesh()
+{
+  struct counting_builder : obj_mesh_builder {
+    i32 NumV = 0;
+    i32 NumFaces = 0;
+    void on_v(const vec3& Value) override { ++NumV; obj_mesh_builder::on_v(Value); }
+    void on_face(const obj_face& Face) override { ++NumFaces; obj_mesh_builder::on_face(Face); }
+  };
+  obj_file_data Obj = parse_obj_file(DuckyFilePath);
+  mesh Expected = convert_to_mesh(Obj);
+  // A tiny buffer, so that lines get split between reads and the buffer has to grow.
+  counting_builder Builder;
+  read_obj_file(DuckyFilePath, Builder, 16);
+  ASSERT_EQ(Builder.NumV, Obj.v.size());
+  ASSERT_EQ(Builder.NumFaces, Obj.f.size());
+  auto& Mesh = Builder.Mesh;
+  ASSERT_EQ(Mesh.Vertices.size(), Expected.Vertices.size());
+  ASSERT_EQ(memcmp(Mesh.Vertices.data(), Expected.Vertices.data(),
+      Mesh.Vertices.size() * sizeof(vertex_data)), 0);
+  ASSERT_EQ(Mesh.TriangleIndices == Expected.TriangleIndices, true);
+  ASSERT_EQ(Mesh.QuadIndices == Expected.QuadIndices, true);
+  return true;
+}
+
+bool test_stream_relative_face_indices()
+{
+  obj_mesh_builder Builder;
+  stringstream File("v 0 0 0\nv 1 0 0\nv 0 1 0\nf -3 -2 -1\nv 1 1 0\nf 2 4 -2");
+  read_obj(File, Builder);
+  ASSERT_EQ(Builder.Mesh.Vertices.size(), 4);
+  ASSERT_EQ(Builder.Mesh.TriangleIndices.size(), 6);
+  ASSERT_EQ(Builder.Mesh.TriangleIndices[5], 2);
+  return true;
+}
+
+bool test_mesh_cache_round_trip()
+{
+  mapped_file Source(DuckyFilePath);
+  ASSERT_EQ(Source.Succeeded, true);
+  // A missing file must not get a cache, but an empty one may.
+  {
+    mapped_file Missing("does_not_exist.obj");
+    ASSERT_EQ(Missing.Succeeded, false);
+    std::ofstream("test_empty.obj").close();
+    mapped_file Empty("test_empty.obj");
+    ASSERT_EQ(Empty.Succeeded, true);
+    ASSERT_EQ(Empty.Size, 0);
+  }
+  remove("test_empty.obj");
+  auto SourceHash = hash_bytes(Source.Data, Source.Size);
+  ASSERT_EQ(SourceHash == hash_bytes(Source.Data, Source.Size - 1), false);
+  mesh Mesh = convert_to_mesh(parse_obj(Source.Data, Source.Size));
+  auto CommandList = get_draw_command_list(Mesh);
+  const string CacheFilename = "test_mesh_cache.scmesh";
+  ASSERT_EQ(write_mesh_cache(CacheFilename, Mesh, &CommandList, SourceHash), true);
+  {
+    mapped_mesh_cache Cache(CacheFilename);
+    ASSERT_EQ(Cache.is_fresh(SourceHash), true);
+    ASSERT_EQ(Cache.is_fresh(SourceHash + 1), false);
+    ASSERT_EQ(Cache.NumDrawCommands, CommandList.size());
+    ASSERT_EQ(memcmp(Cache.DrawCommands, CommandList.data(),
+        CommandList.size() * sizeof(draw_command)), 0);
+    mesh Loaded = Cache.to_mesh();
+    ASSERT_EQ(Loaded.Vertices.size(), Mesh.Vertices.size());
+    ASSERT_EQ(memcmp(Loaded.Vertices.data(), Mesh.Vertices.data(),
+        Mesh.Vertices.size() * sizeof(vertex_data)), 0);
+    ASSERT_EQ(Loaded.TriangleIndices == Mesh.TriangleIndices, true);
+    ASSERT_EQ(Loaded.QuadIndices == Mesh.QuadIndices, true);
+    ASSERT_EQ(Loaded.QuadRanges.size(), Mesh.QuadRanges.size());
+    ASSERT_EQ(memcmp(Loaded.QuadRanges.data(), Mesh.QuadRanges.data(),
+        Mesh.QuadRanges.size() * sizeof(mesh_range)), 0);
+    ASSERT_EQ(Loaded.MaterialNames == Mesh.MaterialNames, true);
+  }
+
+  // A truncated cache is rejected.
+  {
+    std::ifstream In(CacheFilename, std::ios::binary);
+    string Contents((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
+    In.close();
+    std::ofstream Out(CacheFilename, std::ios::binary | std::ios::trunc);
+    Out.write(Contents.data(), static_cast<std::streamsize>(Contents.size() - 4));
+  }
+  {
+    mapped_mesh_cache Cache(CacheFilename);
+    ASSERT_EQ(Cache.is_valid(), false);
+    ASSERT_EQ(Cache.NumVertices, 0);
+  }
+  std::remove(CacheFilename.c_str());
+  return true;
+}
+
+bool test_ducky_draw_commands_per_material()
+{
+  obj_file_data Obj = parse_obj_file(DuckyFilePath);
+  ASSERT_EQ(Obj.MaterialNames.size(), 4);
+  ASSERT_EQ(Obj.MaterialNames[1], "DBill");
+  ASSERT_EQ(Obj.GroupNames.size(), 4);
+  ASSERT_EQ(Obj.GroupNames[3], "Eye Eye1 Pupil");
+  ASSERT_EQ(Obj.FaceRuns.size(), 4);
+  ASSERT_EQ(Obj.FaceRuns[0].FirstFace, 0);
+  ASSERT_EQ(Obj.FaceRuns[2].Material, 2);
+  ASSERT_EQ(Obj.FaceRuns[2].Group, 2);
+
+  mesh Mesh = convert_to_mesh(Obj);
+  auto CommandList = get_draw_command_list(Mesh);
+  ASSERT_EQ(CommandList.size(), 4);
+  i32 NumIndices = 0;
+  for (i32 I = 0; I < 4; ++I) {
+    ASSERT_EQ(CommandList[I].Type == draw_command::type::QUAD, true);
+    ASSERT_EQ(CommandList[I].MaterialId, I);
+    ASSERT_EQ(CommandList[I].StartIndex, NumIndices);
+    NumIndices += CommandList[I].NumIndices;
+  }
+  ASSERT_EQ(NumIndices, Mesh.QuadIndices.size());
+  ASSERT_EQ(CommandList[1].NumIndices, 4 * (Obj.FaceRuns[2].FirstFace - Obj.FaceRuns[1].FirstFace));
+  return true;
+}
+
+bool test_faces_are_grouped_by_material()
+{
+  string Contents =
+    "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+    "f 1 2 3\n"
+    "usemtl A\nf 1 2 4\nf 1 2 3 4\n"
+    "g Group\nusemtl B\nf 2 3 4\n"
+    "usemtl A\nf 3 2 1\n";
+  obj_file_data Obj = parse_obj(Contents.data(), Contents.size());
+  ASSERT_EQ(Obj.MaterialNames.size(), 2);
+  ASSERT_EQ(Obj.FaceRuns.size(), 3);
+  ASSERT_EQ(Obj.FaceRuns[1].Group, 0);
+  ASSERT_EQ(Obj.FaceRuns[2].Material, 0);
+  ASSERT_EQ(Obj.FaceRuns[2].Group, 0);
+  mesh Mesh = convert_to_mesh(Obj);
+  // The faces without material come first, then the ones with A in file order, then B.
+  const vector<i32> ExpectedIndices = {0,1,2, 0,1,3, 2,1,0, 1,2,3};
+  ASSERT_EQ(Mesh.TriangleIndices == ExpectedIndices, true);
+  auto CommandList = get_draw_command_list(Mesh);
+  ASSERT_EQ(CommandList.size(), 4);
+  ASSERT_EQ(CommandList[0].MaterialId, -1);
+  ASSERT_EQ(CommandList[1].MaterialId, 0);
+  ASSERT_EQ(CommandList[1].NumIndices, 6);
+  ASSERT_EQ(CommandList[2].MaterialId, 1);
+  ASSERT_EQ(CommandList[3].Type == draw_command::type::QUAD, true);
+  ASSERT_EQ(CommandList[3].MaterialId, 0);
+
+  obj_mesh_builder Builder;
+  stringstream File(Contents);
+  read_obj(File, Builder);
+  ASSERT_EQ(Builder.Mesh.TriangleIndices == ExpectedIndices, true);
+  ASSERT_EQ(Builder.Mesh.TriangleRanges.size(), 3);
+  ASSERT_EQ(Builder.Mesh.TriangleRanges[1].NumIndices, 6);
+  return true;
+}
+
+bool test_triangulate_polygons()
+{
+  vector<i32> Triangles;
+  // Convex quad, the diagonal from 1 to 3 is shorter.
+  const vec3 Quad[] = {{0.f, 0.f, 0.f}, {2.f, 0.f, 0.f}, {4.f, 1.f, 0.f}, {0.f, 1.f, 0.f}};
+  triangulate_polygon(Quad, 4, Triangles);
+  const vector<i32> ExpectedQuad = {1,2,3, 1,3,0};
+  ASSERT_EQ(Triangles == ExpectedQuad, true);
+  // Concave quad ("arrowhead"), only the diagonal from the reflex corner 2 is inside.
+  const vec3 Arrow[] = {{0.f, 0.f, 0.f}, {2.f, 1.f, 0.f}, {0.f, 0.2f, 0.f}, {-2.f, 1.f, 0.f}};
+  Triangles.clear();
+  triangulate_polygon(Arrow, 4, Triangles);
+  ASSERT_EQ(Triangles.size(), 6);
+  ASSERT_EQ(std::count(Triangles.begin(), Triangles.end(), 2), 2);
+  ASSERT_EQ(std::count(Triangles.begin(), Triangles.end(), 0), 2);
+  // Concave "L" in the XZ plane. No triangle may contain the reflex corner's opposite area, so
+  // the total area has to match the polygon's.
+  const vec3 L[] = {
+    {0.f, 0.f, 0.f}, {0.f, 0.f, 2.f}, {1.f, 0.f, 2.f}, {1.f, 0.f, 1.f}, {2.f, 0.f, 1.f},
+    {2.f, 0.f, 0.f},
+  };
+  Triangles.clear();
+  triangulate_polygon(L, 6, Triangles);
+  ASSERT_EQ(Triangles.size(), 12);
+  f32 Area = 0.f;
+  for (size_t I = 0; I < Triangles.size(); I += 3) {
+    auto Normal = cross(L[Triangles[I+1]] - L[Triangles[I]], L[Triangles[I+2]] - L[Triangles[I]]);
+    // Same winding as the polygon.
+    ASSERT_EQ(Normal.Y > 0.f, true);
+    Area += 0.5f * std::sqrt(length_squared(Normal));
+  }
+  ASSERT_EQ(std::fabs(Area - 3.f) < 1e-5f, true);
+  return true;
+}
+
+bool test_convert_to_mesh_with_triangulation()
+{
+  string Contents =
+    "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv -1 0.5 0\n"
+    "f 1 2 3 4\nf 1 2 3\nf 1 2 3 4 5\n";
+  obj_file_data Obj = parse_obj(Contents.data(), Contents.size());
+  ASSERT_EQ(Obj.f.size(), 3);
+  mesh Mesh = convert_to_mesh(Obj);
+  ASSERT_EQ(Mesh.TriangleIndices.size(), 3);
+  ASSERT_EQ(Mesh.QuadIndices.size(), 4);
+
+  obj_convert_options Options;
+  Options.Triangulate = true;
+  Mesh = convert_to_mesh(Obj, Options);
+  ASSERT_EQ(Mesh.QuadIndices.size(), 0);
+  ASSERT_EQ(Mesh.TriangleIndices.size(), 6 + 3 + 9);
+  ASSERT_EQ(Mesh.Vertices.size(), 5);
+  auto CommandList = get_draw_command_list(Mesh);
+  ASSERT_EQ(CommandList.size(), 1);
+  ASSERT_EQ(CommandList[0].NumIndices, 18);
+
+  obj_mesh_builder Builder(Options);
+  stringstream File(Contents);
+  read_obj(File, Builder);
+  ASSERT_EQ(Builder.Mesh.TriangleIndices == Mesh.TriangleIndices, true);
+  return true;
+}
+
+bool test_optimize_vertex_cache()
+{
+  vertex_cache_stats Stats = measure_vertex_cache({0, 1, 2, 2, 1, 3, 4, 0, 1}, 3);
+  // 0 1 2 and 3 miss; by then 0 is evicted, so 4, 0 and 1 all miss.
+  ASSERT_EQ(Stats.ACMR == 7.f / 3.f, true);
+  ASSERT_EQ(Stats.ATVR == 7.f / 5.f, true);
+
+  obj_convert_options Options;
+  Options.Triangulate = true;
+  mesh Mesh = convert_to_mesh(parse_obj_file(DuckyFilePath), Options);
+  mesh Original = Mesh;
+  vertex_cache_report Report = optimize_vertex_cache(Mesh, 16);
+  ASSERT_EQ(Report.Before.ACMR == measure_vertex_cache(Original.TriangleIndices, 16).ACMR, true);
+  ASSERT_EQ(Report.After.ACMR < Report.Before.ACMR, true);
+  ASSERT_EQ(Report.After.ATVR < Report.Before.ATVR, true);
+  ASSERT_EQ(Report.After.ACMR < 0.8f, true);
+
+  // Same triangles with the same winding, each in its original range.
+  ASSERT_EQ(Mesh.TriangleRanges.size(), Original.TriangleRanges.size());
+  auto get_triangles = [](const mesh& M, const mesh_range& Range) {
+    vector<std::array<i32, 3>> Triangles;
+    for (i32 I = Range.StartIndex; I < Range.StartIndex + Range.NumIndices; I += 3) {
+      auto* Triangle = &M.TriangleIndices[I];
+      Triangles.push_back({Triangle[0], Triangle[1], Triangle[2]});
+    }
+    std::sort(Triangles.begin(), Triangles.end());
+    return Triangles;
+  };
+  for (auto& Range: Original.TriangleRanges) {
+    ASSERT_EQ(get_triangles(Mesh, Range) == get_triangles(Original, Range), true);
+  }
+  return true;
+}
+
+bool test_optimize_vertex_fetch()
+{
+  obj_convert_options Options;
+  Options.Triangulate = true;
+  mesh Mesh = convert_to_mesh(parse_obj_file(DuckyFilePath), Options);
+  optimize_vertex_cache(Mesh);
+  // An extra vertex that no face uses.
+  Mesh.Vertices.push_back(Mesh.Vertices[0]);
+  mesh Original = Mesh;
+  vertex_fetch_report Report = optimize_vertex_fetch(Mesh);
+  ASSERT_EQ(Report.NumUnusedVertices, 1);
+  ASSERT_EQ(Mesh.Vertices.size() + 1, Original.Vertices.size());
+  ASSERT_EQ(Report.After.Overfetch < Report.Before.Overfetch, true);
+  ASSERT_EQ(Report.After.Overfetch < 1.5f, true);
+
+  // The faces still reference the same vertex data, and vertices are numbered in first-use order.
+  ASSERT_EQ(Mesh.TriangleIndices.size(), Original.TriangleIndices.size());
+  i32 NumVerticesSeen = 0;
+  for (size_t I = 0; I < Mesh.TriangleIndices.size(); ++I) {
+    auto VertexIndex = Mesh.TriangleIndices[I];
+    ASSERT_EQ(VertexIndex <= NumVerticesSeen, true);
+    if (VertexIndex == NumVerticesSeen) {
+      ++NumVerticesSeen;
+    }
+    auto& Vertex = Mesh.Vertices[VertexIndex];
+    auto& OriginalVertex = Original.Vertices[Original.TriangleIndices[I]];
+    ASSERT_EQ(memcmp(&Vertex, &OriginalVertex, sizeof(vertex_data)), 0);
+  }
+  ASSERT_EQ(NumVerticesSeen, Mesh.Vertices.size());
+  return true;
+}
+
+bool test_half_conversion()
+{
+  ASSERT_EQ(f32_to_half(1.f), 0x3c00);
+  ASSERT_EQ(f32_to_half(-2.f), 0xc000);
+  ASSERT_EQ(f32_to_half(65504.f), 0x7bff);
+  ASSERT_EQ(f32_to_half(70000.f), 0x7c00);
+  ASSERT_EQ(f32_to_half(5.9604645e-8f), 0x0001);
+  ASSERT_EQ(f32_to_half(1e-8f), 0x0000);
+  // 1 + 2^-11 is halfway between two halfs, and rounds to the even one.
+  ASSERT_EQ(f32_to_half(1.00048828125f), 0x3c00);
+  for (u32 Half = 0; Half < 0x7c00; ++Half) {
+    ASSERT_EQ(f32_to_half(half_to_f32(static_cast<u16>(Half))), Half);
+    ASSERT_EQ(f32_to_half(half_to_f32(static_cast<u16>(Half | 0x8000))), (Half | 0x8000));
+  }
+  return true;
+}
+
+bool test_quantize_mesh()
+{
+  mesh Mesh = convert_to_mesh(parse_obj_file(DuckyFilePath));
+  // The ducky has no normals; point them away from the origin instead.
+  for (auto& Vertex: Mesh.Vertices) {
+    Vertex.Normal = Vertex.Position * (1.f / std::sqrt(length_squared(Vertex.Position)));
+  }
+  size_t MeshSize = Mesh.Vertices.size() * sizeof(vertex_data)
+      + (Mesh.TriangleIndices.size() + Mesh.QuadIndices.size()) * sizeof(i32);
+
+  quantized_mesh Quantized = quantize_mesh(Mesh);
+  ASSERT_EQ(Quantized.VertexStride, 20);
+  ASSERT_EQ(Quantized.IndexSize, 2);
+  ASSERT_EQ(Quantized.get_num_vertices(), Mesh.Vertices.size());
+  ASSERT_EQ(2 * Quantized.get_size_in_bytes() < MeshSize + MeshSize / 10, true);
+  quantization_error Error = measure_quantization_error(Mesh, Quantized);
+  ASSERT_EQ(Error.MaxPositionError == 0.f, true);
+  ASSERT_EQ(Error.MaxNormalErrorDegrees < 0.01f, true);
+  ASSERT_EQ(Error.MaxUvError < 1e-3f, true);
+  for (size_t I = 0; I < Mesh.QuadIndices.size(); ++I) {
+    ASSERT_EQ(get_quad_index(Quantized, I), Mesh.QuadIndices[I]);
+  }
+
+  quantize_options Options;
+  Options.QuantizePositions = true;
+  Options.UvFormat = uv_format::UNORM16;
+  Quantized = quantize_mesh(Mesh, Options);
+  ASSERT_EQ(Quantized.VertexStride, 16);
+  ASSERT_EQ(2 * Quantized.get_size_in_bytes() < MeshSize, true);
+  Error = measure_quantization_error(Mesh, Quantized);
+  // Half a step along each axis of the bounding box.
+  vec3 Step = Quantized.PositionScale;
+  ASSERT_EQ(Error.MaxPositionError <= 0.5f * std::sqrt(length_squared(Step)) * 1.01f, true);
+  ASSERT_EQ(Error.MaxUvError <= 0.5f * std::max(Quantized.UvScale[0], Quantized.UvScale[1]) * 1.01f,
+      true);
+  return true;
+}
+
+bool test_soa_mesh_kernels_match_scalar()
+{
+  mesh Mesh = convert_to_mesh(parse_obj_file(DuckyFilePath));
+  ASSERT_EQ(Mesh.Vertices.size() % SoaPadding != 0, true);
+  for (auto& Vertex: Mesh.Vertices) {
+    Vertex.Normal = Vertex.Position * 3.f;
+  }
+  Mesh.Vertices[1].Normal = {0.f, 0.f, 0.f};
+  soa_mesh Soa(Mesh);
+  ASSERT_EQ(Soa.Positions.X.size() % SoaPadding, 0);
+  ASSERT_EQ(reinterpret_cast<size_t>(Soa.Normals.Y.data()) % 32, 0);
+  mesh RoundTrip = Soa.to_mesh();
+  ASSERT_EQ(RoundTrip.Vertices.size(), Mesh.Vertices.size());
+  ASSERT_EQ(memcmp(RoundTrip.Vertices.data(), Mesh.Vertices.data(),
+      Mesh.Vertices.size() * sizeof(vertex_data)), 0);
+  ASSERT_EQ(RoundTrip.QuadIndices == Mesh.QuadIndices, true);
+
+  aabb ExpectedBox = compute_aabb(Soa, simd_level::SCALAR);
+  for (auto& Vertex: Mesh.Vertices) {
+    for3(I) {
+      ASSERT_EQ(Vertex.Position.Data[I] >= ExpectedBox.Min.Data[I], true);
+      ASSERT_EQ(Vertex.Position.Data[I] <= ExpectedBox.Max.Data[I], true);
+    }
+  }
+  bounding_sphere ExpectedSphere = compute_bounding_sphere(Soa, simd_level::SCALAR);
+  mat4 Transform = {{
+    {0.f, -2.f, 0.f, 1.f},
+    {1.5f, 0.f, 0.25f, -3.f},
+    {0.f, 0.5f, 1.f, 0.f},
+    {0.01f, 0.f, 0.f, 1.f},
+  }};
+  soa_mesh ExpectedSoa = Soa;
+  transform_positions(ExpectedSoa, Transform, simd_level::SCALAR);
+  renormalize_normals(ExpectedSoa, simd_level::SCALAR);
+  ASSERT_EQ(ExpectedSoa.Normals.X[1] == 0.f, true);
+  ASSERT_EQ(std::fabs(length_squared(ExpectedSoa.to_mesh().Vertices[0].Normal) - 1.f) < 1e-6f,
+      true);
+
+  for (auto Level: {simd_level::SSE2, simd_level::AVX2}) {
+    if (Level > get_simd_level()) {
+      continue;
+    }
+    aabb Box = compute_aabb(Soa, Level);
+    ASSERT_EQ(memcmp(&Box, &ExpectedBox, sizeof(aabb)), 0);
+    bounding_sphere Sphere = compute_bounding_sphere(Soa, Level);
+    ASSERT_EQ(memcmp(&Sphere, &ExpectedSphere, sizeof(bounding_sphere)), 0);
+    soa_mesh Result = Soa;
+    transform_positions(Result, Transform, Level);
+    renormalize_normals(Result, Level);
+    for (aligned_f32_array soa_vec3::*Stream: {&soa_vec3::X, &soa_vec3::Y, &soa_vec3::Z}) {
+      ASSERT_EQ(Result.Positions.*Stream == ExpectedSoa.Positions.*Stream, true);
+      ASSERT_EQ(Result.Normals.*Stream == ExpectedSoa.Normals.*Stream, true);
+    }
+  }
+
+  for (auto Level: {simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2}) {
+    if (Level > get_simd_level()) {
+      continue;
+    }
+    ASSERT_EQ(validate_indices(Soa, Level), true);
+    vector<i32> Indices(Mesh.QuadIndices.begin(), Mesh.QuadIndices.begin() + 21);
+    for (auto Invalid: {-1, static_cast<i32>(Mesh.Vertices.size())}) {
+      // One invalid index in the vector part, and one in the scalar tail.
+      for (auto Position: {size_t(5), size_t(20)}) {
+        auto Copy = Indices;
+        Copy[Position] = Invalid;
+        ASSERT_EQ(validate_indices(Copy.data(), Copy.size(), Mesh.Vertices.size(), Level), false);
+      }
+    }
+    ASSERT_EQ(validate_indices(Indices.data(), Indices.size(), 0, Level), false);
+  }
+  return true;
+}
+
+bool test_build_meshlets()
+{
+  obj_convert_options Options;
+  Options.Triangulate = true;
+  mesh Mesh = convert_to_mesh(parse_obj_file(DuckyFilePath), Options);
+  optimize_vertex_cache(Mesh);
+  mesh Original = Mesh;
+  meshlet_list Meshlets = build_meshlets(Mesh);
+  ASSERT_EQ(Meshlets.LocalIndices.size(), Mesh.TriangleIndices.size());
+  // UV seams split the ducky into many pieces, but most meshlets should still be well filled.
+  ASSERT_EQ(Meshlets.Meshlets.size() * 40 < Mesh.TriangleIndices.size() / 3, true);
+
+  i32 NextIndex = 0;
+  for (auto& Meshlet: Meshlets.Meshlets) {
+    ASSERT_EQ(Meshlet.StartIndex, NextIndex);
+    NextIndex += Meshlet.NumIndices;
+    ASSERT_EQ(Meshlet.NumVertices <= 64, true);
+    ASSERT_EQ(Meshlet.NumIndices <= 3 * 124, true);
+    for (i32 I = Meshlet.StartIndex; I < Meshlet.StartIndex + Meshlet.NumIndices; ++I) {
+      auto Local = Meshlets.LocalIndices[I];
+      ASSERT_EQ(Local < Meshlet.NumVertices, true);
+      auto Vertex = Meshlets.Vertices[Meshlet.FirstVertex + Local];
+      ASSERT_EQ(Vertex, Mesh.TriangleIndices[I]);
+      auto& Position = Mesh.Vertices[Vertex].Position;
+      ASSERT_EQ(length_squared(Position - Meshlet.Center)
+          <= Meshlet.Radius * Meshlet.Radius * 1.0001f, true);
+    }
+  }
+  ASSERT_EQ(NextIndex, Mesh.TriangleIndices.size());
+
+  // The same triangles, each in its original range.
+  auto get_triangles = [](const mesh& M, const mesh_range& Range) {
+    vector<std::array<i32, 3>> Triangles;
+    for (i32 I = Range.StartIndex; I < Range.StartIndex + Range.NumIndices; I += 3) {
+      auto* Triangle = &M.TriangleIndices[I];
+      Triangles.push_back({Triangle[0], Triangle[1], Triangle[2]});
+    }
+    std::sort(Triangles.begin(), Triangles.end());
+    return Triangles;
+  };
+  for (auto& Range: Original.TriangleRanges) {
+    ASSERT_EQ(get_triangles(Mesh, Range) == get_triangles(Original, Range), true);
+  }
+
+  // A backfacing meshlet has no triangle facing the camera.
+  i32 NumBackfacing = 0;
+  for (auto Camera: {vec3{0.f, 0.f, 50.f}, vec3{0.f, 0.f, -50.f}, vec3{30.f, 20.f, 0.f}}) {
+    for (auto& Meshlet: Meshlets.Meshlets) {
+      if (!is_meshlet_backfacing(Meshlet, Camera)) {
+        continue;
+      }
+      ++NumBackfacing;
+      for (i32 I = Meshlet.StartIndex; I < Meshlet.StartIndex + Meshlet.NumIndices; I += 3) {
+        auto& A = Mesh.Vertices[Mesh.TriangleIndices[I]].Position;
+        auto& B = Mesh.Vertices[Mesh.TriangleIndices[I + 1]].Position;
+        auto& C = Mesh.Vertices[Mesh.TriangleIndices[I + 2]].Position;
+        ASSERT_EQ(dot(cross(B - A, C - A), A - Camera) >= 0.f, true);
+      }
+    }
+  }
+  ASSERT_EQ(NumBackfacing > 0, true);
+
+  auto CommandList = get_draw_command_list(Mesh, Meshlets);
+  ASSERT_EQ(CommandList.size(), Meshlets.Meshlets.size());
+  ASSERT_EQ(CommandList.back().NumIndices, Meshlets.Meshlets.back().NumIndices);
+  return true;
+}
+
+bool test_build_lod_chain()
+{
+  mesh Mesh = convert_to_mesh(parse_obj_file(DuckyFilePath));
+  auto Levels = build_lod_chain(Mesh);
+  ASSERT_EQ(Levels.size(), 3);
+  size_t PreviousTriangles = Mesh.TriangleIndices.size() / 3 + 2 * Mesh.QuadIndices.size() / 4;
+  f32 PreviousError = 0.f;
+  for (auto& Level: Levels) {
+    auto& Lod = Level.Mesh;
+    ASSERT_EQ(Lod.QuadIndices.size(), 0);
+    ASSERT_EQ(Lod.TriangleIndices.size() / 3 <= PreviousTriangles, true);
+    ASSERT_EQ(Level.Error >= PreviousError, true);
+    PreviousTriangles = Lod.TriangleIndices.size() / 3;
+    PreviousError = Level.Error;
+    i32 NumRangeIndices = 0;
+    for (auto& Range: Lod.TriangleRanges) {
+      ASSERT_EQ(Range.StartIndex, NumRangeIndices);
+      NumRangeIndices += Range.NumIndices;
+    }
+    ASSERT_EQ(NumRangeIndices, Lod.TriangleIndices.size());
+    for (size_t I = 0; I < Lod.TriangleIndices.size(); I += 3) {
+      auto* Triangle = &Lod.TriangleIndices[I];
+      for3(Corner) {
+        ASSERT_EQ(Triangle[Corner] >= 0
+            && Triangle[Corner] < static_cast<i32>(Lod.Vertices.size()), true);
+      }
+      ASSERT_EQ(Triangle[0] != Triangle[1] && Triangle[1] != Triangle[2]
+          && Triangle[2] != Triangle[0], true);
+    }
+  }
+  // Seams lock a lot of the ducky, but the first levels are reachable.
+  ASSERT_EQ(PreviousTriangles < Mesh.QuadIndices.size() / 2, true);
+  ASSERT_EQ(Levels[0].Mesh.TriangleIndices.size() / 3
+      <= static_cast<size_t>(Levels[0].TargetTriangles), true);
+
+  // A flat grid simplifies without any error, and its border stays in place.
+  mesh Grid;
+  const i32 Size = 32;
+  for (i32 Y = 0; Y <= Size; ++Y) {
+    for (i32 X = 0; X <= Size; ++X) {
+      vertex_data Vertex = {};
+      Vertex.Position = {static_cast<f32>(X), static_cast<f32>(Y), 0.f};
+      Vertex.Normal = {0.f, 0.f, 1.f};
+      Grid.Vertices.push_back(Vertex);
+    }
+  }
+  for (i32 Y = 0; Y < Size; ++Y) {
+    for (i32 X = 0; X < Size; ++X) {
+      i32 Corner = Y * (Size + 1) + X;
+      Grid.QuadIndices.insert(
+          Grid.QuadIndices.end(), {Corner, Corner + 1, Corner + Size + 2, Corner + Size + 1});
+    }
+  }
+  lod_options Options;
+  Options.TriangleRatios = {0.1f};
+  Options.NumThreads = 0;
+  auto GridLevels = build_lod_chain(Grid, Options);
+  auto& Lod = GridLevels[0].Mesh;
+  ASSERT_EQ(Lod.TriangleIndices.size() / 3
+      <= static_cast<size_t>(GridLevels[0].TargetTriangles), true);
+  ASSERT_EQ(GridLevels[0].Error == 0.f, true);
+  vec3 Min = Lod.Vertices[0].Position;
+  vec3 Max = Min;
+  f32 Area = 0.f;
+  for (auto& Vertex: Lod.Vertices) {
+    for3(Axis) {
+      Min.Data[Axis] = std::min(Min.Data[Axis], Vertex.Position.Data[Axis]);
+      Max.Data[Axis] = std::max(Max.Data[Axis], Vertex.Position.Data[Axis]);
+    }
+  }
+  for (size_t I = 0; I < Lod.TriangleIndices.size(); I += 3) {
+    auto& A = Lod.Vertices[Lod.TriangleIndices[I]].Position;
+    auto& B = Lod.Vertices[Lod.TriangleIndices[I + 1]].Position;
+    auto& C = Lod.Vertices[Lod.TriangleIndices[I + 2]].Position;
+    vec3 Normal = cross(B - A, C - A);
+    ASSERT_EQ(Normal.Z > 0.f, true);
+    Area += 0.5f * Normal.Z;
+  }
+  ASSERT_EQ(Min.X == 0.f && Min.Y == 0.f && Max.X == Size && Max.Y == Size, true);
+  ASSERT_EQ(Area == Size * Size, true);
+  return true;
+}
+
+bool test_mesh_codec_round_trip()
+{
+  obj_convert_options Options;
+  Options.Triangulate = true;
+  mesh Mesh = convert_to_mesh(parse_obj_file(DuckyFilePath), Options);
+  optimize_vertex_cache(Mesh);
+  optimize_vertex_fetch(Mesh);
+  auto TriangleData = encode_triangle_indices(Mesh.TriangleIndices);
+  ASSERT_EQ(TriangleData.size() < Mesh.TriangleIndices.size(), true);
+  auto Compressed = compress_mesh(Mesh);
+  ASSERT_EQ(Compressed.size() < Mesh.Vertices.size() * sizeof(vertex_data) / 2, true);
+  for (auto Level: {simd_level::SCALAR, get_simd_level()}) {
+    mesh Decompressed;
+    ASSERT_EQ(decompress_mesh(Compressed.data(), Compressed.size(), Decompressed, Level), true);
+    ASSERT_EQ(Decompressed.Vertices.size(), Mesh.Vertices.size());
+    ASSERT_EQ(memcmp(Decompressed.Vertices.data(), Mesh.Vertices.data(),
+        Mesh.Vertices.size() * sizeof(vertex_data)), 0);
+    ASSERT_EQ(Decompressed.TriangleIndices == Mesh.TriangleIndices, true);
+    ASSERT_EQ(Decompressed.QuadIndices == Mesh.QuadIndices, true);
+    ASSERT_EQ(Decompressed.TriangleRanges.size(), Mesh.TriangleRanges.size());
+    ASSERT_EQ(Decompressed.MaterialNames == Mesh.MaterialNames, true);
+    // Cut short, it must fail instead of reading past the end.
+    ASSERT_EQ(decompress_mesh(Compressed.data(), Compressed.size() - 1, Decompressed, Level),
+        false);
+  }
+
+  // Odd vertex sizes and counts, and bytes that change all the time.
+  vector<u8> Bytes(37 * 7);
+  for (size_t I = 0; I < Bytes.size(); ++I) {
+    Bytes[I] = static_cast<u8>(I * I * 31 + (I % 3 == 0 ? 0 : I / 7));
+  }
+  auto VertexData = encode_vertex_buffer(Bytes.data(), 37, 7);
+  for (auto Level: {simd_level::SCALAR, get_simd_level()}) {
+    vector<u8> Decoded(Bytes.size());
+    ASSERT_EQ(decode_vertex_buffer(Decoded.data(), 37, 7, VertexData.data(), VertexData.size(),
+        Level), true);
+    ASSERT_EQ(Decoded == Bytes, true);
+  }
+
+  // Indices that don't follow any cache-friendly order, including negative ones.
+  vector<i32> Indices = {0, 1, 2, 2, 1, 3, 7, -5, 100000, 3, 1, 2, 2147483647, 0, 5, 4, 4, 4};
+  auto IndexData = encode_triangle_indices(Indices);
+  vector<i32> DecodedIndices(Indices.size());
+  ASSERT_EQ(decode_triangle_indices(DecodedIndices.data(), DecodedIndices.size(),
+      IndexData.data(), IndexData.size()), true);
+  ASSERT_EQ(DecodedIndices == Indices, true);
+  IndexData = encode_index_sequence(Indices);
+  ASSERT_EQ(decode_index_sequence(DecodedIndices.data(), DecodedIndices.size(),
+      IndexData.data(), IndexData.size()), true);
+  ASSERT_EQ(DecodedIndices == Indices, true);
+
+  // Streams that decode fine but don't fit the mesh must fail too.
+  mesh Triangle;
+  Triangle.Vertices.resize(3);
+  Triangle.TriangleIndices = {0, 1, 2};
+  Triangle.TriangleRanges.push_back({-1, 0, 3});
+  Compressed = compress_mesh(Triangle);
+  mesh Decompressed;
+  ASSERT_EQ(decompress_mesh(Compressed.data(), Compressed.size(), Decompressed), true);
+  // The triangle data comes right before the range: a free triangle with a new vertex, the
+  // rotations, and the codes of the other two. Making the first vertex the most recent one,
+  // before there is any, decodes to -1.
+  ASSERT_EQ(encode_triangle_indices(Triangle.TriangleIndices).size(), 3);
+  auto* TriangleCode = &Compressed[Compressed.size() - sizeof(mesh_range) - 3];
+  ASSERT_EQ(*TriangleCode, 0xF0);
+  *TriangleCode = 0xF1;
+  ASSERT_EQ(decompress_mesh(Compressed.data(), Compressed.size(), Decompressed), false);
+  Triangle.TriangleIndices = {0, 1, 3};
+  Compressed = compress_mesh(Triangle);
+  ASSERT_EQ(decompress_mesh(Compressed.data(), Compressed.size(), Decompressed), false);
+  Triangle.TriangleIndices = {0, 1, 2};
+  Triangle.TriangleRanges[0].StartIndex = 1;
+  Compressed = compress_mesh(Triangle);
+  ASSERT_EQ(decompress_mesh(Compressed.data(), Compressed.size(), Decompressed), false);
+  return true;
+}
+
+bool test_synthetic_obj()
+{
+  synthetic_obj_options Options;
+  Options.NumFaces = 50;
+  for (auto Topology :
+      {synthetic_topology::GRID, synthetic_topology::SPHERE, synthetic_topology::RANDOM}) {
+    for (auto Format: {obj_face_format::V, obj_face_format::V_VT, obj_face_format::V_VN,
+             obj_face_format::V_VT_VN}) {
+      for (auto VerticesPerFace: {3, 4}) {
+        Options.Topology = Topology;
+        Options.FaceFormat = Format;
+        Options.VerticesPerFace = VerticesPerFace;
+        stringstream File;
+        auto NumBytes = write_synthetic_obj(File, Options);
+        ASSERT_EQ(File.str().size(), NumBytes);
+        // The same options give the same file.
+        stringstream Again;
+        write_synthetic_obj(Again, Options);
+        ASSERT_EQ(Again.str() == File.str(), true);
+
+        obj_file_data Data = parse_obj(File);
+        ASSERT_EQ(Data.f.size(), 50);
+        bool HasVt = Format == obj_face_format::V_VT || Format == obj_face_format::V_VT_VN;
+        bool HasVn = Format == obj_face_format::V_VN || Format == obj_face_format::V_VT_VN;
+        ASSERT_EQ(Data.vt.size(), (HasVt ? Data.v.size() : 0));
+        ASSERT_EQ(Data.vn.size(), (HasVn ? Data.v.size() : 0));
+        for (auto Face: Data.f) {
+          ASSERT_EQ(Face.NumVertices, VerticesPerFace);
+          ASSERT_EQ(Face.HasVt, HasVt);
+          ASSERT_EQ(Face.HasVn, HasVn);
+          for (auto Index: Face.Indices) {
+            ASSERT_EQ(Index >= 1 && Index <= static_cast<i32>(Data.v.size()), true);
+          }
+        }
+        mesh Mesh = convert_to_mesh(Data);
+        ASSERT_EQ(Mesh.TriangleIndices.size() + Mesh.QuadIndices.size(), 50 * VerticesPerFace);
+      }
+    }
+  }
+  return true;
+}
+
+bool test_import_stats()
+{
+  string Contents =
+      "# A quad, a triangle that shares two of its vertices, and a pentagon\n"
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 0 0\nvt 0 0\n"
+      "f 1/1 2/1 3/1 4/1\n"
+      "f 2/1 5/1 3/1\n"
+      "f 1/1 2/1 5/1 3/1 4/1\n";
+  for (auto NumThreads: {1, 2}) {
+    import_stats Stats;
+    obj_parse_options ParseOptions;
+    ParseOptions.NumThreads = NumThreads;
+    ParseOptions.ChunkSize = 16;
+    ParseOptions.Stats = &Stats;
+    auto Data = parse_obj(Contents.data(), Contents.size(), ParseOptions);
+    if (!get_enabled_stats(&Stats)) {
+      // Built with STORECAST_NO_STATS.
+      ASSERT_EQ(Stats.Events.size(), 0);
+      ASSERT_EQ(Stats.NumBytes, 0);
+      continue;
+    }
+    ASSERT_EQ(Stats.NumBytes, Contents.size());
+    ASSERT_EQ(Stats.NumLines, 10);
+    ASSERT_EQ(Stats.NumV, 5);
+    ASSERT_EQ(Stats.NumVt, 1);
+    ASSERT_EQ(Stats.NumVn, 0);
+    ASSERT_EQ(Stats.NumFaces, 3);
+
+    obj_convert_options ConvertOptions;
+    ConvertOptions.Stats = &Stats;
+    auto Mesh = convert_to_mesh(Data, ConvertOptions);
+    ASSERT_EQ(Mesh.Vertices.size(), 5);
+    ASSERT_EQ(Stats.NumSkippedFaces, 1);
+    ASSERT_EQ(Stats.NumFaceVertices, 7);
+    ASSERT_EQ(Stats.NumMeshVertices, 5);
+    ASSERT_EQ(Stats.get_dedup_ratio() == 7.0 / 5.0, true);
+
+    // Every phase shows up, and the calls take at least as long as their phases.
+    for (auto Name: {"parse_obj", "parse_lines", "convert_to_mesh", "count_indices",
+             "build_keys", "dedup", "write_indices", "write_vertices", "group_by_material"}) {
+      auto It = std::find_if(Stats.Events.begin(), Stats.Events.end(),
+          [&](const import_event& Event) { return string(Event.Name) == Name; });
+      ASSERT_EQ(It != Stats.Events.end(), true);
+    }
+    ASSERT_EQ(Stats.get_seconds("convert_to_mesh") >= Stats.get_seconds("dedup"), true);
+    ASSERT_EQ(Stats.get_seconds("no_such_phase") == 0.0, true);
+
+    auto Trace = format_chrome_trace(Stats);
+    ASSERT_EQ(Trace.compare(0, 16, "{\"traceEvents\": "), 0);
+    ASSERT_EQ(Trace.find("\"name\": \"dedup\"") != string::npos, true);
+    ASSERT_EQ(Trace.find("\"skipped_faces\": 1") != string::npos, true);
+    ASSERT_EQ(Trace.find(",\n]") == string::npos, true);
+  }
+
+  // Phases only show up if asked for.
+  auto Mesh = convert_to_mesh(parse_obj(Contents.data(), Contents.size()));
+  ASSERT_EQ(Mesh.Vertices.size(), 5);
+  return true;
+}
+
+bool test_memory_arena()
+{
+  memory_arena Arena(1024);
+  auto First = static_cast<char*>(Arena.allocate(3, 1));
+  auto Second = static_cast<char*>(Arena.allocate(8, 8));
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(Second) % 8, 0);
+  ASSERT_EQ(Second >= First + 3, true);
+  // Larger than a block, so the arena needs more blocks. After reset, one block takes their
+  // place, and the same allocations fit into it.
+  for (i32 Round = 0; Round < 3; ++Round) {
+    Arena.reset();
+    for (i32 I = 0; I < 10; ++I) {
+      auto Memory = static_cast<char*>(Arena.allocate(1000, 16));
+      ASSERT_EQ(reinterpret_cast<uintptr_t>(Memory) % 16, 0);
+      memset(Memory, I, 1000);
+    }
+    ASSERT_EQ(Arena.get_num_bytes_used() >= 10000, true);
+    ASSERT_EQ(Arena.get_num_block_allocations(), (Round == 0 ? 5 : 6));
+  }
+
+  auto Values = arena_vector<i32>(arena_allocator<i32>(&Arena));
+  for (i32 I = 0; I < 1000; ++I) {
+    Values.push_back(I);
+  }
+  ASSERT_EQ(Values[999], 999);
+  arena_vector<i32> HeapValues(Values.begin(), Values.end());
+  ASSERT_EQ(HeapValues.get_allocator().Arena == nullptr, true);
+  ASSERT_EQ(HeapValues == Values, true);
+  return true;
+}
+
+bool test_import_with_arena()
+{
+  synthetic_obj_options Generate;
+  Generate.NumFaces = 20000;
+  stringstream Large;
+  write_synthetic_obj(Large, Generate);
+  Generate.NumFaces = 100;
+  Generate.Topology = synthetic_topology::RANDOM;
+  stringstream Small;
+  write_synthetic_obj(Small, Generate);
+  string Files[3] = {Large.str(), Small.str(), Large.str()};
+#ifndef STORECAST_COUNT_ALLOCATIONS
+  cout << "test_import_with_arena: built without STORECAST_COUNT_ALLOCATIONS, so only the arena's "
+      "blocks are checked, not the heap allocations" << endl;
+#endif
+
+  for (auto Method: {obj_convert_options::dedup_method::HASH,
+           obj_convert_options::dedup_method::RADIX_SORT}) {
+    memory_arena Arena;
+    obj_convert_options Options;
+    Options.DedupMethod = Method;
+    Options.Arena = &Arena;
+    obj_file_data Obj;
+    mesh Mesh;
+    for (i32 Round = 0; Round < 6; ++Round) {
+      auto& File = Files[Round % 3];
+      auto NumBlockAllocations = Arena.get_num_block_allocations();
+      auto NumAllocations = get_num_allocations();
+      Arena.reset();
+      parse_obj(File.data(), File.size(), Obj);
+      convert_to_mesh(Obj, Mesh, Options);
+      // The first reset merges the arena's blocks into one. From then on, everything fits into
+      // what the first round allocated, and nothing else touches the heap.
+      if (Round > 1) {
+        ASSERT_EQ(Arena.get_num_block_allocations(), NumBlockAllocations);
+        ASSERT_EQ(get_num_allocations() - NumAllocations, 0);
+      }
+
+      obj_convert_options HeapOptions;
+      HeapOptions.DedupMethod = Method;
+      auto Expected = convert_to_mesh(parse_obj(File.data(), File.size()), HeapOptions);
+      ASSERT_EQ(Mesh.Vertices.size(), Expected.Vertices.size());
+      ASSERT_EQ(memcmp(Mesh.Vertices.data(), Expected.Vertices.data(),
+          sizeof(vertex_data) * Mesh.Vertices.size()), 0);
+      ASSERT_EQ(Mesh.QuadIndices == Expected.QuadIndices, true);
+      ASSERT_EQ(Mesh.TriangleIndices == Expected.TriangleIndices, true);
+      ASSERT_EQ(Mesh.QuadRanges.size(), Expected.QuadRanges.size());
+    }
+  }
+  return true;
+}
+
+bool test_thread_pool()
+{
+  thread_pool Pool(4);
+  ASSERT_EQ(Pool.get_num_threads(), 4);
+  // Tasks that run parallel_for, which puts its tasks on the same pool and waits for them
+  // there. With more outer tasks than threads, every thread ends up waiting inside a task.
+  const i32 NumOuter = 16;
+  const i32 NumInner = 100;
+  vector<i64> Sums(NumOuter, 0);
+  vector<i32> RanOnPool(NumOuter, 0);
+  thread_pool::task_group Group;
+  for (i32 I = 0; I < NumOuter; ++I) {
+    Pool.submit(Group, [&, I] {
+      RanOnPool[I] = thread_pool::get_current() == &Pool;
+      vector<i64> Values(NumInner, 0);
+      parallel_for(NumInner, 4, [&](i32 J) { Values[J] = I * J; });
+      for (auto Value: Values) {
+        Sums[I] += Value;
+      }
+    });
+  }
+  Pool.wait(Group);
+  for (i32 I = 0; I < NumOuter; ++I) {
+    ASSERT_EQ(RanOnPool[I], 1);
+    ASSERT_EQ(Sums[I], static_cast<i64>(I) * NumInner * (NumInner - 1) / 2);
+  }
+  ASSERT_EQ(thread_pool::get_current() == nullptr, true);
+
+  // Exceptions of nested tasks reach the task that waits for them, and those of outer tasks
+  // reach wait, instead of terminating the thread they ran on.
+  std::atomic<i32> NumCaught(0);
+  for (i32 I = 0; I < NumOuter; ++I) {
+    Pool.submit(Group, [&, I] {
+      try {
+        parallel_for(NumInner, 4, [&](i32 J) {
+          if (J == I) {
+            throw std::bad_alloc();
+          }
+        });
+      } catch (const std::bad_alloc&) {
+        ++NumCaught;
+      }
+    });
+  }
+  Pool.wait(Group);
+  ASSERT_EQ(NumCaught.load(), NumOuter);
+  Pool.submit(Group, [] { throw std::bad_alloc(); });
+  bool Caught = false;
+  try {
+    Pool.wait(Group);
+  } catch (const std::bad_alloc&) {
+    Caught = true;
+  }
+  ASSERT_EQ(Caught, true);
+  Caught = false;
+  try {
+    parallel_for(NumInner, 4, [](i32 J) {
+      if (J == 50) {
+        throw std::bad_alloc();
+      }
+    });
+  } catch (const std::bad_alloc&) {
+    Caught = true;
+  }
+  ASSERT_EQ(Caught, true);
+  return true;
+}
+
+bool test_batch_import()
+{
+  auto Filenames = find_obj_files("../data");
+  ASSERT_EQ(Filenames.size() >= 2, true);
+  ASSERT_EQ(std::is_sorted(Filenames.begin(), Filenames.end()), true);
+  Filenames.push_back("../data/does_not_exist.obj");
+
+  batch_import_options Options;
+  Options.NumThreads = 3;
+  std::atomic<i32> NumMeshes(0);
+  Options.OnMesh = [&](const string&, mesh&) { ++NumMeshes; };
+  auto Results = import_obj_files(Filenames, Options);
+  ASSERT_EQ(Results.size(), Filenames.size());
+  ASSERT_EQ(NumMeshes.load(), static_cast<i32>(Filenames.size() - 1));
+  ASSERT_EQ(Results.back().Succeeded, false);
+  for (size_t I = 0; I + 1 < Results.size(); ++I) {
+    auto& Result = Results[I];
+    ASSERT_EQ(Result.Filename, Filenames[I]);
+    ASSERT_EQ(Result.Succeeded, true);
+    auto Expected = get_draw_command_list(convert_to_mesh(parse_obj_file(Filenames[I])));
+    ASSERT_EQ(Result.DrawCommands.size(), Expected.size());
+    for (size_t J = 0; J < Expected.size(); ++J) {
+      ASSERT_EQ(Result.DrawCommands[J].StartIndex, Expected[J].StartIndex);
+      ASSERT_EQ(Result.DrawCommands[J].NumIndices, Expected[J].NumIndices);
+    }
+  }
+
+  stringstream Summary;
+  print_batch_summary(Summary, Results, 1.0);
+  ASSERT_EQ(Summary.str().find("failed") != string::npos, true);
+
+  // Running out of memory in a nested task fails the file instead of the whole import.
+  Filenames.pop_back();
+  Options.OnMesh = [&](const string& Filename, mesh&) {
+    parallel_for(8, 0, [&](i32 I) {
+      if (Filename == Filenames[0] && I == 5) {
+        throw std::bad_alloc();
+      }
+    });
+  };
+  Results = import_obj_files(Filenames, Options);
+  ASSERT_EQ(Results[0].Succeeded, false);
+  for (size_t I = 1; I < Results.size(); ++I) {
+    ASSERT_EQ(Results[I].Succeeded, true);
+  }
+  return true;
+}
+
+bool test_pipelined_reader()
+{
+  // Items arrive in order, even when the queue is much smaller than their number.
+  spsc_queue<i32> Queue(3);
+  std::thread Producer([&] {
+    for (i32 I = 0; I < 10000; ++I) {
+      while (!Queue.try_push(I)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  for (i32 I = 0; I < 10000; ++I) {
+    i32 Value = -1;
+    Queue.pop(Value, [] { return false; });
+    ASSERT_EQ(Value, I);
+  }
+  Producer.join();
+
+  // Blocks much smaller than the input, and a line that is longer than a block.
+  synthetic_obj_options Generate;
+  Generate.NumFaces = 2000;
+  Generate.Topology = synthetic_topology::RANDOM;
+  stringstream Out;
+  write_synthetic_obj(Out, Generate);
+  string Text = "usemtl " + string(5000, 'm') + "\n" + Out.str() + "f 1 2 3";
+  string Lines;
+  {
+    stringstream In(Text);
+    pipelined_reader Reader(In, 100);
+    const char* Begin = nullptr;
+    const char* End = nullptr;
+    while (Reader.next(Begin, End)) {
+      Lines.append(Begin, End);
+      // Only the last line may come without its '\n'.
+      ASSERT_EQ((End == Begin || End[-1] == '\n' || Lines.size() == Text.size()), true);
+    }
+  }
+  ASSERT_EQ(Lines == Text, true);
+
+  obj_parse_options Options;
+  Options.ReadBlockSize = 1000;
+  stringstream In(Text);
+  auto Streamed = parse_obj(In, Options);
+  auto Expected = parse_obj(Text.data(), Text.size());
+  ASSERT_EQ(Streamed.v.size(), Expected.v.size());
+  ASSERT_EQ(memcmp(Streamed.v.data(), Expected.v.data(), sizeof(vec3) * Expected.v.size()), 0);
+  ASSERT_EQ(Streamed.f.Indices == Expected.f.Indices, true);
+  ASSERT_EQ(Streamed.f.Offsets == Expected.f.Offsets, true);
+  ASSERT_EQ(Streamed.MaterialNames == Expected.MaterialNames, true);
+  ASSERT_EQ(Streamed.FaceRuns.size(), Expected.FaceRuns.size());
+
+  // Stopping early, with the reading thread still ahead.
+  stringstream Partial(Text);
+  pipelined_reader Reader(Partial, 100);
+  const char* Begin = nullptr;
+  const char* End = nullptr;
+  ASSERT_EQ(Reader.next(Begin, End), true);
+  return true;
+}
+
+bool test_import_obj_to_mesh()
+{
+  auto check_same_mesh = [](const mesh& Mesh, const mesh& Expected) {
+    ASSERT_EQ(Mesh.Vertices.size(), Expected.Vertices.size());
+    ASSERT_EQ(memcmp(Mesh.Vertices.data(), Expected.Vertices.data(),
+        sizeof(vertex_data) * Mesh.Vertices.size()), 0);
+    ASSERT_EQ(Mesh.TriangleIndices == Expected.TriangleIndices, true);
+    ASSERT_EQ(Mesh.QuadIndices == Expected.QuadIndices, true);
+    ASSERT_EQ(Mesh.MaterialNames == Expected.MaterialNames, true);
+    auto Commands = get_draw_command_list(Mesh);
+    auto ExpectedCommands = get_draw_command_list(Expected);
+    ASSERT_EQ(Commands.size(), ExpectedCommands.size());
+    for (size_t I = 0; I < Commands.size(); ++I) {
+      ASSERT_EQ(Commands[I].StartIndex, ExpectedCommands[I].StartIndex);
+      ASSERT_EQ(Commands[I].NumIndices, ExpectedCommands[I].NumIndices);
+      ASSERT_EQ(Commands[I].MaterialId, ExpectedCommands[I].MaterialId);
+    }
+    return true;
+  };
+
+  mesh Mesh;
+  for (auto Format: {obj_face_format::V, obj_face_format::V_VT, obj_face_format::V_VN,
+           obj_face_format::V_VT_VN}) {
+    synthetic_obj_options Generate;
+    Generate.NumFaces = 3000;
+    Generate.FaceFormat = Format;
+    Generate.Topology = synthetic_topology::RANDOM;
+    stringstream Out;
+    write_synthetic_obj(Out, Generate);
+    auto Text = "v 0 0 0\nusemtl a\nf 1 1 1\n" + Out.str() + "usemtl b\nf 1 2 3 4 5\n";
+    for (auto Triangulate: {false, true}) {
+      obj_convert_options Options;
+      Options.Triangulate = Triangulate;
+      import_stats Stats;
+      Options.Stats = &Stats;
+      import_obj_to_mesh(Text.data(), Text.size(), Mesh, Options);
+      auto Obj = parse_obj(Text.data(), Text.size());
+      Options.Stats = nullptr;
+      if (!check_same_mesh(Mesh, convert_to_mesh(Obj, Options))) {
+        return false;
+      }
+      if (get_enabled_stats(&Stats)) {
+        ASSERT_EQ(Stats.NumFaces, Obj.f.size());
+        ASSERT_EQ(Stats.NumV, Obj.v.size());
+        ASSERT_EQ(Stats.NumMeshVertices, Mesh.Vertices.size());
+      }
+    }
+  }
+
+  if (!check_same_mesh(import_obj_file_to_mesh(DuckyFilePath),
+          convert_to_mesh(parse_obj_file(DuckyFilePath)))) {
+    return false;
+  }
+
+  // Faces that reference elements that come later, or don't exist, are dropped.
+  string Text = "v 0 0 0\nv 1 0 0\nf 1 2 3\nv 0 1 0\nf 1 2 3\nf 1 2 4\nf 1/1 2/1 3/1\n";
+  import_obj_to_mesh(Text.data(), Text.size(), Mesh);
+  ASSERT_EQ(Mesh.TriangleIndices.size(), 3);
+  ASSERT_EQ(Mesh.Vertices.size(), 3);
+  return true;
+}
+
+bool test_bvh()
+{
+  synthetic_obj_options Generate;
+  Generate.NumFaces = 40000;
+  Generate.FaceFormat = obj_face_format::V;
+  Generate.Topology = synthetic_topology::SPHERE;
+  stringstream Out;
+  write_synthetic_obj(Out, Generate);
+  // Some triangles besides the quads.
+  auto Text = Out.str() + "v 0 0 0\nv 2 0 0\nv 0 2 0\nv 0 0 2\nf -4 -3 -2\nf -4 -2 -1\n";
+  auto Mesh = convert_to_mesh(parse_obj(Text.data(), Text.size()));
+  ASSERT_EQ(Mesh.TriangleIndices.size(), 6);
+
+  bvh_options Options;
+  auto Bvh = build_bvh(Mesh, Options);
+  auto NumFaces = Mesh.TriangleIndices.size() / 3 + Mesh.QuadIndices.size() / 4;
+  ASSERT_EQ(Bvh.Faces.size(), NumFaces);
+  Options.NumThreads = 4;
+  auto Parallel = build_bvh(Mesh, Options);
+  ASSERT_EQ(Parallel.Nodes.size(), Bvh.Nodes.size());
+  ASSERT_EQ(memcmp(Parallel.Nodes.data(), Bvh.Nodes.data(), sizeof(bvh_node) * Bvh.Nodes.size()),
+      0);
+  for (size_t I = 0; I < NumFaces; ++I) {
+    ASSERT_EQ(Parallel.Faces[I].Face.Index, Bvh.Faces[I].Face.Index);
+    ASSERT_EQ(Parallel.Faces[I].Face.IsQuad, Bvh.Faces[I].Face.IsQuad);
+  }
+
+  // Every face is in exactly one leaf.
+  vector<i32> NumLeaves(NumFaces);
+  for (auto& Node: Bvh.Nodes) {
+    for4(I) {
+      for (auto J = Node.Children[I]; J < Node.Children[I] + Node.NumFaces[I]; ++J) {
+        auto& Face = Bvh.Faces[J].Face;
+        ++NumLeaves[Face.IsQuad ? Mesh.TriangleIndices.size() / 3 + Face.Index : Face.Index];
+      }
+    }
+  }
+  ASSERT_EQ(std::count(NumLeaves.begin(), NumLeaves.end(), 1), NumFaces);
+
+  auto get_corners = [&](size_t Face, vec3 Corners[4]) {
+    auto NumTriangles = Mesh.TriangleIndices.size() / 3;
+    bool IsQuad = Face >= NumTriangles;
+    auto Indices = IsQuad ? &Mesh.QuadIndices[4 * (Face - NumTriangles)]
+        : &Mesh.TriangleIndices[3 * Face];
+    for4(I) {
+      Corners[I] = Mesh.Vertices[Indices[IsQuad ? I : std::min(I, 2)]].Position;
+    }
+    return IsQuad;
+  };
+  // Moeller-Trumbore, without culling back faces.
+  auto intersect_triangle = [](const vec3& P0, const vec3& P1, const vec3& P2, const ray& Ray,
+      f32& T) {
+    auto Edge1 = P1 - P0;
+    auto Edge2 = P2 - P0;
+    auto P = cross(Ray.Direction, Edge2);
+    auto Determinant = dot(Edge1, P);
+    if (Determinant == 0.f) {
+      return false;
+    }
+    auto ToOrigin = Ray.Origin - P0;
+    auto U = dot(ToOrigin, P) / Determinant;
+    auto Q = cross(ToOrigin, Edge1);
+    auto W = dot(Ray.Direction, Q) / Determinant;
+    T = dot(Edge2, Q) / Determinant;
+    return U >= 0.f && W >= 0.f && U + W <= 1.f && T >= 0.f && T <= Ray.MaxT;
+  };
+
+  u32 State = 12345;
+  auto random = [&](f32 Min, f32 Max) {
+    State = State * 1664525u + 1013904223u;
+    return Min + (Max - Min) * static_cast<f32>(State >> 8) / static_cast<f32>(1 << 24);
+  };
+  auto random_point = [&](f32 Scale) {
+    auto Center = (Bvh.Bounds.Min + Bvh.Bounds.Max) * 0.5f;
+    auto Extent = (Bvh.Bounds.Max - Bvh.Bounds.Min) * (0.5f * Scale);
+    return Center + vec3{random(-Extent.X, Extent.X), random(-Extent.Y, Extent.Y),
+        random(-Extent.Z, Extent.Z)};
+  };
+  i32 NumHits = 0;
+  for (i32 I = 0; I < 300; ++I) {
+    ray Ray = {random_point(3.f), {0.f, 0.f, 0.f}, I % 3 == 0 ? FLT_MAX : random(0.f, 2.f)};
+    Ray.Direction = random_point(1.f) - Ray.Origin;
+    if (I % 5 == 0) {
+      // Along an axis, which makes the other components of the direction 0.
+      Ray.Direction = {0.f, 0.f, 0.f};
+      Ray.Direction.Data[I % 3] = I % 2 ? 1.f : -1.f;
+    }
+    f32 ExpectedT = FLT_MAX;
+    bool ExpectedHit = false;
+    for (size_t Face = 0; Face < NumFaces; ++Face) {
+      vec3 C[4];
+      bool IsQuad = get_corners(Face, C);
+      f32 T;
+      for (i32 Half = 0; Half < (IsQuad ? 2 : 1); ++Half) {
+        if (intersect_triangle(C[0], C[Half + 1], C[Half + 2], Ray, T)) {
+          ExpectedHit = true;
+          ExpectedT = std::min(ExpectedT, T);
+        }
+      }
+    }
+    NumHits += ExpectedHit;
+
+    ray_hit First = {};
+    for (auto Level: {simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2}) {
+      if (Level > get_simd_level()) {
+        continue;
+      }
+      ray_hit Hit = {};
+      ASSERT_EQ(intersect_closest(Bvh, Ray, Hit, Level), ExpectedHit);
+      ASSERT_EQ(intersect_any(Bvh, Ray, Level), ExpectedHit);
+      if (!ExpectedHit) {
+        continue;
+      }
+      ASSERT_EQ(std::fabs(Hit.T - ExpectedT) <= 1e-5f * (1.f + ExpectedT), true);
+      // The hit face is really hit at T.
+      vec3 C[4];
+      auto NumTriangles = Mesh.TriangleIndices.size() / 3;
+      bool IsQuad = get_corners((Hit.Face.IsQuad ? NumTriangles : 0) + Hit.Face.Index, C);
+      ASSERT_EQ(IsQuad, Hit.Face.IsQuad);
+      auto Point = Ray.Origin + Ray.Direction * Hit.T;
+      aabb Box = {C[0], C[0]};
+      for4(Corner) {
+        Box.Min = {std::min(Box.Min.X, C[Corner].X), std::min(Box.Min.Y, C[Corner].Y),
+            std::min(Box.Min.Z, C[Corner].Z)};
+        Box.Max = {std::max(Box.Max.X, C[Corner].X), std::max(Box.Max.Y, C[Corner].Y),
+            std::max(Box.Max.Z, C[Corner].Z)};
+      }
+      for3(Axis) {
+        ASSERT_EQ(Point.Data[Axis] >= Box.Min.Data[Axis] - 1e-3f, true);
+        ASSERT_EQ(Point.Data[Axis] <= Box.Max.Data[Axis] + 1e-3f, true);
+      }
+      if (Level == simd_level::SCALAR) {
+        First = Hit;
+      } else {
+        ASSERT_EQ(memcmp(&Hit, &First, sizeof(ray_hit)), 0);
+      }
+    }
+  }
+  // Many rays hit the sphere, and many end before it or miss it.
+  ASSERT_EQ((NumHits > 50 && NumHits < 250), true);
+
+  // A quad that isn't planar, and a ray that hits its first triangle behind the origin and its
+  // second one in front of it.
+  mesh Quad;
+  for (auto Position: {vec3{0.f, 0.f, 0.f}, vec3{2.f, 0.f, 0.f}, vec3{2.f, 2.f, 0.f},
+           vec3{0.f, 2.f, 4.f}}) {
+    vertex_data Vertex = {};
+    Vertex.Position = Position;
+    Quad.Vertices.push_back(Vertex);
+  }
+  Quad.QuadIndices = {0, 1, 2, 3};
+  auto QuadBvh = build_bvh(Quad);
+  ray QuadRay = {{1.f, 1.f, 1.f}, {-0.5f, 0.5f, 1.f}, FLT_MAX};
+  f32 ExpectedT = FLT_MAX;
+  for (i32 Half = 0; Half < 2; ++Half) {
+    f32 T;
+    if (intersect_triangle(Quad.Vertices[0].Position, Quad.Vertices[Half + 1].Position,
+            Quad.Vertices[Half + 2].Position, QuadRay, T)) {
+      ExpectedT = std::min(ExpectedT, T);
+    }
+  }
+  ASSERT_EQ(ExpectedT == 1.f, true);
+  for (auto Level: {simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2}) {
+    if (Level > get_simd_level()) {
+      continue;
+    }
+    ray_hit Hit = {};
+    ASSERT_EQ(intersect_closest(QuadBvh, QuadRay, Hit, Level), true);
+    ASSERT_EQ(std::fabs(Hit.T - ExpectedT) <= 1e-5f, true);
+    ASSERT_EQ(intersect_any(QuadBvh, QuadRay, Level), true);
+  }
+
+  for (i32 I = 0; I < 50; ++I) {
+    auto A = random_point(1.2f);
+    auto B = A + vec3{random(0.f, 0.3f), random(0.f, 0.3f), random(0.f, 0.3f)};
+    aabb Box = {A, B};
+    vector<bvh_face> Found;
+    find_overlapping_faces(Bvh, Box, Found);
+    vector<size_t> FoundFaces;
+    for (auto& Face: Found) {
+      FoundFaces.push_back((Face.IsQuad ? Mesh.TriangleIndices.size() / 3 : 0) + Face.Index);
+    }
+    std::sort(FoundFaces.begin(), FoundFaces.end());
+    vector<size_t> ExpectedFaces;
+    for (size_t Face = 0; Face < NumFaces; ++Face) {
+      vec3 C[4];
+      get_corners(Face, C);
+      bool Overlaps = true;
+      for3(Axis) {
+        auto Min = std::min(std::min(C[0].Data[Axis], C[1].Data[Axis]),
+            std::min(C[2].Data[Axis], C[3].Data[Axis]));
+        auto Max = std::max(std::max(C[0].Data[Axis], C[1].Data[Axis]),
+            std::max(C[2].Data[Axis], C[3].Data[Axis]));
+        Overlaps = Overlaps && Min <= B.Data[Axis] && Max >= A.Data[Axis];
+      }
+      if (Overlaps) {
+        ExpectedFaces.push_back(Face);
+      }
+    }
+    ASSERT_EQ(FoundFaces == ExpectedFaces, true);
+  }
+
+  auto Empty = build_bvh(mesh());
+  ray_hit Hit;
+  ASSERT_EQ(intersect_closest(Empty, {{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, FLT_MAX}, Hit), false);
+  return true;
+}
+
+bool test_generate_normals()
+{
+  // A unit cube without normals, with its faces wound counterclockwise from the outside.
+  string Cube = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0 0 1\nv 1 0 1\nv 1 1 1\nv 0 1 1\n"
+      "f 1 4 3 2\nf 5 6 7 8\nf 1 2 6 5\nf 3 4 8 7\nf 1 5 8 4\nf 2 3 7 6\n";
+  auto Obj = parse_obj(Cube.data(), Cube.size());
+  obj_convert_options Options;
+  auto Mesh = convert_to_mesh(Obj, Options);
+  ASSERT_EQ(Mesh.Vertices.size(), 8);
+  ASSERT_EQ(length_squared(Mesh.Vertices[0].Normal), 0.f);
+
+  // Smooth normals at the corners of a cube point away from its center.
+  Options.Normals.Mode = normal_options::mode::SMOOTH;
+  for (auto Weighting: {normal_options::weighting::AREA, normal_options::weighting::ANGLE}) {
+    Options.Normals.Weighting = Weighting;
+    Mesh = convert_to_mesh(Obj, Options);
+    ASSERT_EQ(Mesh.Vertices.size(), 8);
+    for (auto& Vertex: Mesh.Vertices) {
+      auto Outward = (Vertex.Position - vec3{0.5f, 0.5f, 0.5f}) * (2.f / std::sqrt(3.f));
+      ASSERT_EQ(dot(Vertex.Normal, Outward) > 0.9999f, true);
+    }
+  }
+
+  // With creases, and with flat normals, every face gets its own four vertices.
+  auto check_face_normals = [](const mesh& Mesh) {
+    ASSERT_EQ(Mesh.Vertices.size(), 24);
+    for (size_t I = 0; I < Mesh.QuadIndices.size(); I += 4) {
+      auto& A = Mesh.Vertices[Mesh.QuadIndices[I]].Position;
+      auto& B = Mesh.Vertices[Mesh.QuadIndices[I + 1]].Position;
+      auto& C = Mesh.Vertices[Mesh.QuadIndices[I + 2]].Position;
+      auto FaceNormal = cross(B - A, C - A);
+      for4(Corner) {
+        ASSERT_EQ(dot(Mesh.Vertices[Mesh.QuadIndices[I + Corner]].Normal, FaceNormal), 1.f);
+      }
+    }
+    return true;
+  };
+  Options.Normals.CreaseAngle = 60.f;
+  if (!check_face_normals(convert_to_mesh(Obj, Options))) {
+    return false;
+  }
+  Options.Normals.Mode = normal_options::mode::FLAT;
+  if (!check_face_normals(convert_to_mesh(Obj, Options))) {
+    return false;
+  }
+
+  // Normals from the file are kept, and the faces with them still count for the others.
+  string WithNormals = Cube + "vn 0 0 2\n";
+  WithNormals.replace(WithNormals.find("f 5 6 7 8"), 9, "f 5//1 6//1 7//1 8//1");
+  Options.Normals.Mode = normal_options::mode::SMOOTH;
+  Options.Normals.CreaseAngle = 180.f;
+  Mesh = convert_to_mesh(parse_obj(WithNormals.data(), WithNormals.size()), Options);
+  ASSERT_EQ(Mesh.Vertices.size(), 12);
+  for (auto& Vertex: Mesh.Vertices) {
+    auto Outward = (Vertex.Position - vec3{0.5f, 0.5f, 0.5f}) * (2.f / std::sqrt(3.f));
+    ASSERT_EQ((Vertex.Normal.Z == 2.f || dot(Vertex.Normal, Outward) > 0.9999f), true);
+  }
+
+  // Vertices that only differ in their texture coordinates get the same smooth normal.
+  string Seam = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 1\nvt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvt 0.5 0\n"
+      "vt 0.5 0.5\nf 1/1 2/2 3/3\nf 1/5 3/6 4/4\n";
+  Mesh = convert_to_mesh(parse_obj(Seam.data(), Seam.size()), Options);
+  ASSERT_EQ(Mesh.Vertices.size(), 6);
+  for (auto& A: Mesh.Vertices) {
+    for (auto& B: Mesh.Vertices) {
+      if (memcmp(&A.Position, &B.Position, sizeof(vec3)) == 0) {
+        ASSERT_EQ(memcmp(&A.Normal, &B.Normal, sizeof(vec3)), 0);
+      }
+    }
+  }
+
+  // Large enough for several tasks. The result doesn't depend on the number of threads or on
+  // the dedup method, and import_obj_to_mesh gives the same.
+  synthetic_obj_options Generate;
+  Generate.NumFaces = 100000;
+  Generate.FaceFormat = obj_face_format::V_VT;
+  Generate.Topology = synthetic_topology::SPHERE;
+  stringstream Out;
+  write_synthetic_obj(Out, Generate);
+  auto Text = Out.str();
+  Obj = parse_obj(Text.data(), Text.size());
+  Options.Normals.Weighting = normal_options::weighting::ANGLE;
+  Options.Normals.CreaseAngle = 30.f;
+  auto Expected = convert_to_mesh(Obj, Options);
+  for (auto& Vertex: Expected.Vertices) {
+    // The positions are on the unit sphere, even the degenerate corners at the poles.
+    ASSERT_EQ(dot(Vertex.Normal, Vertex.Position) > 0.99f, true);
+  }
+  Options.NumThreads = 4;
+  Options.DedupMethod = obj_convert_options::dedup_method::RADIX_SORT;
+  Mesh = convert_to_mesh(Obj, Options);
+  ASSERT_EQ(Mesh.Vertices.size(), Expected.Vertices.size());
+  ASSERT_EQ(memcmp(Mesh.Vertices.data(), Expected.Vertices.data(),
+      sizeof(vertex_data) * Mesh.Vertices.size()), 0);
+  ASSERT_EQ(Mesh.QuadIndices == Expected.QuadIndices, true);
+  Mesh = import_obj_to_mesh(Text.data(), Text.size(), Options);
+  ASSERT_EQ(Mesh.Vertices.size(), Expected.Vertices.size());
+  ASSERT_EQ(memcmp(Mesh.Vertices.data(), Expected.Vertices.data(),
+      sizeof(vertex_data) * Mesh.Vertices.size()), 0);
+  return true;
+}
+
+bool test_parse_many_names()
+{
+  // Every name is looked up, not searched for, so this doesn't take quadratic time.
+  string Text = "v 0 0 0\nv 1 0 0\nv 0 1 0\n";
+  const i32 NumGroups = 20000;
+  for (i32 I = 0; I < NumGroups; ++I) {
+    Text += "g group" + std::to_string(I) + "\nusemtl material" + std::to_string(I % 3)
+        + "\nf 1 2 3\n";
+  }
+  auto Expected = parse_obj(Text.data(), Text.size());
+  ASSERT_EQ(Expected.GroupNames.size(), NumGroups);
+  ASSERT_EQ(Expected.MaterialNames.size(), 3);
+  ASSERT_EQ(Expected.FaceRuns.back().Group, NumGroups - 1);
+  ASSERT_EQ(Expected.FaceRuns.back().Material, (NumGroups - 1) % 3);
+  obj_parse_options Options;
+  Options.NumThreads = 4;
+  Options.ChunkSize = 10000;
+  auto Data = parse_obj(Text.data(), Text.size(), Options);
+  ASSERT_EQ(Data.GroupNames == Expected.GroupNames, true);
+  ASSERT_EQ(Data.MaterialNames == Expected.MaterialNames, true);
+  ASSERT_EQ(Data.FaceRuns.size(), Expected.FaceRuns.size());
+  for (size_t I = 0; I < Data.FaceRuns.size(); ++I) {
+    ASSERT_EQ(Data.FaceRuns[I].FirstFace, Expected.FaceRuns[I].FirstFace);
+    ASSERT_EQ(Data.FaceRuns[I].Material, Expected.FaceRuns[I].Material);
+    ASSERT_EQ(Data.FaceRuns[I].Group, Expected.FaceRuns[I].Group);
+  }
+  return true;
+}
+
+bool test_build_lod_chain_in_parallel()
+{
+  // More vertices than one task takes, so that the costs are computed on several threads.
+  mesh Grid;
+  const i32 Size = 140;
+  for (i32 Y = 0; Y <= Size; ++Y) {
+    for (i32 X = 0; X <= Size; ++X) {
+      vertex_data Vertex = {};
+      Vertex.Position = {static_cast<f32>(X), static_cast<f32>(Y), std::sin(0.3f * X * Y)};
+      Vertex.Normal = {0.f, 0.f, 1.f};
+      Grid.Vertices.push_back(Vertex);
+    }
+  }
+  for (i32 Y = 0; Y < Size; ++Y) {
+    for (i32 X = 0; X < Size; ++X) {
+      i32 Corner = Y * (Size + 1) + X;
+      Grid.QuadIndices.insert(
+          Grid.QuadIndices.end(), {Corner, Corner + 1, Corner + Size + 2, Corner + Size + 1});
+    }
+  }
+  ASSERT_EQ(Grid.Vertices.size() > (1 << 14), true);
+  lod_options Options;
+  Options.TriangleRatios = {0.5f, 0.1f};
+  auto Serial = build_lod_chain(Grid, Options);
+  Options.NumThreads = 4;
+  auto Parallel = build_lod_chain(Grid, Options);
+  ASSERT_EQ(Parallel.size(), Serial.size());
+  for (size_t I = 0; I < Serial.size(); ++I) {
+    auto& Expected = Serial[I].Mesh;
+    auto& Actual = Parallel[I].Mesh;
+    ASSERT_EQ(Actual.TriangleIndices == Expected.TriangleIndices, true);
+    ASSERT_EQ(Actual.Vertices.size(), Expected.Vertices.size());
+    ASSERT_EQ(memcmp(Actual.Vertices.data(), Expected.Vertices.data(),
+        Expected.Vertices.size() * sizeof(vertex_data)), 0);
+    ASSERT_EQ(Parallel[I].Error == Serial[I].Error, true);
+  }
+  return true;
+}
+
 bool test_open_cube_file()
 {
   ifstream File(CubeFilePath);
@@ -408,8 +2176,47 @@ void run_all_tests()
   RUN_TEST(test_parse_faces_with_only_vertices);
   RUN_TEST(test_parse_faces_with_vertices_and_tex_coords);
   RUN_TEST(test_parse_faces_with_vertices_and_normals);
+  RUN_TEST(test_parse_cube_file_in_place);
+  RUN_TEST(test_parse_faces_from_buffer);
+  RUN_TEST(test_parse_relative_face_indices);
+  RUN_TEST(test_scan_float_matches_strtof);
+  RUN_TEST(test_scan_int);
   RUN_TEST(test_open_ducky_file);
   RUN_TEST(test_parse_ducky_faces);
+  RUN_TEST(test_parse_ducky_file_in_place_matches_stream);
+  RUN_TEST(test_parse_ducky_floats_bit_identical);
+  RUN_TEST(test_parse_obj_in_parallel_matches_serial);
+  RUN_TEST(test_face_list_layout);
+  RUN_TEST(test_convert_ducky_to_mesh);
+  RUN_TEST(test_dedup_methods_match);
+  RUN_TEST(test_convert_to_mesh_in_parallel_matches_serial);
+  RUN_TEST(test_stream_ducky_file_into_mesh);
+  RUN_TEST(test_stream_relative_face_indices);
+  RUN_TEST(test_mesh_cache_round_trip);
+  RUN_TEST(test_ducky_draw_commands_per_material);
+  RUN_TEST(test_faces_are_grouped_by_material);
+  RUN_TEST(test_triangulate_polygons);
+  RUN_TEST(test_convert_to_mesh_with_triangulation);
+  RUN_TEST(test_optimize_vertex_cache);
+  RUN_TEST(test_optimize_vertex_fetch);
+  RUN_TEST(test_half_conversion);
+  RUN_TEST(test_quantize_mesh);
+  RUN_TEST(test_soa_mesh_kernels_match_scalar);
+  RUN_TEST(test_build_meshlets);
+  RUN_TEST(test_build_lod_chain);
+  RUN_TEST(test_mesh_codec_round_trip);
+  RUN_TEST(test_synthetic_obj);
+  RUN_TEST(test_import_stats);
+  RUN_TEST(test_memory_arena);
+  RUN_TEST(test_import_with_arena);
+  RUN_TEST(test_thread_pool);
+  RUN_TEST(test_batch_import);
+  RUN_TEST(test_pipelined_reader);
+  RUN_TEST(test_import_obj_to_mesh);
+  RUN_TEST(test_bvh);
+  RUN_TEST(test_generate_normals);
+  RUN_TEST(test_parse_many_names);
+  RUN_TEST(test_build_lod_chain_in_parallel);
 }
 
 } // namespace storecast
@@ -0,0 +1,147 @@
+#include "thread_pool.hpp"
+
+#include "parallel.hpp"
+
+namespace storecast
+{
+
+namespace {
+thread_local thread_pool* CurrentPool = nullptr;
+thread_local i32 CurrentIndex = -1;
+} // anonymous namespace
+
+thread_pool::thread_pool(i32 NumThreads)
+{
+  if (NumThreads <= 0) {
+    NumThreads = get_num_hardware_threads();
+  }
+  for (i32 I = 0; I < NumThreads; ++I) {
+    Queues.emplace_back(new task_queue());
+  }
+  for (i32 I = 0; I < NumThreads; ++I) {
+    Threads.emplace_back([this, I] { run_thread(I); });
+  }
+}
+
+thread_pool::~thread_pool()
+{
+  {
+    std::unique_lock<std::mutex> Lock(SleepMutex);
+    GroupDone.wait(Lock, [&] { return NumUnfinished == 0; });
+    IsStopping = true;
+  }
+  WorkAvailable.notify_all();
+  for (auto& Thread: Threads) {
+    Thread.join();
+  }
+}
+
+thread_pool* thread_pool::get_current()
+{
+  return CurrentPool;
+}
+
+void thread_pool::submit(task_group& Group, std::function<void()> Task)
+{
+  ++Group.NumPending;
+  // Pool threads keep their own tasks, so that they run them next, while their data is still
+  // in the cache. Other threads spread them over all queues.
+  auto Index = CurrentPool == this ? static_cast<u32>(CurrentIndex)
+      : NextQueue++ % static_cast<u32>(Queues.size());
+  {
+    // Counting the task before it can run keeps the counters from dropping below 0. Taking the
+    // lock makes sure that a thread that is about to sleep sees the new task.
+    std::lock_guard<std::mutex> Lock(SleepMutex);
+    ++NumQueued;
+    ++NumUnfinished;
+  }
+  {
+    std::lock_guard<std::mutex> Lock(Queues[Index]->Mutex);
+    Queues[Index]->Tasks.push_back({std::move(Task), &Group});
+  }
+  WorkAvailable.notify_one();
+}
+
+void thread_pool::wait(task_group& Group)
+{
+  if (CurrentPool == this) {
+    while (Group.NumPending > 0) {
+      if (!run_one_task(CurrentIndex)) {
+        // The remaining tasks of the group are running on other threads.
+        std::this_thread::yield();
+      }
+    }
+  } else {
+    std::unique_lock<std::mutex> Lock(SleepMutex);
+    GroupDone.wait(Lock, [&] { return Group.NumPending == 0; });
+  }
+  if (Group.Exception) {
+    auto Exception = Group.Exception;
+    Group.Exception = nullptr;
+    std::rethrow_exception(Exception);
+  }
+}
+
+bool thread_pool::run_one_task(i32 Index)
+{
+  task Task;
+  bool Found = false;
+  auto NumQueues = static_cast<i32>(Queues.size());
+  for (i32 I = 0; I < NumQueues && !Found; ++I) {
+    auto& Queue = *Queues[(Index + I) % NumQueues];
+    std::lock_guard<std::mutex> Lock(Queue.Mutex);
+    if (!Queue.Tasks.empty()) {
+      // The newest task from the own queue, the oldest one from the others. Old tasks tend to
+      // be the large ones that split into more tasks, which is what an idle thread wants.
+      auto& Source = I == 0 ? Queue.Tasks.back() : Queue.Tasks.front();
+      Task = std::move(Source);
+      if (I == 0) {
+        Queue.Tasks.pop_back();
+      } else {
+        Queue.Tasks.pop_front();
+      }
+      --NumQueued;
+      Found = true;
+    }
+  }
+  if (!Found) {
+    return false;
+  }
+  std::exception_ptr Exception;
+  try {
+    Task.Function();
+  } catch (...) {
+    Exception = std::current_exception();
+  }
+  bool IsDone = false;
+  {
+    std::lock_guard<std::mutex> Lock(SleepMutex);
+    if (Exception && !Task.Group->Exception) {
+      Task.Group->Exception = Exception;
+    }
+    IsDone = --Task.Group->NumPending == 0;
+    IsDone = --NumUnfinished == 0 || IsDone;
+  }
+  if (IsDone) {
+    GroupDone.notify_all();
+  }
+  return true;
+}
+
+void thread_pool::run_thread(i32 Index)
+{
+  CurrentPool = this;
+  CurrentIndex = Index;
+  for (;;) {
+    if (run_one_task(Index)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> Lock(SleepMutex);
+    WorkAvailable.wait(Lock, [&] { return NumQueued > 0 || IsStopping; });
+    if (IsStopping) {
+      return;
+    }
+  }
+}
+
+} // namespace storecast
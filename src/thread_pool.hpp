@@ -0,0 +1,74 @@
+#pragma once
+#include "defines.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace storecast
+{
+
+// Work-stealing thread pool. Every pool thread has its own queue: it takes the task it submitted
+// last from its own queue, and when that is empty, steals the oldest task from another queue.
+// Tasks can submit more tasks and wait for them. A pool thread that waits runs other tasks in
+// the meantime, so nested parallelism neither deadlocks nor leaves threads idle. parallel_for
+// runs its tasks on the pool when it's called from a pool thread.
+class thread_pool {
+public:
+  // A set of tasks that can be waited for together.
+  struct task_group {
+    std::atomic<i64> NumPending{0};
+    // The first exception that escaped one of the tasks, for wait to rethrow.
+    std::exception_ptr Exception;
+  };
+
+  // 0 means one thread per hardware thread.
+  explicit thread_pool(i32 NumThreads = 0);
+  // Waits for all tasks, including those that are submitted in the meantime.
+  ~thread_pool();
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  i32 get_num_threads() const { return static_cast<i32>(Threads.size()); }
+  void submit(task_group& Group, std::function<void()> Task);
+  // Returns once all tasks of Group are done. If any of them threw, rethrows the first
+  // exception then, e.g. a bad_alloc of a nested parallel_for, so that it reaches the task that
+  // waits for it instead of terminating the pool thread.
+  void wait(task_group& Group);
+
+  // The pool that runs the calling thread, or null if that isn't a pool thread.
+  static thread_pool* get_current();
+
+private:
+  struct task {
+    std::function<void()> Function;
+    task_group* Group;
+  };
+  struct task_queue {
+    std::mutex Mutex;
+    std::deque<task> Tasks;
+  };
+  std::vector<std::unique_ptr<task_queue>> Queues;
+  std::vector<std::thread> Threads;
+  // Tasks in the queues, and tasks that have been submitted but haven't finished yet.
+  std::atomic<i64> NumQueued{0};
+  std::atomic<i64> NumUnfinished{0};
+  std::atomic<u32> NextQueue{0};
+  bool IsStopping = false;
+  // Sleeping pool threads wait for WorkAvailable, threads outside the pool for GroupDone.
+  std::mutex SleepMutex;
+  std::condition_variable WorkAvailable;
+  std::condition_variable GroupDone;
+
+  // Runs one task from the queue of pool thread Index, or one stolen from another queue.
+  // Returns false if all queues are empty.
+  bool run_one_task(i32 Index);
+  void run_thread(i32 Index);
+};
+
+} // namespace storecast
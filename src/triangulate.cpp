@@ -0,0 +1,133 @@
+#include "triangulate.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace storecast
+{
+using std::vector;
+
+namespace {
+struct vec2 {
+  f32 X;
+  f32 Y;
+};
+
+f32 cross(const vec2& A, const vec2& B, const vec2& C)
+{
+  return (B.X - A.X) * (C.Y - A.Y) - (B.Y - A.Y) * (C.X - A.X);
+}
+
+bool is_in_triangle(const vec2& P, const vec2& A, const vec2& B, const vec2& C)
+{
+  return cross(A, B, P) >= 0.f && cross(B, C, P) >= 0.f && cross(C, A, P) >= 0.f;
+}
+
+// Projects the polygon onto the axis plane it's most parallel to, with the axes chosen so that
+// the polygon winds counterclockwise in 2D.
+void project_polygon(const vec3* Positions, i32 NumCorners, vector<vec2>& Projected)
+{
+  // Newell's method gives a robust normal for non-planar and concave polygons.
+  vec3 Normal = {0.f, 0.f, 0.f};
+  for (i32 I = 0; I < NumCorners; ++I) {
+    Normal = Normal + cross(Positions[I], Positions[(I + 1) % NumCorners]);
+  }
+  i32 Axis = 2;
+  if (std::fabs(Normal.X) > std::fabs(Normal.Y) && std::fabs(Normal.X) > std::fabs(Normal.Z)) {
+    Axis = 0;
+  } else if (std::fabs(Normal.Y) > std::fabs(Normal.Z)) {
+    Axis = 1;
+  }
+  i32 U = (Axis + 1) % 3;
+  i32 V = (Axis + 2) % 3;
+  if (Normal.Data[Axis] < 0.f) {
+    std::swap(U, V);
+  }
+  Projected.resize(NumCorners);
+  for (i32 I = 0; I < NumCorners; ++I) {
+    Projected[I] = {Positions[I].Data[U], Positions[I].Data[V]};
+  }
+}
+
+bool is_convex(const vector<vec2>& Polygon)
+{
+  auto NumCorners = static_cast<i32>(Polygon.size());
+  for (i32 I = 0; I < NumCorners; ++I) {
+    auto& Previous = Polygon[(I + NumCorners - 1) % NumCorners];
+    auto& Next = Polygon[(I + 1) % NumCorners];
+    if (cross(Previous, Polygon[I], Next) < 0.f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void clip_ears(const vector<vec2>& Polygon, vector<i32>& Triangles)
+{
+  vector<i32> Remaining(Polygon.size());
+  for (size_t I = 0; I < Polygon.size(); ++I) {
+    Remaining[I] = static_cast<i32>(I);
+  }
+  while (Remaining.size() > 3) {
+    auto NumRemaining = Remaining.size();
+    // If there's no proper ear, the polygon is degenerate; clip the first corner anyway.
+    size_t Ear = 0;
+    for (size_t I = 0; I < NumRemaining; ++I) {
+      auto& A = Polygon[Remaining[(I + NumRemaining - 1) % NumRemaining]];
+      auto& B = Polygon[Remaining[I]];
+      auto& C = Polygon[Remaining[(I + 1) % NumRemaining]];
+      if (cross(A, B, C) <= 0.f) {
+        continue;
+      }
+      bool IsEar = true;
+      for (size_t J = 0; J < NumRemaining && IsEar; ++J) {
+        auto& P = Polygon[Remaining[J]];
+        bool IsCorner = J == I || J == (I + 1) % NumRemaining
+            || J == (I + NumRemaining - 1) % NumRemaining;
+        IsEar = IsCorner || !is_in_triangle(P, A, B, C);
+      }
+      if (IsEar) {
+        Ear = I;
+        break;
+      }
+    }
+    Triangles.push_back(Remaining[(Ear + NumRemaining - 1) % NumRemaining]);
+    Triangles.push_back(Remaining[Ear]);
+    Triangles.push_back(Remaining[(Ear + 1) % NumRemaining]);
+    Remaining.erase(Remaining.begin() + Ear);
+  }
+  Triangles.insert(Triangles.end(), Remaining.begin(), Remaining.end());
+}
+} // anonymous namespace
+
+void triangulate_polygon(const vec3* Positions, i32 NumCorners, vector<i32>& Triangles)
+{
+  if (NumCorners < 3) {
+    return;
+  }
+  if (NumCorners == 3) {
+    Triangles.insert(Triangles.end(), {0, 1, 2});
+    return;
+  }
+
+  // Reused between calls, so that triangulating quads doesn't allocate.
+  thread_local vector<vec2> Projected;
+  project_polygon(Positions, NumCorners, Projected);
+  if (!is_convex(Projected)) {
+    clip_ears(Projected, Triangles);
+  } else if (NumCorners == 4) {
+    // The shorter diagonal gives better shaped triangles.
+    if (length_squared(Positions[2] - Positions[0]) <= length_squared(Positions[3] - Positions[1])) {
+      Triangles.insert(Triangles.end(), {0, 1, 2, 0, 2, 3});
+    } else {
+      Triangles.insert(Triangles.end(), {1, 2, 3, 1, 3, 0});
+    }
+  } else {
+    for (i32 I = 1; I + 1 < NumCorners; ++I) {
+      Triangles.insert(Triangles.end(), {0, I, I + 1});
+    }
+  }
+}
+
+} // namespace storecast
@@ -0,0 +1,17 @@
+#pragma once
+#include "defines.hpp"
+#include "math.hpp"
+#include <vector>
+
+namespace storecast
+{
+
+// Splits the polygon with the given corner positions into NumCorners - 2 triangles, and appends
+// the corners of each triangle (indices into Positions, in the polygon's winding order) to
+// Triangles. Quads are split along the shorter diagonal, other convex polygons are fanned from
+// the first corner, and concave polygons are ear-clipped. The polygon is assumed to be roughly
+// planar and not self-intersecting; if it isn't, the result still covers every corner, but may
+// overlap.
+void triangulate_polygon(const vec3* Positions, i32 NumCorners, std::vector<i32>& Triangles);
+
+} // namespace storecast
@@ -0,0 +1,266 @@
+#include "vertex_dedup.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "parallel.hpp"
+
+namespace storecast
+{
+using std::vector;
+
+namespace {
+// Most mesh vertices are shared by several faces, about four in a closed quad mesh. Sizing the
+// maps for a quarter of the keys keeps them small enough for the cache; they grow if needed.
+const size_t KeysPerVertexEstimate = 4;
+
+u64 hash(const vertex_key& Key)
+{
+  // Multiply-xorshift. The indices are small and close together, so they have to be mixed
+  // thoroughly before we can take the low bits as the slot.
+  u64 H = static_cast<u32>(Key.V) * 0x9E3779B97F4A7C15ull;
+  H ^= static_cast<u32>(Key.Vt) * 0xC2B2AE3D27D4EB4Full;
+  H ^= static_cast<u32>(Key.Vn) * 0x165667B19E3779F9ull;
+  H ^= H >> 29;
+  H *= 0xBF58476D1CE4E5B9ull;
+  H ^= H >> 32;
+  return H;
+}
+
+u32 get_field(const vertex_key& Key, i32 Field)
+{
+  return static_cast<u32>(Field == 0 ? Key.V : (Field == 1 ? Key.Vt : Key.Vn));
+}
+} // anonymous namespace
+
+vertex_key_map::vertex_key_map(size_t ExpectedNumKeys, memory_arena* Arena)
+  : Slots(arena_allocator<slot>(Arena))
+{
+  // Keep the load factor at or below 1/2.
+  size_t NumSlots = 16;
+  while (NumSlots < 2 * ExpectedNumKeys) {
+    NumSlots *= 2;
+  }
+  Slots.resize(NumSlots, slot{{0, 0, 0}, -1});
+}
+
+i32 vertex_key_map::insert(const vertex_key& Key, i32 Index)
+{
+  if (2 * (NumKeys + 1) > Slots.size()) {
+    grow();
+  }
+  auto Mask = Slots.size() - 1;
+  for (auto I = hash(Key) & Mask; ; I = (I + 1) & Mask) {
+    auto& Slot = Slots[I];
+    if (Slot.Index < 0) {
+      Slot = {Key, Index};
+      ++NumKeys;
+      return Index;
+    }
+    if (Slot.Key == Key) {
+      return Slot.Index;
+    }
+  }
+}
+
+void vertex_key_map::reserve(size_t NumKeys)
+{
+  while (Slots.size() < 2 * NumKeys) {
+    grow();
+  }
+}
+
+void vertex_key_map::grow()
+{
+  arena_vector<slot> OldSlots(2 * Slots.size(), slot{{0, 0, 0}, -1}, Slots.get_allocator());
+  std::swap(Slots, OldSlots);
+  auto Mask = Slots.size() - 1;
+  for (auto& Old: OldSlots) {
+    if (Old.Index >= 0) {
+      auto I = hash(Old.Key) & Mask;
+      while (Slots[I].Index >= 0) {
+        I = (I + 1) & Mask;
+      }
+      Slots[I] = Old;
+    }
+  }
+}
+
+i32 dedup_vertices_hash(const vector<vertex_key>& Keys, vector<i32>& VertexIndices, i32 NumThreads)
+{
+  VertexIndices.resize(Keys.size());
+  return dedup_vertices_hash(Keys.data(), Keys.size(), VertexIndices.data(), NumThreads);
+}
+
+i32 dedup_vertices_radix_sort(const vector<vertex_key>& Keys, vector<i32>& VertexIndices)
+{
+  VertexIndices.resize(Keys.size());
+  return dedup_vertices_radix_sort(Keys.data(), Keys.size(), VertexIndices.data());
+}
+
+i32 dedup_vertices_hash(const vertex_key* Keys, size_t NumKeys, i32* VertexIndices,
+    i32 NumThreads, memory_arena* Arena)
+{
+  if (NumThreads <= 0) {
+    NumThreads = get_num_hardware_threads();
+  }
+  const size_t KeysPerTask = 1 << 16;
+  if (NumThreads == 1 || NumKeys <= KeysPerTask) {
+    vertex_key_map Map(NumKeys / KeysPerVertexEstimate, Arena);
+    i32 NumVertices = 0;
+    for (size_t I = 0; I < NumKeys; ++I) {
+      VertexIndices[I] = Map.insert(Keys[I], NumVertices);
+      if (VertexIndices[I] == NumVertices) {
+        ++NumVertices;
+      }
+    }
+    return NumVertices;
+  }
+
+  // Equal keys always land in the same partition, so the partitions can be deduplicated
+  // independently. Within a partition, the positions are in the order of Keys, which makes the
+  // first position a map sees for a key the key's first occurrence.
+  auto NumTasks = static_cast<i32>((NumKeys + KeysPerTask - 1) / KeysPerTask);
+  auto NumPartitions = 4 * NumThreads;
+  auto get_partition = [=](const vertex_key& Key) {
+    return static_cast<i32>((hash(Key) >> 32) % static_cast<u32>(NumPartitions));
+  };
+  auto get_task_range = [&](i32 Task, size_t& Begin, size_t& End) {
+    Begin = Task * KeysPerTask;
+    End = std::min(Begin + KeysPerTask, NumKeys);
+  };
+
+  // Counts[P * NumTasks + T] is the number of keys of task T in partition P. The exclusive prefix
+  // sum over that is where task T puts its keys of partition P.
+  arena_allocator<size_t> Allocator(Arena);
+  arena_vector<size_t> Counts(static_cast<size_t>(NumPartitions) * NumTasks + 1, 0, Allocator);
+  parallel_for(NumTasks, NumThreads, [&](i32 Task) {
+    size_t Begin, End;
+    get_task_range(Task, Begin, End);
+    for (auto I = Begin; I < End; ++I) {
+      ++Counts[1 + static_cast<size_t>(get_partition(Keys[I])) * NumTasks + Task];
+    }
+  });
+  std::partial_sum(Counts.begin(), Counts.end(), Counts.begin());
+  arena_vector<u32> Positions(NumKeys, 0, Allocator);
+  parallel_for(NumTasks, NumThreads, [&](i32 Task) {
+    size_t Begin, End;
+    get_task_range(Task, Begin, End);
+    for (auto I = Begin; I < End; ++I) {
+      auto& Offset = Counts[static_cast<size_t>(get_partition(Keys[I])) * NumTasks + Task];
+      Positions[Offset++] = static_cast<u32>(I);
+    }
+  });
+  // The scatter moved every offset to the beginning of the next range, so partition P now
+  // covers Positions[Counts[P * NumTasks - 1], Counts[(P + 1) * NumTasks - 1]).
+
+  arena_vector<i32> FirstOccurrences(NumKeys, 0, Allocator);
+  parallel_for(NumPartitions, NumThreads, [&](i32 Partition) {
+    auto Begin = Partition == 0 ? 0 : Counts[static_cast<size_t>(Partition) * NumTasks - 1];
+    auto End = Counts[static_cast<size_t>(Partition + 1) * NumTasks - 1];
+    vertex_key_map Map((End - Begin) / KeysPerVertexEstimate, Arena);
+    for (auto I = Begin; I < End; ++I) {
+      auto Position = static_cast<i32>(Positions[I]);
+      FirstOccurrences[Position] = Map.insert(Keys[Position], Position);
+    }
+  });
+
+  // Number the first occurrences in the order of Keys. Another prefix sum tells every task where
+  // its numbers start.
+  arena_vector<i32> NumVerticesBefore(NumTasks + 1, 0, Allocator);
+  parallel_for(NumTasks, NumThreads, [&](i32 Task) {
+    size_t Begin, End;
+    get_task_range(Task, Begin, End);
+    for (auto I = Begin; I < End; ++I) {
+      NumVerticesBefore[Task + 1] += FirstOccurrences[I] == static_cast<i32>(I) ? 1 : 0;
+    }
+  });
+  std::partial_sum(NumVerticesBefore.begin(), NumVerticesBefore.end(), NumVerticesBefore.begin());
+  parallel_for(NumTasks, NumThreads, [&](i32 Task) {
+    size_t Begin, End;
+    get_task_range(Task, Begin, End);
+    auto NumVertices = NumVerticesBefore[Task];
+    for (auto I = Begin; I < End; ++I) {
+      if (FirstOccurrences[I] == static_cast<i32>(I)) {
+        VertexIndices[I] = NumVertices++;
+      }
+    }
+  });
+  parallel_for(NumTasks, NumThreads, [&](i32 Task) {
+    size_t Begin, End;
+    get_task_range(Task, Begin, End);
+    for (auto I = Begin; I < End; ++I) {
+      if (FirstOccurrences[I] != static_cast<i32>(I)) {
+        VertexIndices[I] = VertexIndices[FirstOccurrences[I]];
+      }
+    }
+  });
+  return NumVerticesBefore[NumTasks];
+}
+
+i32 dedup_vertices_radix_sort(const vertex_key* Keys, size_t NumKeys, i32* VertexIndices,
+    memory_arena* Arena)
+{
+  struct sorted_key {
+    vertex_key Key;
+    u32 Position;
+  };
+  if (NumKeys == 0) {
+    return 0;
+  }
+
+  // One histogram per byte of the key. Digit D is byte D%4 of field D/4, and we sort from the
+  // least significant digit, Vn's lowest byte, to the most significant one, V's highest byte.
+  const i32 NumDigits = 12;
+  arena_allocator<sorted_key> Allocator(Arena);
+  arena_vector<u32> Counts(NumDigits * 256, 0, Allocator);
+  arena_vector<sorted_key> Sorted(NumKeys, sorted_key(), Allocator);
+  for (size_t I = 0; I < NumKeys; ++I) {
+    Sorted[I] = {Keys[I], static_cast<u32>(I)};
+    for (i32 D = 0; D < NumDigits; ++D) {
+      ++Counts[D * 256 + ((get_field(Keys[I], 2 - D / 4) >> (8 * (D % 4))) & 0xFF)];
+    }
+  }
+
+  // Each pass is stable, and Sorted starts out in the order of Keys, so equal keys stay in the
+  // order in which they occur in Keys.
+  arena_vector<sorted_key> Buffer(NumKeys, sorted_key(), Allocator);
+  for (i32 D = 0; D < NumDigits; ++D) {
+    auto* Count = &Counts[D * 256];
+    auto Field = 2 - D / 4;
+    auto Shift = 8 * (D % 4);
+    // Skip digits that are the same for all keys, e.g. the high bytes of all fields, or all of
+    // Vt and Vn if the file has no texture coordinates or normals.
+    if (std::find(Count, Count + 256, static_cast<u32>(NumKeys)) != Count + 256) {
+      continue;
+    }
+    u32 Offsets[256];
+    u32 Offset = 0;
+    for (i32 B = 0; B < 256; ++B) {
+      Offsets[B] = Offset;
+      Offset += Count[B];
+    }
+    for (auto& Element: Sorted) {
+      Buffer[Offsets[(get_field(Element.Key, Field) >> Shift) & 0xFF]++] = Element;
+    }
+    std::swap(Sorted, Buffer);
+  }
+
+  // The first element of every run of equal keys is the key's first occurrence. Point all others
+  // to it, then number the first occurrences in the order of Keys.
+  for (size_t I = 0, RunBegin = 0; I < NumKeys; ++I) {
+    if (!(Sorted[I].Key == Sorted[RunBegin].Key)) {
+      RunBegin = I;
+    }
+    VertexIndices[Sorted[I].Position] = static_cast<i32>(Sorted[RunBegin].Position);
+  }
+  i32 NumVertices = 0;
+  for (size_t I = 0; I < NumKeys; ++I) {
+    auto FirstOccurrence = static_cast<size_t>(VertexIndices[I]);
+    VertexIndices[I] = FirstOccurrence == I ? NumVertices++ : VertexIndices[FirstOccurrence];
+  }
+  return NumVertices;
+}
+
+} // namespace storecast
@@ -0,0 +1,68 @@
+#pragma once
+#include "defines.hpp"
+#include "memory_arena.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace storecast
+{
+
+// The (v, vt, vn) indices of one face vertex as they appear in the file, 1-based. Vt and Vn are 0
+// if the face doesn't reference them. Two face vertices end up as the same mesh vertex iff their
+// keys are equal.
+struct vertex_key {
+  i32 V;
+  i32 Vt;
+  i32 Vn;
+};
+inline bool operator==(const vertex_key& Left, const vertex_key& Right)
+{
+  return Left.V == Right.V && Left.Vt == Right.Vt && Left.Vn == Right.Vn;
+}
+
+// Open-addressing hash map from vertex_key to a vertex index. Keys and values are stored inline
+// in one array, so a lookup usually touches a single cache line. The table grows as needed, so
+// it can also be filled incrementally. The table comes from Arena if that is set.
+struct vertex_key_map {
+  explicit vertex_key_map(size_t ExpectedNumKeys = 0, memory_arena* Arena = nullptr);
+
+  // Returns the index stored for Key. If there is none yet, stores Index for Key and returns it.
+  i32 insert(const vertex_key& Key, i32 Index);
+  size_t size() const { return NumKeys; }
+  // Grows the table now, so that it holds NumKeys keys without growing again.
+  void reserve(size_t NumKeys);
+
+private:
+  struct slot {
+    vertex_key Key;
+    i32 Index; // -1 if the slot is empty
+  };
+  arena_vector<slot> Slots;
+  size_t NumKeys = 0;
+
+  void grow();
+};
+
+// Both functions number the distinct keys in the order of their first occurrence in Keys, and
+// set VertexIndices[I] to the number of Keys[I]. They return the number of distinct keys. The
+// results are identical; they only differ in speed.
+//
+// Hashes every key once. Expected O(n), and the default. With more than one thread (0 means one
+// per hardware thread), the keys are first split into partitions by their hash, and every
+// partition is deduplicated with its own hash map.
+i32 dedup_vertices_hash(const std::vector<vertex_key>& Keys, std::vector<i32>& VertexIndices,
+    i32 NumThreads = 1);
+// LSD radix sort over the bytes of the keys that are actually in use. Always O(n), and moves
+// through memory sequentially, so it's faster for inputs whose hash table doesn't fit into the
+// cache.
+i32 dedup_vertices_radix_sort(const std::vector<vertex_key>& Keys,
+    std::vector<i32>& VertexIndices);
+
+// The same on NumKeys keys at Keys, with VertexIndices pointing to as many elements. All
+// temporary memory comes from Arena if that is set.
+i32 dedup_vertices_hash(const vertex_key* Keys, size_t NumKeys, i32* VertexIndices,
+    i32 NumThreads = 1, memory_arena* Arena = nullptr);
+i32 dedup_vertices_radix_sort(const vertex_key* Keys, size_t NumKeys, i32* VertexIndices,
+    memory_arena* Arena = nullptr);
+
+} // namespace storecast